@@ -0,0 +1,211 @@
+# Copyright 2019 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Benchmarks the CPU LAPACK custom calls against direct LAPACK calls.
+
+Each decomposition is run under jit on CPU over a sweep of dtypes, matrix
+sizes and batch sizes, and timed against a loop of direct calls to the same
+LAPACK routine through scipy.linalg.lapack, which binds the library that
+scipy.linalg.cython_lapack, and so jaxlib, links against. The difference is
+the cost of the custom call shims: operand layout changes, copies into
+aliased outputs, workspace allocation and dispatch.
+
+Results are written as one JSON object per line, e.g.
+
+  python benchmarks/lapack_benchmark.py --ops=cholesky,svd \\
+      --sizes=4,64,1024 --batch_sizes=1,64 --output=/tmp/lapack.jsonl
+
+Each record holds the configuration, the best wall time over --repeats
+calls of each implementation, throughput in matrices per second and
+nominal GFLOP/s, and `overhead`, the ratio of the jit time to the direct
+LAPACK time. The direct calls are made from a Python loop, whose per-call
+cost, around a microsecond, dominates the baseline for the smallest
+matrices.
+"""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from functools import partial
+import json
+import sys
+import time
+
+from absl import app
+from absl import flags
+
+import numpy as onp
+import scipy.linalg.lapack
+
+from jax.config import config
+config.update("jax_enable_x64", True)
+
+from jax import jit
+from jax import lax_linalg
+import jax.numpy as np
+import jax.scipy as jsp
+from jax.tree_util import tree_flatten
+
+FLAGS = flags.FLAGS
+
+flags.DEFINE_string('ops', 'cholesky,lu,triangular_solve,svd,eigh,eig',
+                    'Comma-separated decompositions to benchmark.')
+flags.DEFINE_string('dtypes', 'float32,float64,complex64,complex128',
+                    'Comma-separated dtypes to benchmark.')
+flags.DEFINE_string('sizes', '4,16,64,256,1024,4096',
+                    'Comma-separated matrix sizes to benchmark.')
+flags.DEFINE_string('batch_sizes', '1,16,256',
+                    'Comma-separated batch sizes to benchmark.')
+flags.DEFINE_integer('max_elements', 1 << 24,
+                     'Skips configurations whose batch holds more matrix '
+                     'elements than this.')
+flags.DEFINE_integer('repeats', 5, 'Timed calls per configuration.')
+flags.DEFINE_string('output', None,
+                    'File to write JSON lines to; defaults to stdout.')
+
+
+def _randn(rng, dtype, *shape):
+  x = rng.randn(*shape)
+  if onp.issubdtype(dtype, onp.complexfloating):
+    x = x + 1j * rng.randn(*shape)
+  return x.astype(dtype)
+
+def _general(rng, dtype, batch, n):
+  return (_randn(rng, dtype, batch, n, n),)
+
+def _positive_definite(rng, dtype, batch, n):
+  a = _randn(rng, dtype, batch, n, n)
+  a = onp.matmul(a, onp.conj(onp.swapaxes(a, -1, -2)))
+  return ((a + n * onp.eye(n)).astype(dtype),)
+
+def _triangular_system(rng, dtype, batch, n):
+  a = onp.tril(_randn(rng, dtype, batch, n, n)) / n + onp.eye(n)
+  return a.astype(dtype), _randn(rng, dtype, batch, n, n)
+
+
+def _lapack(name, dtype):
+  fn, = scipy.linalg.lapack.get_lapack_funcs((name,), dtype=onp.dtype(dtype))
+  return fn
+
+def _hermitian_eig(dtype):
+  complex_ = onp.issubdtype(dtype, onp.complexfloating)
+  return _lapack('heevd' if complex_ else 'syevd', dtype)
+
+# Each op maps to (argument maker, jax function, a function of the dtype
+# returning the LAPACK routine to call on each matrix, nominal real flop count
+# of one n x n problem). The routines are asked for the same outputs as the
+# jax functions compute.
+_OPS = {
+    'cholesky': (
+        _positive_definite, np.linalg.cholesky,
+        lambda dtype: partial(_lapack('potrf', dtype), lower=1, clean=0),
+        lambda n: n ** 3 / 3.),
+    'lu': (
+        _general, lax_linalg.lu,
+        lambda dtype: _lapack('getrf', dtype),
+        lambda n: 2. * n ** 3 / 3),
+    'triangular_solve': (
+        _triangular_system,
+        partial(jsp.linalg.solve_triangular, lower=True),
+        lambda dtype: partial(_lapack('trtrs', dtype), lower=1),
+        lambda n: 1. * n ** 3),
+    'svd': (
+        _general, partial(np.linalg.svd, full_matrices=False),
+        lambda dtype: partial(_lapack('gesdd', dtype), full_matrices=0),
+        lambda n: 22. * n ** 3),
+    'eigh': (
+        _positive_definite, np.linalg.eigh,
+        lambda dtype: partial(_hermitian_eig(dtype), lower=1),
+        lambda n: 9. * n ** 3),
+    'eig': (
+        _general, np.linalg.eig,
+        lambda dtype: _lapack('geev', dtype),
+        lambda n: 25. * n ** 3),
+}
+
+
+def _best_time(f):
+  """Returns the best wall time of FLAGS.repeats calls of f, after a warmup
+  call that also compiles it."""
+  f()
+  best = float('inf')
+  for _ in range(FLAGS.repeats):
+    start = time.time()
+    f()
+    best = min(best, time.time() - start)
+  return best
+
+def _block(tree):
+  for leaf in tree_flatten(tree)[0]:
+    leaf.block_until_ready()
+
+
+def _benchmark(op, dtype, n, batch, rng):
+  make_args, jax_fn, lapack_fn, flops = _OPS[op]
+  args = make_args(rng, dtype, batch, n)
+
+  jitted = jit(jax_fn)
+  jax_args = [np.asarray(x) for x in args]
+  jax_seconds = _best_time(lambda: _block(jitted(*jax_args)))
+
+  # Converting to column-major up front keeps layout changes out of the
+  # baseline, so that they count toward the custom calls' overhead.
+  raw = lapack_fn(dtype)
+  matrices = [[onp.asfortranarray(x[i]) for x in args] for i in range(batch)]
+  def run_lapack():
+    for m in matrices:
+      raw(*m)
+  lapack_seconds = _best_time(run_lapack)
+
+  complex_factor = 4 if onp.issubdtype(dtype, onp.complexfloating) else 1
+  total_flops = batch * flops(n) * complex_factor
+  return {
+      'op': op,
+      'dtype': onp.dtype(dtype).name,
+      'n': n,
+      'batch': batch,
+      'jax_seconds': jax_seconds,
+      'lapack_seconds': lapack_seconds,
+      'jax_matrices_per_second': batch / jax_seconds,
+      'lapack_matrices_per_second': batch / lapack_seconds,
+      'jax_gflops': total_flops / jax_seconds / 1e9,
+      'lapack_gflops': total_flops / lapack_seconds / 1e9,
+      'overhead': jax_seconds / lapack_seconds,
+  }
+
+
+def main(unused_argv):
+  out = open(FLAGS.output, 'w') if FLAGS.output else sys.stdout
+  rng = onp.random.RandomState(0)
+  try:
+    for op in FLAGS.ops.split(','):
+      if op not in _OPS:
+        raise ValueError('Unknown op {}; expected one of {}'.format(
+            op, ', '.join(sorted(_OPS))))
+      for dtype in FLAGS.dtypes.split(','):
+        for n in map(int, FLAGS.sizes.split(',')):
+          for batch in map(int, FLAGS.batch_sizes.split(',')):
+            if batch * n * n > FLAGS.max_elements:
+              continue
+            record = _benchmark(op, onp.dtype(dtype), n, batch, rng)
+            out.write(json.dumps(record, sort_keys=True) + '\n')
+            out.flush()
+  finally:
+    if out is not sys.stdout:
+      out.close()
+
+
+if __name__ == '__main__':
+  app.run(main)
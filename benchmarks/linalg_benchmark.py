@@ -0,0 +1,110 @@
+# Copyright 2019 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Benchmarks the CPU linear solvers.
+
+Compares the mixed-precision iterative refinement solvers (dsgesv/dsposv),
+which factor in float32 and refine to float64, against the plain float64
+LAPACK solvers (dgesv/dposv) they replace, and reports the accuracy of each.
+
+  python benchmarks/linalg_benchmark.py --sizes=256,1024,2048
+"""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from functools import partial
+import time
+
+from absl import app
+from absl import flags
+
+import numpy as onp
+
+from jax.config import config
+config.update("jax_enable_x64", True)
+
+from jax import jit
+import jax.numpy as np
+import jax.scipy as jsp
+
+FLAGS = flags.FLAGS
+
+flags.DEFINE_string('sizes', '128,512,1024,2048',
+                    'Comma-separated matrix sizes to benchmark.')
+flags.DEFINE_integer('nrhs', 1, 'Number of right-hand sides.')
+flags.DEFINE_integer('repeats', 5, 'Timed calls per configuration.')
+flags.DEFINE_string('dtype', 'float64', 'float64 or complex128.')
+
+
+def _time(f, *args):
+  """Returns the best wall time of FLAGS.repeats calls of f, after a warmup
+  call that also compiles it."""
+  f(*args).block_until_ready()
+  best = float('inf')
+  for _ in range(FLAGS.repeats):
+    start = time.time()
+    f(*args).block_until_ready()
+    best = min(best, time.time() - start)
+  return best
+
+
+def _relative_residual(a, x, b):
+  a, x, b = map(onp.asarray, (a, x, b))
+  return (onp.linalg.norm(onp.matmul(a, x) - b) /
+          (onp.linalg.norm(a) * onp.linalg.norm(x)))
+
+
+def _random_system(rng, n, nrhs, dtype):
+  def randn(*shape):
+    x = rng.randn(*shape)
+    if onp.issubdtype(dtype, onp.complexfloating):
+      x = x + 1j * rng.randn(*shape)
+    return x.astype(dtype)
+  return randn(n, n), randn(n, nrhs)
+
+
+def main(unused_argv):
+  dtype = onp.dtype(FLAGS.dtype)
+  rng = onp.random.RandomState(0)
+
+  solvers = [
+      ('gesv', False,
+       jit(partial(np.linalg.solve, mixed_precision=False))),
+      ('gesv', True,
+       jit(partial(np.linalg.solve, mixed_precision=True))),
+      ('posv', False,
+       jit(partial(jsp.linalg.solve, sym_pos=True, mixed_precision=False))),
+      ('posv', True,
+       jit(partial(jsp.linalg.solve, sym_pos=True, mixed_precision=True))),
+  ]
+
+  print('{:>6} {:>6} {:>6} {:>12} {:>10} {:>12}'.format(
+      'n', 'solver', 'mixed', 'seconds', 'speedup', 'residual'))
+  for n in map(int, FLAGS.sizes.split(',')):
+    a, b = _random_system(rng, n, FLAGS.nrhs, dtype)
+    spd = onp.matmul(a, onp.conj(a.T)) + n * onp.eye(n, dtype=dtype)
+    baseline = {}
+    for name, mixed, solve in solvers:
+      lhs = spd if name == 'posv' else a
+      seconds = _time(solve, lhs, b)
+      baseline.setdefault(name, seconds)
+      residual = _relative_residual(lhs, solve(lhs, b), b)
+      print('{:>6} {:>6} {:>6} {:>12.6f} {:>10.2f} {:>12.3e}'.format(
+          n, name, str(mixed), seconds, baseline[name] / seconds, residual))
+
+
+if __name__ == '__main__':
+  app.run(main)
@@ -33,9 +33,12 @@ def concretization_err_msg(fun):
          "applying `jit` to smaller subfunctions instead.")
   return msg.format(fname)
 
+class ConcretizationTypeError(TypeError):
+  """Raised when a function being traced needs the concrete value of a tracer."""
+
 def concretization_function_error(fun):
   def error(self, *args):
-    raise TypeError(concretization_err_msg(fun))
+    raise ConcretizationTypeError(concretization_err_msg(fun))
   return error
 
 
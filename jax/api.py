@@ -189,6 +189,72 @@ def disable_jit():
 _jit_is_disabled = False
 
 
+@contextmanager
+def lazy_eager():
+  """Context manager that fuses op-by-op execution under its dynamic context.
+
+  Outside of `jit`, each primitive (e.g. each `jax.numpy` elementwise operation)
+  is normally compiled and dispatched to XLA on its own, and every intermediate
+  result is materialized on the device. Under `lazy_eager`, primitive
+  applications are instead recorded into a pending graph, which is compiled as
+  a single cached XLA computation and executed only when one of its results is
+  observed (for example by converting it to a NumPy array, printing it, or using
+  it in Python control flow), when the graph reaches
+  `--jax_lazy_eager_max_ops` operations, or when the context exits. Setting the
+  `--jax_lazy_eager` flag enables the same behavior globally. The context
+  manager applies only to the calling thread, and each thread records its own
+  pending graph.
+
+  >>> with jax.lazy_eager():
+  ...   x = np.arange(10.)
+  ...   y = np.exp(np.sin(x) * 2. + 1.)  # no computation dispatched yet
+  ...   print(y.sum())  # executes all of the above as one XLA computation
+  """
+  state = xla._lazy_eager_state
+  try:
+    state.enabled, prev_val = True, state.enabled
+    yield
+  finally:
+    state.enabled = prev_val
+    xla.flush_lazy_eager()
+
+
+@contextmanager
+def cache_traces():
+  """Context manager that caches the traces of `grad`, `vjp`, `jvp` and `vmap`.
+
+  Each application of a transformation normally re-traces the Python function
+  it transforms. Under `cache_traces`, transformations applied outside of any
+  other transformation are traced once per distinct function and argument
+  shapes/dtypes to a jaxpr, and later calls evaluate the cached jaxpr instead.
+  Like `jit`, this means Python side effects only run while tracing; functions
+  whose Python control flow depends on argument values fall back to re-tracing,
+  and globals or other Python state that a function reads are baked into its
+  cached trace, so calls made after mutating that state return stale results.
+  Traces are dropped when the function they came from is garbage collected.
+  Setting the `--jax_trace_cache` flag enables the same behavior globally.
+
+  >>> with jax.cache_traces():
+  ...   for x in xs:
+  ...     g = jax.grad(f)(x)  # f is only traced for the first x
+  """
+  try:
+    pe._trace_cache_enabled, prev_val = True, pe._trace_cache_enabled
+    yield
+  finally:
+    pe._trace_cache_enabled = prev_val
+
+
+def trace_cache_info():
+  """Returns the hit and miss counts of the transformation trace cache.
+
+  Returns:
+    A namedtuple `(hits, misses, maxsize, currsize)` describing the cache used
+    under `cache_traces`.
+  """
+  return pe.trace_cache_info()
+
+
 def xla_computation(fun, static_argnums=(), axis_env=None):
   """Creates a function that produces its XLA computation given example args.
 
@@ -863,7 +929,11 @@ def jvp(fun, primals, tangents):
     fun = lu.wrap_init(fun)
   ps_flat, ts_flat, in_trees = unzip3(map(trim_arg, primals, tangents))
   jaxtree_fun, out_tree = pytree_fun_to_jaxtupletree_fun(fun, in_trees)
-  out_primal, out_tangent = ad.jvp(jaxtree_fun).call_wrapped(ps_flat, ts_flat)
+  if pe.trace_cache_enabled():
+    out_primal, out_tangent = pe.call_traced(
+        ad.pack_output(ad.jvp(jaxtree_fun)), pack(ps_flat), pack(ts_flat))
+  else:
+    out_primal, out_tangent = ad.jvp(jaxtree_fun).call_wrapped(ps_flat, ts_flat)
   return (build_tree(out_tree(), out_primal), build_tree(out_tree(), out_tangent))
 
 def linearize(fun, *primals):
@@ -16,10 +16,11 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+import itertools as it
 from operator import attrgetter
 from contextlib import contextmanager
 from collections import namedtuple, Counter, defaultdict
-from weakref import ref
+from weakref import ref, WeakKeyDictionary
 import types
 
 import six
@@ -186,7 +187,7 @@ def eval_jaxpr(jaxpr, consts, freevar_vals, *args):
   pat_fmap(write, jaxpr.constvars, consts)
   pat_fmap(write, jaxpr.invars, args)
   pat_fmap(write, jaxpr.freevars, freevar_vals)
-  for eqn in jaxpr.eqns:
+  for eqn, dead_vars in zip(jaxpr.eqns, _dead_vars(jaxpr)):
     if not eqn.restructure:
       in_vals = map(read, eqn.invars)
     else:
@@ -200,8 +201,46 @@ def eval_jaxpr(jaxpr, consts, freevar_vals, *args):
     ans = eqn.primitive.bind(*(subfuns + in_vals), **eqn.params)
     outvals = list(ans) if eqn.destructure else [ans]
     map(write, eqn.outvars, outvals)
+    for v in dead_vars:
+      del env[v]
   return read(jaxpr.outvar)
 
+def _dead_vars(jaxpr):
+  """Lists, for each equation, the variables no longer needed after it.
+
+  Each variable is listed once, at its last read (or at its definition if it is
+  never read), so `eval_jaxpr` can release intermediates as early as possible
+  rather than holding them all until the jaxpr finishes.
+  """
+  cached = _dead_vars_cache.get(jaxpr)
+  if cached and cached[0] is jaxpr.eqns and cached[1] is jaxpr.outvar:
+    return cached[2]
+
+  last_use = {}
+  for i, eqn in enumerate(jaxpr.eqns):
+    read_vars = it.chain(_pat_vars(eqn.invars), *[
+        it.chain(const_bindings, freevar_bindings)
+        for _, const_bindings, freevar_bindings in eqn.bound_subjaxprs])
+    for v in it.chain(read_vars, eqn.outvars):
+      if type(v) is not Literal:
+        last_use[v] = i
+  if type(jaxpr.outvar) is not Literal:
+    last_use.pop(jaxpr.outvar, None)
+
+  dead_vars = [[] for _ in jaxpr.eqns]
+  for v, i in last_use.items():
+    dead_vars[i].append(v)
+  _dead_vars_cache[jaxpr] = (jaxpr.eqns, jaxpr.outvar, dead_vars)
+  return dead_vars
+
+_dead_vars_cache = WeakKeyDictionary()
+
+def _pat_vars(v):
+  if type(v) in (tuple, list):
+    return [x for y in v for x in _pat_vars(y)]
+  else:
+    return [v]
+
 
 def pat_fmap(f, v, *xs):
   if type(v) in (tuple, list):
@@ -89,6 +89,11 @@ def linearize(traceable, *primals, **kwargs):
     jvpfun, aux = jvp(traceable, has_aux=True)
     jvpfun = pack_output(jvpfun)
   tangent_avals = [get_aval(p).at_least_vspace() for p in primals]
+  if not has_aux and pe.trace_cache_enabled():
+    fun, aux = linearize_subtrace(jvpfun, tuple(tangent_avals))
+    const_primal, const_tangent, consts = pe.call_traced(fun, pack(primals))
+    jaxpr, pv_tangent = aux()
+    return const_primal, (pv_tangent, const_tangent), jaxpr, consts
   in_pvals = (pe.PartialVal((None, pack(primals))),
               pe.PartialVal((core.AbstractTuple(tangent_avals), core.unit)))
   jaxpr, out_pval, consts = pe.trace_to_jaxpr(jvpfun, in_pvals)
@@ -100,6 +105,26 @@ def linearize(traceable, *primals, **kwargs):
   else:
     return const_primal, pval_tangent, jaxpr, consts, aux()
 
+@transformation_with_aux
+def linearize_subtrace(tangent_avals, primals):
+  # Like the partial evaluation in `linearize`, but as a transformation of
+  # `primals` alone, so that pe.call_traced can cache it.
+  with new_master(pe.JaxprTrace) as master:
+    trace = pe.JaxprTrace(master, core.cur_sublevel())
+    in_pvals = (pe.PartialVal((None, primals)),
+                pe.PartialVal((core.AbstractTuple(tangent_avals), core.unit)))
+    in_tracers = map(trace.new_arg, in_pvals)
+    ans = yield in_tracers, {}
+    out_tracer = trace.full_raise(ans)
+    jaxpr, consts, env = pe.tracers_to_jaxpr(in_tracers, out_tracer)
+    assert not env
+    pval_primal, pval_tangent = unpair_pval(out_tracer.pval)
+    aval_primal, const_primal = pval_primal
+    assert aval_primal is None
+    pv_tangent, const_tangent = pval_tangent
+    del master, trace, in_tracers, out_tracer
+  yield pack((const_primal, const_tangent, pack(consts))), (jaxpr, pv_tangent)
+
 def vjp(traceable, primals, has_aux=False):
   if not has_aux:
     out_primal, pval, jaxpr, consts = linearize(traceable, *primals)
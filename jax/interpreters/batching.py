@@ -42,7 +42,10 @@ def batch(fun, in_vals, in_dims, out_dim_dst):
     return fun.call_wrapped(*in_vals), None  # no mapped dimensions
   elif len(sizes) == 1:
     sz = sizes.pop()
-    return batch_transform(fun, sz, in_dims, out_dim_dst).call_wrapped(in_vals)
+    batched_fun = batch_transform(fun, sz, in_dims, out_dim_dst)
+    if pe.trace_cache_enabled():
+      return pe.call_traced(batched_fun, pack(in_vals))
+    return batched_fun.call_wrapped(in_vals)
   else:
     raise TypeError("got inconsistent map dimension sizes: {}".format(sizes))
 
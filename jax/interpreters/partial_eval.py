@@ -16,14 +16,20 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+from distutils.util import strtobool
 import itertools as it
-from collections import namedtuple, Counter, defaultdict
+from collections import namedtuple, Counter, defaultdict, OrderedDict
+import os
+import threading
+import weakref
 
 import numpy as onp
 
+from ..config import flags
 from .. import core
 from .. import linear_util as lu
-from ..abstract_arrays import ShapedArray, ConcreteArray
+from ..abstract_arrays import (ShapedArray, ConcreteArray, raise_to_shaped,
+                               ConcretizationTypeError)
 from ..linear_util import thunk, transformation, transformation_with_aux
 from ..util import unzip2, safe_zip, safe_map, toposort, partial
 from ..core import (Trace, Tracer, new_master, Jaxpr, JaxprEqn, Literal,
@@ -34,6 +40,12 @@ map = safe_map
 zip = safe_zip
 def identity(x): return x
 
+FLAGS = flags.FLAGS
+flags.DEFINE_bool('jax_trace_cache',
+                  strtobool(os.getenv('JAX_TRACE_CACHE', "False")),
+                  'Cache the jaxprs traced by grad, vjp, jvp and vmap when '
+                  'they are applied outside of any other transformation.')
+
 # A partial value (pval) is modeled as a pair (pv, const), as per
 #   type PVal = (PV, Const)
 #   data PV = NonePV | AbstractPV AbstractValue | JaxprTracerTuple [PV]
@@ -417,6 +429,107 @@ def trace_to_subjaxpr(master, instantiate, pvals):
   del trace, in_tracers, out_tracer
   yield jaxpr, (out_pval, consts, env)
 
+def call_traced(fun, *args):
+  """Calls `fun` on `args`, reusing a cached jaxpr for `fun` when possible.
+
+  When trace caching is enabled and no trace is active, `fun` is traced
+  to a jaxpr once per distinct set of argument avals and the jaxpr is evaluated
+  on subsequent calls. Functions that can't be traced abstractly (e.g. because
+  of Python control flow on argument values) fall back to being called
+  directly. As with `jit`, Python state that the function reads, such as
+  globals, is baked into the jaxpr: calls after that state is mutated return
+  results computed from the old values.
+  """
+  if (trace_cache_enabled() and not core.trace_stack.upward
+      and not core.trace_stack.downward):
+    try:
+      avals = tuple(raise_to_shaped(get_aval(x)) for x in args)
+      key = (fun.hashable_payload()[1:], avals)
+      hash(key)
+      entries = _trace_cache.entries(fun.f)
+    except TypeError:
+      entries = None  # unhashable parameters, unknown types or no weakrefs
+    # Errors raised while tracing, other than the function needing concrete
+    # values, propagate rather than being retried on the uncached path.
+    if entries is not None:
+      hit = _trace_cache.get(entries, key)
+      if hit is None:
+        hit = _trace_to_jaxpr(fun, avals)  # fills the stores of `fun`
+        _trace_cache.put(entries, key, hit)
+      elif hit[0] is not None:
+        for (_, _, store), val in zip(fun.transforms, hit[1]):
+          if store is not None:
+            store.store(val)
+      traced = hit[0]
+      if traced is not None:
+        jaxpr, out_pval, consts = traced
+        return merge_pvals(core.eval_jaxpr(jaxpr, consts, (), *args), out_pval)
+  return fun.call_wrapped(*args)
+
+def _trace_to_jaxpr(fun, avals):
+  pvals = [PartialVal((aval, unit)) for aval in avals]
+  try:
+    traced = trace_to_jaxpr(fun, pvals)
+  except ConcretizationTypeError:
+    return None, None
+  return traced, tuple(store.val if store is not None else None
+                 for _, _, store in fun.transforms)
+
+class _TraceCache(object):
+  """Traced jaxprs, weakly keyed on the Python function that was traced.
+
+  Entries don't keep the function, or the values it closes over, alive: they
+  are dropped along with the function. Each function keeps its
+  `max_size_per_fun` most recently used traces.
+  """
+
+  def __init__(self, max_size_per_fun):
+    self.max_size_per_fun = max_size_per_fun
+    self.by_fun = weakref.WeakKeyDictionary()
+    self.lock = threading.Lock()
+    self.hits = self.misses = 0
+
+  def entries(self, f):
+    with self.lock:
+      entries = self.by_fun.get(f)
+      if entries is None:
+        entries = self.by_fun[f] = OrderedDict()
+      return entries
+
+  def get(self, entries, key):
+    with self.lock:
+      hit = entries.pop(key, None)
+      if hit is None:
+        self.misses += 1
+      else:
+        self.hits += 1
+        entries[key] = hit
+      return hit
+
+  def put(self, entries, key, hit):
+    with self.lock:
+      entries[key] = hit
+      if len(entries) > self.max_size_per_fun:
+        entries.popitem(last=False)
+
+  def info(self):
+    with self.lock:
+      size = sum(len(entries) for entries in self.by_fun.values())
+      return _TraceCacheInfo(self.hits, self.misses, None, size)
+
+_TraceCacheInfo = namedtuple('_TraceCacheInfo',
+                             ['hits', 'misses', 'maxsize', 'currsize'])
+_trace_cache = _TraceCache(max_size_per_fun=32)
+
+_trace_cache_enabled = False
+
+def trace_cache_enabled():
+  return _trace_cache_enabled or FLAGS.jax_trace_cache
+
+def trace_cache_info():
+  """Returns (hits, misses, maxsize, currsize) of the trace cache."""
+  return _trace_cache.info()
+
 def instantiate_const_at(trace, instantiate, tracer):
   t = type(instantiate)
   if t is tuple:
@@ -498,6 +611,8 @@ def gensym(suffix):
   return lambda: Var(next(counter), suffix)
 
 class Var(object):
+  __slots__ = ["count", "suffix"]
+
   def __init__(self, count, suffix):
     self.count = count
     self.suffix = suffix
@@ -17,10 +17,16 @@ from __future__ import division
 from __future__ import print_function
 
 from collections import namedtuple, defaultdict
+from contextlib import contextmanager
 from distutils.util import strtobool
 import itertools as it
 import operator as op
 import os
+import threading
+import time
+import traceback
+from warnings import warn
+import weakref
 
 import numpy as onp
 import six
@@ -47,21 +53,50 @@ flags.DEFINE_bool('jax_device_values',
 flags.DEFINE_bool('jax_debug_nans',
                   strtobool(os.getenv('JAX_DEBUG_NANS', "False")),
                   'Add nan checks to every operation.')
+flags.DEFINE_bool('jax_lazy_eager',
+                  strtobool(os.getenv('JAX_LAZY_EAGER', "False")),
+                  'Record primitives applied outside of jit and execute them '
+                  'as one fused XLA computation when a result is observed.')
+flags.DEFINE_integer('jax_lazy_eager_max_ops',
+                     int(os.getenv('JAX_LAZY_EAGER_MAX_OPS', 256)),
+                     'Number of pending primitive applications after which '
+                     'lazy eager mode flushes its graph.')
+flags.DEFINE_bool('jax_memory_accounting',
+                  strtobool(os.getenv('JAX_MEMORY_ACCOUNTING', "False")),
+                  'Track the device buffers held by live DeviceArrays and '
+                  'DeviceTuples (see xla.device_memory_snapshot).')
+flags.DEFINE_integer('jax_memory_call_site_sampling',
+                     int(os.getenv('JAX_MEMORY_CALL_SITE_SAMPLING', 0)),
+                     'Record the creating call site of every N-th buffer '
+                     'tracked by jax_memory_accounting; 0 disables it.')
+flags.DEFINE_integer('jax_recompilation_warning_threshold',
+                     int(os.getenv('JAX_RECOMPILATION_WARNING_THRESHOLD', 32)),
+                     'Warn when a jitted function is compiled for more than '
+                     'this many argument signatures; 0 disables it.')
+flags.DEFINE_bool('jax_compile_stats_hlo_sizes',
+                  strtobool(os.getenv('JAX_COMPILE_STATS_HLO_SIZES', "False")),
+                  'Record the HLO instruction count and serialized size of '
+                  'each compiled computation in xla.compile_stats().')
 
 def apply_primitive(prim, *args, **params):
   """Impl rule that compiles and runs a single primitive 'prim' using XLA."""
+  if _lazy_eager_state.enabled or FLAGS.jax_lazy_eager:
+    return _apply_primitive_lazily(prim, *args, **params)
   abstract_args = map(abstractify, args)
   compiled_fun = _xla_primitive_callable(prim, *abstract_args, **params)
   return compiled_fun(*args)
 
 @memoize
 def _xla_primitive_callable(prim, *abstract_args, **params):
+  start_time = _monotonic()
   shapes = tuple(map(xla_shape, abstract_args))
   built_c = primitive_computation(prim, *shapes, **params)
   result_shape = xla_shape_to_result_shape(built_c.GetReturnValueShape())
   handle_result = result_handler(result_shape)
   compiled = built_c.Compile(shapes, xb.get_compile_options(),
                              backend=xb.get_backend())
+  _record_compile(prim, prim.name, _signature_str(abstract_args), 0.,
+                  _monotonic() - start_time, built_c, warn_recompiles=False)
   return partial(_execute_compiled_primitive, prim.name, compiled, handle_result)
 
 def xla_shape(x):
@@ -83,9 +118,11 @@ def primitive_computation(prim, *shapes, **params):
     rule = backend_specific_translations[platform].get(prim) or translations[prim]
   except KeyError:
     raise NotImplementedError("XLA translation rule for {} not found".format(prim))
-  rule(c, *xla_args, **params)  # return val set as a side-effect on c
+  ans = rule(c, *xla_args, **params)
   try:
-    return c.Build()
+    # Rules may build ops after their result (e.g. a custom call's unused
+    # outputs), so the result isn't necessarily the last op built.
+    return c.Build(ans)
   except RuntimeError as e:
     # try for a better error message by using the abstract_eval checks
     prim.abstract_eval(*map(_aval_from_xla_shape, shapes), **params)
@@ -144,6 +181,8 @@ def device_put(x, device_num=0):
   x = _canonicalize_pyval_dtype(x)
   t = type(x)
   if t is DeviceArray or t is DeviceTuple:
+    if type(x.device_buffer) is _LazyBuffer:
+      x.device_buffer = x.device_buffer.force()
     if x.device_buffer.device() == device_num:
       return x.device_buffer
     else:
@@ -224,7 +263,7 @@ def _compile_jaxpr(jaxpr, device_assignment, axis_env, const_vals, *abstract_arg
   compile_opts = xb.get_compile_options(num_replicas=axis_env.nreps,
                                         device_assignment=device_assignment)
   compiled_c = built_c.Compile(arg_shapes, compile_opts, backend=xb.get_backend())
-  return compiled_c, result_shape
+  return compiled_c, result_shape, built_c
 
 def build_jaxpr(jaxpr, axis_env, const_vals, *abstract_args):
   arg_shapes = list(map(xla_shape, abstract_args))
@@ -232,6 +271,67 @@ def build_jaxpr(jaxpr, axis_env, const_vals, *abstract_args):
   return built_c
 
 
+# Compilation statistics. Each time _xla_callable or _xla_primitive_callable
+# compiles a computation, a CompileEvent is recorded against the traced Python
+# function (or the primitive), so that functions that are recompiled often, and
+# the argument signatures that triggered it, can be found with compile_stats().
+# Primitives are expected to be compiled for many signatures when run op by op,
+# so only jitted functions trigger the recompilation warning.
+
+_monotonic = getattr(time, 'monotonic', time.time)  # Python 2 has no monotonic
+
+CompileEvent = namedtuple('CompileEvent', [
+    'signature', 'trace_time', 'compile_time', 'num_hlo_instructions',
+    'hlo_proto_bytes'])
+CompileStats = namedtuple('CompileStats', ['name', 'events', 'signatures'])
+
+_compile_stats = weakref.WeakKeyDictionary()
+
+def _record_compile(fun, name, signature, trace_time, compile_time, built_c,
+                    warn_recompiles=True):
+  try:
+    stats = _compile_stats.get(fun)
+    if stats is None:
+      stats = _compile_stats[fun] = CompileStats(name, [], defaultdict(int))
+  except TypeError:
+    return  # fun can't be weakly referenced
+  if FLAGS.jax_compile_stats_hlo_sizes:
+    hlo_text = built_c.GetHloText()
+    num_instructions = sum(1 for line in hlo_text.splitlines() if ' = ' in line)
+    proto_bytes = len(built_c.GetSerializedProto())
+  else:
+    num_instructions = proto_bytes = None
+  stats.events.append(CompileEvent(signature, trace_time, compile_time,
+                                   num_instructions, proto_bytes))
+  stats.signatures[signature] += 1
+
+  threshold = FLAGS.jax_recompilation_warning_threshold
+  if (warn_recompiles and threshold and stats.signatures[signature] == 1
+      and len(stats.signatures) == threshold + 1):
+    msg = ("{} has been compiled for {} different argument signatures, most "
+           "recently {}. Frequent recompilation usually means it is being "
+           "called with changing shapes, dtypes or static arguments.")
+    warn(msg.format(name, len(stats.signatures), signature))
+
+def _signature_str(abstract_args):
+  return '({})'.format(', '.join(
+      a.str_short() if hasattr(a, 'str_short') else str(a)
+      for a in abstract_args))
+
+def compile_stats():
+  """Returns statistics about the XLA computations compiled so far.
+
+  Returns:
+    A dict mapping each jitted Python function, and each primitive executed op
+    by op, that is still alive to a CompileStats(name, events, signatures).
+    `events` lists a CompileEvent(signature, trace_time, compile_time,
+    num_hlo_instructions, hlo_proto_bytes) per compilation, with times in
+    seconds; `signatures` counts the compilations per argument signature. The
+    HLO sizes are None unless the jax_compile_stats_hlo_sizes flag is set.
+  """
+  return dict(_compile_stats)
+
+
 def _prefetch_jaxpr_literals(jaxpr):
   """Prefetches any DeviceArray values inside a jaxpr to the host."""
   for eqn in jaxpr.eqns:
@@ -251,6 +351,7 @@ def _jaxpr_computation(jaxpr, axis_env, const_vals, freevar_shapes, *arg_shapes)
   assert not any(type(invar) in (tuple, list) for invar in jaxpr.invars)
   c = xb.make_computation_builder("jaxpr_computation")
   platform = xb.get_backend().platform
+  platform_translations = backend_specific_translations[platform]
 
   def read(v):
     if type(v) is Literal:
@@ -282,8 +383,8 @@ def _jaxpr_computation(jaxpr, axis_env, const_vals, freevar_shapes, *arg_shapes)
       in_nodes = [xla_pack(c, map(read, invars)) if type(invars) is tuple
                   else read(invars) for invars in eqn.invars]
 
-    if eqn.primitive in backend_specific_translations[platform]:
-      rule = backend_specific_translations[platform][eqn.primitive]
+    if eqn.primitive in platform_translations:
+      rule = platform_translations[eqn.primitive]
       ans = rule(c, *in_nodes, **eqn.params)
     elif eqn.primitive in translations:
       ans = translations[eqn.primitive](c, *in_nodes, **eqn.params)
@@ -460,7 +561,7 @@ for _t in array_types:
 
 class DeviceValue(object):
   """A DeviceValue represents a value backed by device memory."""
-  __slots__ = ["device_buffer"]
+  __slots__ = ["device_buffer", "__weakref__"]
   def __init__(self, device_buffer):
     self.device_buffer = device_buffer
 
@@ -486,11 +587,17 @@ class DeviceTuple(DeviceValue):
   def __init__(self, result_shape, device_buffer):
     self.device_buffer = device_buffer
     self.aval, self.result_shapes = result_shape
+    if FLAGS.jax_memory_accounting:
+      _memory_tracker.track(self, self.aval)
 
   def __iter__(self):
     bufs = self.device_buffer.destructure()
     handlers = map(_device_persistent_result_handler, self.result_shapes)
-    elts = [handler(buf) for handler, buf in zip(handlers, bufs)]
+    if FLAGS.jax_memory_accounting:
+      with _memory_tracker.sharing_buffers_of(self):
+        elts = [handler(buf) for handler, buf in zip(handlers, bufs)]
+    else:
+      elts = [handler(buf) for handler, buf in zip(handlers, bufs)]
     return iter(elts)
 
   def __len__(self):
@@ -533,6 +640,8 @@ class DeviceArray(DeviceValue):
     self.device_buffer = device_buffer
     self.shape, self.dtype = result_shape
     self._npy_value = None
+    if FLAGS.jax_memory_accounting:
+      _memory_tracker.track(self, ShapedArray(self.shape, self.dtype))
 
   @property
   def _value(self):
@@ -573,6 +682,7 @@ class DeviceArray(DeviceValue):
     """
     self.device_buffer.delete()
     self.device_buffer = None
+    _memory_tracker.untrack(id(self))
     self._npy_value = None
 
   def __repr__(self):
@@ -677,6 +787,312 @@ def _instantiate_device_constant(const, cutoff=1e6, device_num=0):
     return xla_client.Buffer.from_pyval(onp.asarray(const), device_num,
                                         backend=xb.get_backend())
 
+
+# Device memory accounting. When the jax_memory_accounting flag is set, every
+# DeviceArray and DeviceTuple registers the buffers it holds with
+# _memory_tracker when it's created, and releases them when the value is
+# deleted or garbage collected. Bytes are counted once per leaf array buffer: the
+# elements produced by destructuring a DeviceTuple hold the tuple's records
+# rather than new ones, and a buffer's record is dropped when no value holds it
+# any more. Values with a pending lazy buffer are registered when the buffer is
+# forced, on the device it lands on. ShardedDeviceValues created by pmap aren't
+# tracked.
+
+LiveBuffer = namedtuple('LiveBuffer', ['device', 'nbytes', 'call_site'])
+DeviceMemorySnapshot = namedtuple(
+    'DeviceMemorySnapshot', ['buffers', 'bytes_in_use', 'peak_bytes_in_use'])
+
+class _DeviceMemoryTracker(object):
+  def __init__(self):
+    self.live = {}     # id(value) -> (weakref, serial numbers of its buffers)
+    self.buffers = {}  # serial number -> LiveBuffer
+    self.holders = {}  # serial number -> number of live values holding it
+    self.bytes_in_use = defaultdict(int)
+    self.peak_bytes_in_use = defaultdict(int)
+    self.num_tracked = 0
+    self.shared = None  # iterator over serials handed to new values, if any
+
+  def track(self, x, aval):
+    buf = x.device_buffer
+    if type(buf) is _LazyBuffer:
+      if buf.buffer is None:
+        buf.holders.append(weakref.ref(x))  # tracked by _flush_lazy_graph
+        return
+      buf = buf.buffer
+    if self.shared is not None:
+      serials = list(it.islice(self.shared, _aval_num_leaves(aval)))
+    else:
+      device = buf.device()
+      serials = [self._new_buffer(device, nbytes)
+                 for nbytes in _aval_leaf_nbytes(aval)]
+    key = id(x)
+    ref = weakref.ref(x, lambda _: self.untrack(key))
+    self.live[key] = (ref, serials)
+    for serial in serials:
+      self.holders[serial] += 1
+
+  def _new_buffer(self, device, nbytes):
+    rate = FLAGS.jax_memory_call_site_sampling
+    sampled = rate and self.num_tracked % rate == 0
+    serial = self.num_tracked
+    self.num_tracked += 1
+    self.buffers[serial] = LiveBuffer(device, nbytes,
+                                      _user_call_site() if sampled else None)
+    self.holders[serial] = 0
+    self.bytes_in_use[device] += nbytes
+    self.peak_bytes_in_use[device] = max(self.peak_bytes_in_use[device],
+                                         self.bytes_in_use[device])
+    return serial
+
+  def untrack(self, key):
+    record = self.live.pop(key, None)
+    if record is not None:
+      for serial in record[1]:
+        self.holders[serial] -= 1
+        if not self.holders[serial]:
+          del self.holders[serial]
+          entry = self.buffers.pop(serial)
+          self.bytes_in_use[entry.device] -= entry.nbytes
+
+  @contextmanager
+  def sharing_buffers_of(self, x):
+    """Values tracked in this context hold the buffers of `x`, in leaf order."""
+    record = self.live.get(id(x))
+    prev, self.shared = self.shared, record and iter(record[1])
+    try:
+      yield
+    finally:
+      self.shared = prev
+
+_memory_tracker = _DeviceMemoryTracker()
+
+def _aval_leaf_nbytes(aval):
+  if type(aval) is AbstractTuple:
+    return [n for elt in aval for n in _aval_leaf_nbytes(elt)]
+  else:
+    return [prod(aval.shape) * onp.dtype(aval.dtype).itemsize]
+
+def _aval_num_leaves(aval):
+  if type(aval) is AbstractTuple:
+    return sum(map(_aval_num_leaves, aval))
+  else:
+    return 1
+
+_jax_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+def _user_call_site():
+  for filename, lineno, name, _ in reversed(traceback.extract_stack()):
+    if not os.path.abspath(filename).startswith(_jax_dir):
+      return "{}:{} ({})".format(filename, lineno, name)
+  return None
+
+def device_memory_snapshot():
+  """Returns the device buffers tracked under the jax_memory_accounting flag.
+
+  Returns:
+    A DeviceMemorySnapshot whose `buffers` maps a serial number, unique to each
+    tracked buffer, to a LiveBuffer(device, nbytes, call_site) for every live
+    array buffer (a DeviceTuple contributes one per leaf); `bytes_in_use` and
+    `peak_bytes_in_use` map device numbers to byte counts. `call_site` is None
+    unless the buffer was sampled by the jax_memory_call_site_sampling flag.
+  """
+  t = _memory_tracker
+  return DeviceMemorySnapshot(dict(t.buffers), dict(t.bytes_in_use),
+                              dict(t.peak_bytes_in_use))
+
+def device_memory_snapshot_diff(before, after):
+  """Returns a DeviceMemorySnapshot of what changed between two snapshots.
+
+  The `buffers` of the result are those live in `after` but not in `before`
+  (e.g. buffers leaked by a training step), and `bytes_in_use` holds the change
+  in bytes in use per device.
+  """
+  buffers = {serial: entry for serial, entry in after.buffers.items()
+             if serial not in before.buffers}
+  devices = set(before.bytes_in_use) | set(after.bytes_in_use)
+  bytes_in_use = {d: (after.bytes_in_use.get(d, 0)
+                      - before.bytes_in_use.get(d, 0)) for d in devices}
+  return DeviceMemorySnapshot(buffers, bytes_in_use, after.peak_bytes_in_use)
+
+def reset_peak_device_memory():
+  """Resets the peak bytes in use on each device to the current bytes in use."""
+  _memory_tracker.peak_bytes_in_use = defaultdict(
+      int, _memory_tracker.bytes_in_use)
+
+
+# Lazy op-by-op execution. When lazy eager mode is enabled (via the
+# jax_lazy_eager flag or the api.lazy_eager context manager), apply_primitive
+# doesn't compile and execute each primitive on its own. Instead it records the
+# application into a pending graph and returns a DeviceArray whose device_buffer
+# is a _LazyBuffer placeholder. The whole graph is built into a single XLA
+# computation, compiled (cached on the structure of the graph) and executed the
+# first time any of its buffers is needed, e.g. by __array__, printing, bool()
+# or passing the value to a jitted function, or when the graph grows past
+# FLAGS.jax_lazy_eager_max_ops equations. Only the outputs that are still
+# referenced at that point are materialized; every other intermediate is fused
+# away by XLA. Each thread records into its own pending graph, but a value from
+# one thread's graph may be forced from another, so flushes take the graph's
+# lock. Pending values from another graph are forced before they are recorded,
+# so a graph's arguments are always concrete and a flush never needs a second
+# graph's lock while holding its own.
+
+class _LazyBuffer(object):
+  """Placeholder for the device buffer of a pending lazily-executed primitive.
+
+  Implements the subset of the xla_client.Buffer interface used by DeviceArray,
+  forcing the pending graph to execute the first time it is used.
+  """
+  __slots__ = ["graph", "index", "buffer", "holders", "__weakref__"]
+
+  def __init__(self, graph, index):
+    self.graph = graph
+    self.index = index
+    self.buffer = None
+    self.holders = []  # weakrefs to DeviceArrays awaiting memory accounting
+
+  def force(self):
+    if self.buffer is None:
+      _flush_lazy_graph(self.graph)
+    return self.buffer
+
+  def to_py(self):
+    return self.force().to_py()
+
+  def shape(self):
+    return self.force().shape()
+
+  def device(self):
+    return self.force().device()
+
+  def copy_to_device(self, device_num):
+    return self.force().copy_to_device(device_num)
+
+  def copy_to_host_async(self):
+    self.force().copy_to_host_async()
+
+  def block_host_until_ready(self):
+    self.force().block_host_until_ready()
+
+  def delete(self):
+    if self.buffer is not None:
+      self.buffer.delete()
+      self.buffer = None
+
+
+class _LazyGraph(object):
+  """A pending graph of primitive applications, in topological order."""
+  __slots__ = ["eqns", "args", "arg_avals", "arg_ids", "outs", "lock"]
+
+  def __init__(self):
+    self.eqns = []       # (primitive, input refs, params items) triples
+    self.args = []       # concrete values fed to the graph as parameters
+    self.arg_avals = []
+    self.arg_ids = {}    # id(arg) -> parameter number, to dedup arguments
+    self.outs = []       # weakrefs to the _LazyBuffer of each equation
+    self.lock = threading.Lock()
+
+  def read(self, x, aval):
+    buf = x.device_buffer if type(x) is DeviceArray else None
+    if type(buf) is _LazyBuffer and buf.graph is self:
+      return ('eqn', buf.index)
+    i = self.arg_ids.get(id(x))
+    if i is None:
+      i = self.arg_ids[id(x)] = len(self.args)
+      self.args.append(x)
+      self.arg_avals.append(aval)
+    return ('arg', i)
+
+class _LazyEagerState(threading.local):
+  def __init__(self):
+    self.enabled = False  # set by api.lazy_eager
+    self.graph = _LazyGraph()
+
+_lazy_eager_state = _LazyEagerState()
+
+def _apply_primitive_lazily(prim, *args, **params):
+  abstract_args = tuple(map(abstractify, args))
+  platform = xb.get_backend().platform
+  rule = (backend_specific_translations[platform].get(prim)
+          or translations.get(prim))
+  out_aval = None
+  if rule and all(type(a) is ShapedArray for a in abstract_args):
+    try:
+      out_aval = prim.abstract_eval(*abstract_args, **params)
+    except NotImplementedError:
+      pass
+  if type(out_aval) is not ShapedArray:
+    # Tuples and primitives without a plain translation rule run eagerly; any
+    # pending arguments are forced when they are transferred to the device.
+    compiled_fun = _xla_primitive_callable(prim, *abstract_args, **params)
+    return compiled_fun(*args)
+
+  graph = _lazy_eager_state.graph
+  for x in args:
+    buf = x.device_buffer if type(x) is DeviceArray else None
+    if type(buf) is _LazyBuffer and buf.graph is not graph:
+      buf.force()
+  with graph.lock:
+    if graph.eqns is None:
+      # Another thread forced one of this thread's pending values.
+      graph = _lazy_eager_state.graph = _LazyGraph()
+    in_refs = tuple(map(graph.read, args, abstract_args))
+    buf = _LazyBuffer(graph, len(graph.eqns))
+    graph.eqns.append((prim, in_refs, tuple(sorted(params.items()))))
+    graph.outs.append(weakref.ref(buf))
+    num_eqns = len(graph.eqns)
+  out = DeviceArray((out_aval.shape, out_aval.dtype), buf)
+  if num_eqns >= FLAGS.jax_lazy_eager_max_ops:
+    _flush_lazy_graph(graph)
+  return out
+
+def _flush_lazy_graph(graph):
+  """Executes `graph`, storing its live outputs in their _LazyBuffers."""
+  if graph is _lazy_eager_state.graph:
+    _lazy_eager_state.graph = _LazyGraph()
+  with graph.lock:
+    if graph.eqns is None:
+      return  # already flushed
+    live = tuple(i for i, ref in enumerate(graph.outs) if ref() is not None)
+    if live:
+      arg_shapes = tuple(map(xla_shape, graph.arg_avals))
+      compiled = _lazy_graph_callable(tuple(graph.eqns), arg_shapes, live)
+      device_num, = compiled.DeviceOrdinals()
+      input_bufs = [device_put(x, device_num) for x in graph.args]
+      out_buf = compiled.Execute(input_bufs)
+      check_nans("lazily executed computation", out_buf)
+      for i, buf in zip(live, out_buf.destructure()):
+        lazy_buf = graph.outs[i]()
+        if lazy_buf is not None:
+          lazy_buf.buffer = buf
+          lazy_buf.graph = None
+          for ref in lazy_buf.holders:
+            x = ref()
+            if x is not None:
+              _memory_tracker.track(x, ShapedArray(x.shape, x.dtype))
+          lazy_buf.holders = None
+    graph.eqns = graph.args = graph.arg_avals = graph.outs = None
+    graph.arg_ids = None
+
+# Each entry pins a compiled executable, and the keys are whole graphs, so only
+# the most recent few are kept.
+@partial(memoize, max_size=64)
+def _lazy_graph_callable(eqns, arg_shapes, live):
+  c = xb.make_computation_builder("lazy_eager_computation")
+  platform = xb.get_backend().platform
+  args = list(map(c.ParameterWithShape, arg_shapes))
+  nodes = []
+  for prim, in_refs, params in eqns:
+    in_nodes = [args[i] if kind == 'arg' else nodes[i] for kind, i in in_refs]
+    rule = backend_specific_translations[platform].get(prim) or translations[prim]
+    nodes.append(rule(c, *in_nodes, **dict(params)))
+  built_c = c.Build(c.Tuple(*[nodes[i] for i in live]))
+  return built_c.Compile(arg_shapes, xb.get_compile_options(),
+                         backend=xb.get_backend())
+
+def flush_lazy_eager():
+  """Executes the calling thread's pending lazy eager primitive applications."""
+  _flush_lazy_graph(_lazy_eager_state.graph)
+
 def _xla_call_impl(fun, *args, **params):
   device_values = FLAGS.jax_device_values and params.pop('device_values')
   device_assignment = params.pop('device_assignment')
@@ -692,13 +1108,17 @@ def _xla_call_impl(fun, *args, **params):
 @lu.memoize
 def _xla_callable(fun, device_assignment, device_values, *abstract_args):
   pvals = [pe.PartialVal((aval, core.unit)) for aval in abstract_args]
+  start_time = _monotonic()
   with core.new_master(pe.JaxprTrace, True) as master:
     jaxpr, (pval, consts, env) = pe.trace_to_subjaxpr(fun, master, False).call_wrapped(pvals)
     assert not env  # no subtraces here (though cond might eventually need them)
+    trace_time = _monotonic() - start_time
     axis_env = AxisEnv(jaxpr_replicas(jaxpr), [], [])
-    compiled, result_shape = _compile_jaxpr(jaxpr, device_assignment, axis_env, consts,
-                                            *abstract_args)
+    compiled, result_shape, built_c = _compile_jaxpr(
+        jaxpr, device_assignment, axis_env, consts, *abstract_args)
     del master, consts, jaxpr, env
+  _record_compile(fun.f, lu.fun_name(fun.f), _signature_str(abstract_args),
+                  trace_time, _monotonic() - start_time - trace_time, built_c)
   if device_values:
     handle_result = _device_persistent_result_handler(result_shape)
   else:
@@ -49,6 +49,7 @@ from ..util import curry, memoize, safe_zip, unzip2, prod
 from ..tree_util import build_tree, tree_unflatten, tree_map
 from ..lib import xla_bridge
 from ..lib import xla_client
+from ..lib import lapack
 
 FLAGS = flags.FLAGS
 
@@ -1457,8 +1458,12 @@ def standard_translate(name, c, *args, **kwargs):
   return getattr(c, xla_opname)(*args, **kwargs)
 
 
+@memoize
+def _dtype_accepted(dtype, accepted_dtypes):
+  return any(onp.issubdtype(dtype, t) for t in accepted_dtypes)
+
 def unop_dtype_rule(result_dtype, accepted_dtypes, name, aval, **kwargs):
-  if not any(onp.issubdtype(aval.dtype, t) for t in accepted_dtypes):
+  if not _dtype_accepted(aval.dtype, frozenset(accepted_dtypes)):
     msg = '{} does not accept dtype {}. Accepted dtypes are subtypes of {}.'
     typename = str(onp.dtype(aval.dtype).name)
     accepted_typenames = (str(onp.dtype(t).name) for t in accepted_dtypes)
@@ -1478,7 +1483,7 @@ _attrgetter = lambda name: lambda x, **kwargs: getattr(x, name)
 def binop_dtype_rule(result_dtype, accepted_dtypes, name, *avals, **kwargs):
   aval_dtypes = [aval.dtype for aval in avals]
   for i, (aval_dtype, types) in enumerate(zip(aval_dtypes, accepted_dtypes)):
-    if not any(onp.issubdtype(aval_dtype, t) for t in types):
+    if not _dtype_accepted(aval_dtype, frozenset(types)):
       msg = ('{} does not accept dtype {} at position {}. '
              'Accepted dtypes at position {} are subtypes of {}.')
       typename = str(onp.dtype(aval_dtype).name)
@@ -1489,7 +1494,10 @@ def binop_dtype_rule(result_dtype, accepted_dtypes, name, *avals, **kwargs):
 
 
 def _broadcasting_shape_rule(name, *avals):
-  shapes = onp.array([aval.shape for aval in avals if aval.shape])
+  shapes = [aval.shape for aval in avals if aval.shape]
+  if shapes and all(shape == shapes[0] for shape in shapes[1:]):
+    return tuple(shapes[0])
+  shapes = onp.array(shapes)
   if not shapes.size:
     return ()
   if len({len(shape) for shape in shapes}) != 1:
@@ -2235,6 +2243,40 @@ ad.defbilinear(dot_general_p,
                _dot_general_transpose_lhs, _dot_general_transpose_rhs)
 batching.primitive_batchers[dot_general_p] = _dot_general_batch_rule
 
+# On CPU, XLA's per-matrix overhead dominates dot_generals over large batches of
+# small matrices, so those are lowered to a batched GEMM custom call instead.
+_cpu_gemm_batched_min_batch = 16
+_cpu_gemm_batched_max_dim = 32
+_cpu_gemm_batched_types = {onp.float32, onp.float64, onp.complex64,
+                           onp.complex128}
+
+def _dot_general_cpu_translation_rule(c, lhs, rhs, dimension_numbers,
+                                      precision):
+  (lhs_contract, rhs_contract), (lhs_batch, rhs_batch) = dimension_numbers
+  lhs_shape = c.GetShape(lhs)
+  rhs_shape = c.GetShape(rhs)
+  lhs_dims = lhs_shape.dimensions()
+  rhs_dims = rhs_shape.dimensions()
+  nb = len(lhs_batch)
+  if (nb > 0 and tuple(lhs_batch) == tuple(rhs_batch) == tuple(range(nb))
+      and len(lhs_dims) == len(rhs_dims) == nb + 2
+      and len(lhs_contract) == len(rhs_contract) == 1
+      and lhs_shape.element_type() == rhs_shape.element_type()
+      and lhs_shape.element_type().type in _cpu_gemm_batched_types
+      and prod(lhs_dims[:nb]) >= _cpu_gemm_batched_min_batch
+      and _max(lhs_dims[nb:] + rhs_dims[nb:]) <= _cpu_gemm_batched_max_dim):
+    trans_a = lhs_contract[0] == nb
+    trans_b = rhs_contract[0] == nb + 1
+    return lapack.gemm_batched(c, lhs, rhs, trans_a=trans_a, trans_b=trans_b)
+  return _dot_general_translation_rule(c, lhs, rhs, dimension_numbers,
+                                       precision)
+
+# TODO(phawkins): remove if-condition after increasing minimum Jaxlib version to
+# 0.1.23.
+if hasattr(lapack, "gemm_batched"):
+  xla.backend_specific_translations['cpu'][dot_general_p] = \
+      _dot_general_cpu_translation_rule
+
 
 def _broadcast_shape_rule(operand, sizes):
   _check_shapelike('broadcast', 'sizes', sizes)
@@ -4077,6 +4119,8 @@ def _check_same_dtypes(name, ignore_fp_precision, *dtypes):
   """Check that dtypes agree, possibly ignoring float precision."""
   # the `ignore_fp_precision` flag exists because the XLA shape inference logic
   # allows mixed floating point precision, but the HLO verifier often rejects it
+  if all(t == dtypes[0] for t in dtypes[1:]):
+    return
   dtypes = list(map(onp.dtype, dtypes))  # canonicalize
   if ignore_fp_precision:
     dtypes = [
@@ -35,6 +35,7 @@ from jax.core import Primitive
 from jax.lax import (standard_primitive, standard_unop, binop_dtype_rule,
                      _float, _complex, _input_dtype, _broadcasting_select)
 from jax.lib import lapack
+from jax.lib import version as jaxlib_version
 from jax.lib import cusolver
 
 # traceables
@@ -48,12 +49,39 @@ def eig(x):
   w, vl, vr = eig_p.bind(x)
   return w, vl, vr
 
+def eigvals(x):
+  """Computes the eigenvalues of the square matrix `x`, without its
+  eigenvectors."""
+  return eigvals_p.bind(x)
+
 def eigh(x, lower=True, symmetrize_input=True):
   if symmetrize_input:
     x = symmetrize(x)
   v, w = eigh_p.bind(x, lower=lower)
   return v, w
 
+def eigvalsh(x, lower=True, symmetrize_input=True):
+  """Computes the eigenvalues of the Hermitian matrix `x`, in ascending
+  order, without its eigenvectors."""
+  if symmetrize_input:
+    x = symmetrize(x)
+  return eigvalsh_p.bind(x, lower=lower)
+
+def eigh_subset(x, subset_by_index, lower=True, symmetrize_input=True):
+  """Computes the eigenpairs of the Hermitian `x` with eigenvalue indices in
+  the half-open range `subset_by_index`, counted in ascending order.
+
+  Returns the eigenvectors, of shape (..., n, k), and the eigenvalues, of
+  shape (..., k), where k is the size of the range. Use
+  `subset_by_index=(n - k, n)` for the top k eigenpairs.
+  """
+  if symmetrize_input:
+    x = symmetrize(x)
+  lo, hi = subset_by_index
+  v, w = eigh_subset_p.bind(x, lower=lower,
+                            subset_by_index=(int(lo), int(hi)))
+  return v, w
+
 def lu(x):
   lu, pivots = lu_p.bind(x)
   return lu, pivots
@@ -76,6 +104,76 @@ def triangular_solve(a, b, left_side=False, lower=False, transpose_a=False,
       a, b, left_side=left_side, lower=lower, transpose_a=transpose_a,
       conjugate_a=conjugate_a, unit_diagonal=unit_diagonal)
 
+def cholesky_solve(c, b, lower=True):
+  """Solves `a @ x = b` given the Cholesky factor `c` of `a`.
+
+  Only the `lower` (a = c @ c^H) or upper (a = c^H @ c) triangle of `c` is
+  read.
+  """
+  return cholesky_solve_p.bind(c, b, lower=lower)
+
+def positive_definite_solve(a, b, lower=True, mixed_precision=False):
+  """Solves `a @ x = b` for a Hermitian positive definite `a`.
+
+  Only the `lower` or upper triangle of `a` is read. Returns NaNs if `a` is
+  not positive definite. See `general_solve` for `mixed_precision`.
+  """
+  return positive_definite_solve_p.bind(a, b, lower=lower,
+                                        mixed_precision=bool(mixed_precision))
+
+def lu_solve(lu, pivots, b, trans=0):
+  """Solves `op(a) @ x = b` given the LU factorization returned by `lu`.
+
+  `trans` is 0, 1 or 2 for op(a) = a, a^T or a^H respectively.
+  """
+  return lu_solve_p.bind(lu, pivots, b, trans=trans)
+
+def general_solve(a, b, trans=0, mixed_precision=False):
+  """Solves `op(a) @ x = b` for a square `a`, via an LU factorization.
+
+  `trans` is 0, 1 or 2 for op(a) = a, a^T or a^H respectively. Returns NaNs
+  if `a` is singular.
+
+  If `mixed_precision` is set, float64 and complex128 systems may be solved
+  by factoring `a` in single precision and refining the solution to full
+  precision, falling back to a full precision factorization if refinement
+  does not converge. This is about twice as fast for large matrices that are
+  not too badly conditioned. It is only a hint: backends without a
+  mixed-precision solver ignore it.
+  """
+  return general_solve_p.bind(a, b, trans=trans,
+                              mixed_precision=bool(mixed_precision))
+
+def tridiagonal_solve(dl, d, du, b):
+  """Solves `a @ x = b` for a tridiagonal `a`.
+
+  `dl`, `d` and `du` have shape [..., n] and hold the sub-, main and
+  superdiagonals of `a`: a[i, i - 1] = dl[i], a[i, i] = d[i] and
+  a[i, i + 1] = du[i]. dl[..., 0] and du[..., n - 1] are ignored. Returns NaNs
+  if `a` is singular.
+  """
+  return tridiagonal_solve_p.bind(dl, d, du, b)
+
+def banded_solve(ab, b, lower_bandwidth, upper_bandwidth):
+  """Solves `a @ x = b` for a banded `a`.
+
+  `ab` has shape [..., kl + ku + 1, n], where kl and ku are the lower and
+  upper bandwidths, and holds `a` in LAPACK band storage:
+  a[i, j] = ab[ku + i - j, j]. Returns NaNs if `a` is singular.
+  """
+  return banded_solve_p.bind(ab, b, lower_bandwidth=int(lower_bandwidth),
+                             upper_bandwidth=int(upper_bandwidth))
+
+def positive_definite_banded_solve(ab, b, lower=True):
+  """Solves `a @ x = b` for a Hermitian positive definite banded `a`.
+
+  `ab` has shape [..., kd + 1, n], where kd is the bandwidth, and holds the
+  `lower` triangle of `a`, a[i, j] = ab[i - j, j], or else its upper
+  triangle, a[i, j] = ab[kd + i - j, j]. Returns NaNs if `a` is not positive
+  definite.
+  """
+  return positive_definite_banded_solve_p.bind(ab, b, lower=lower)
+
 
 # utilities
 
@@ -93,6 +191,10 @@ def _unpack_tuple(f, n):
 
 _cpu_lapack_types = {np.float32, np.float64, np.complex64, np.complex128}
 
+# Types for which LAPACK has mixed-precision iterative refinement solvers, which
+# factor in single precision and refine to double.
+_cpu_mixed_precision_types = {np.float64, np.complex128}
+
 # Cholesky decomposition
 
 def cholesky_jvp_rule(primals, tangents):
@@ -136,18 +238,23 @@ if hasattr(lapack, "potrf"):
   _cpu_potrf = lapack.potrf
 else:
   _cpu_potrf = _unpack_tuple(lapack.jax_potrf, 2)
+# Whether the potrf, gesdd and trsm kernels accept batch dimensions.
+# TODO(phawkins): remove after increasing minimum Jaxlib version to 0.1.23.
+_cpu_batched_lapack = jaxlib_version >= (0, 1, 23)
 
 def cholesky_cpu_translation_rule(c, operand):
   shape = c.GetShape(operand)
   dtype = shape.element_type().type
-  if len(shape.dimensions()) == 2 and dtype in _cpu_lapack_types:
+  dims = shape.dimensions()
+  if dtype in _cpu_lapack_types and (len(dims) == 2 or _cpu_batched_lapack):
+    batch_dims = dims[:-2]
     result, info = _cpu_potrf(c, operand, lower=True)
-    return c.Select(c.Eq(info, c.ConstantS32Scalar(0)), result,
-                    _nan_like(c, result))
+    ok = c.Eq(info, c.ConstantS32Scalar(0))
+    return _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1, 1)),
+                                result, _nan_like(c, result))
   else:
-    # Fall back to the HLO implementation for batched Cholesky decomposition or
-    # unsupported types.
-    # TODO(phawkins): support LAPACK primitives in batched mode.
+    # Fall back to the HLO implementation for unsupported types, or batched
+    # Cholesky decomposition with jaxlibs whose potrf only takes a matrix.
     return c.Cholesky(operand)
 
 xla.backend_specific_translations['cpu'][cholesky_p] = cholesky_cpu_translation_rule
@@ -209,6 +316,47 @@ xla.backend_specific_translations['cpu'][eig_p] = eig_cpu_translation_rule
 batching.primitive_batchers[eig_p] = eig_batching_rule
 
 
+# Eigenvalues of a nonsymmetric matrix
+
+def _eigvals_shape_rule(operand):
+  if operand.ndim < 2 or operand.shape[-2] != operand.shape[-1]:
+    raise ValueError("Argument to nonsymmetric eigenvalues must have "
+                     "shape [..., n, n], got shape {}".format(operand.shape))
+  return operand.shape[:-1]
+
+def _eigvals_dtype_rule(operand):
+  return onp.result_type(operand.dtype, onp.complex64)
+
+def _eigvals_python(operand):
+  w, _, _ = eig_p.bind(operand)
+  return w
+
+def _eigvals_cpu_translation_rule(c, operand):
+  shape = c.GetShape(operand)
+  dtype = shape.element_type().type
+  if (dtype not in _cpu_lapack_types or not _cpu_batched_lapack or
+      not hasattr(lapack, "geev")):
+    # Older jaxlibs' geev always computes the eigenvectors.
+    return xla.lower_fun(_eigvals_python, instantiate=True)(c, operand)
+  batch_dims = shape.dimensions()[:-2]
+  w, info = lapack.geev(c, operand, compute_vectors=False)
+  ok = c.Eq(info, c.ConstantS32Scalar(0))
+  return _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1,)), w,
+                              _nan_like(c, w))
+
+def _eigvals_batching_rule(batched_args, batch_dims):
+  x, = batched_args
+  bd, = batch_dims
+  x = batching.bdim_at_front(x, bd)
+  return eigvals_p.bind(x), 0
+
+eigvals_p = standard_primitive(_eigvals_shape_rule, _eigvals_dtype_rule,
+                               'eigvals', translation_rule=eig_translation_rule)
+xla.backend_specific_translations['cpu'][eigvals_p] = \
+    _eigvals_cpu_translation_rule
+batching.primitive_batchers[eigvals_p] = _eigvals_batching_rule
+
+
 # Symmetric/Hermitian eigendecomposition
 
 def eigh_impl(operand, lower):
@@ -299,6 +447,141 @@ if cusolver:
 batching.primitive_batchers[eigh_p] = eigh_batching_rule
 
 
+# Eigenvalues of a Symmetric/Hermitian matrix
+
+def _eigvalsh_python(operand, lower):
+  _, w = eigh_p.bind(operand, lower=lower)
+  return w
+
+def _eigvalsh_shape_rule(operand, lower):
+  if operand.ndim < 2 or operand.shape[-2] != operand.shape[-1]:
+    raise ValueError(
+      "Argument to symmetric eigendecomposition must have shape [..., n, n],"
+      "got shape {}".format(operand.shape))
+  return operand.shape[:-1]
+
+def _eigvalsh_dtype_rule(operand, lower):
+  return lax.lax._complex_basetype(operand.dtype)
+
+def _eigvalsh_jvp_rule(primals, tangents, lower):
+  # dw_j = v_j^H a_dot v_j; see eigh_jvp_rule.
+  a, = primals
+  a_dot, = tangents
+  v, w = eigh_p.bind(symmetrize(a), lower=lower)
+  dw = np.real(np.sum(np.conj(v) * np.matmul(a_dot, v), axis=-2))
+  return w, dw
+
+def _eigvalsh_batching_rule(batched_args, batch_dims, lower):
+  x, = batched_args
+  bd, = batch_dims
+  x = batching.bdim_at_front(x, bd)
+  return eigvalsh_p.bind(x, lower=lower), 0
+
+def _eigvalsh_cpu_translation_rule(c, operand, lower):
+  shape = c.GetShape(operand)
+  dtype = shape.element_type().type
+  if dtype not in _cpu_lapack_types or not _cpu_batched_lapack:
+    return xla.lower_fun(_eigvalsh_python, instantiate=True)(
+        c, operand, lower=lower)
+  batch_dims = shape.dimensions()[:-2]
+  w, info = lapack.syevd(c, operand, lower=lower, compute_vectors=False)
+  ok = c.Eq(info, c.ConstantS32Scalar(0))
+  return _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1,)), w,
+                              _nan_like(c, w))
+
+eigvalsh_p = standard_primitive(
+    _eigvalsh_shape_rule, _eigvalsh_dtype_rule, 'eigvalsh',
+    translation_rule=xla.lower_fun(_eigvalsh_python, instantiate=True))
+xla.backend_specific_translations['cpu'][eigvalsh_p] = \
+    _eigvalsh_cpu_translation_rule
+ad.primitive_jvps[eigvalsh_p] = _eigvalsh_jvp_rule
+batching.primitive_batchers[eigvalsh_p] = _eigvalsh_batching_rule
+
+
+# Symmetric/Hermitian eigendecomposition of a subset of the spectrum
+
+def _eigh_subset_python(operand, lower, subset_by_index):
+  lo, hi = subset_by_index
+  v, w = eigh_p.bind(operand, lower=lower)
+  return core.pack((v[..., lo:hi], w[..., lo:hi]))
+
+def _eigh_subset_impl(operand, lower, subset_by_index):
+  v, w = xla.apply_primitive(eigh_subset_p, operand, lower=lower,
+                             subset_by_index=subset_by_index)
+  return core.pack((v, w))
+
+def _eigh_subset_abstract_eval(operand, lower, subset_by_index):
+  if isinstance(operand, ShapedArray):
+    if operand.ndim < 2 or operand.shape[-2] != operand.shape[-1]:
+      raise ValueError(
+        "Argument to symmetric eigendecomposition must have shape [..., n, n],"
+        "got shape {}".format(operand.shape))
+
+    batch_dims = operand.shape[:-2]
+    n = operand.shape[-1]
+    lo, hi = subset_by_index
+    if not 0 <= lo < hi <= n:
+      raise ValueError(
+        "Eigenvalue index range {} is invalid for matrices of size {}".format(
+          subset_by_index, n))
+    v = ShapedArray(batch_dims + (n, hi - lo), operand.dtype)
+    w = ShapedArray(batch_dims + (hi - lo,),
+                    lax.lax._complex_basetype(operand.dtype))
+  else:
+    v, w = operand, operand
+  return core.AbstractTuple((v, w))
+
+def _eigh_subset_jvp_rule(primals, tangents, lower, subset_by_index):
+  # The eigenvector tangents involve the whole spectrum, so this goes through
+  # the full decomposition; see eigh_jvp_rule.
+  a, = primals
+  a_dot, = tangents
+  lo, hi = subset_by_index
+  v, w = eigh_p.bind(symmetrize(a), lower=lower)
+  w_full = w.astype(a.dtype)
+  eye_n = np.eye(a.shape[-1], dtype=a.dtype)
+  Fmat = np.reciprocal(eye_n + w_full - w_full[..., np.newaxis]) - eye_n
+  v_subset = v[..., lo:hi]
+  vdag_adot_v = np.matmul(np.matmul(_H(v), a_dot), v_subset)
+  dv = np.matmul(v, np.multiply(Fmat[..., lo:hi], vdag_adot_v))
+  dw = np.real(np.diagonal(vdag_adot_v[..., lo:hi, :], axis1=-2, axis2=-1))
+  return core.pack((v_subset, w[..., lo:hi])), core.pack((dv, dw))
+
+def _eigh_subset_batching_rule(batched_args, batch_dims, lower,
+                               subset_by_index):
+  x, = batched_args
+  bd, = batch_dims
+  x = batching.bdim_at_front(x, bd)
+  return eigh_subset_p.bind(x, lower=lower,
+                            subset_by_index=subset_by_index), 0
+
+def _eigh_subset_cpu_translation_rule(c, operand, lower, subset_by_index):
+  shape = c.GetShape(operand)
+  dtype = shape.element_type().type
+  if dtype not in _cpu_lapack_types or not hasattr(lapack, "syevr"):
+    return xla.lower_fun(_eigh_subset_python, instantiate=True)(
+        c, operand, lower=lower, subset_by_index=subset_by_index)
+  batch_dims = shape.dimensions()[:-2]
+  v, w, _, info = lapack.syevr(c, operand, lower=lower,
+                               subset_by_index=subset_by_index)
+  ok = c.Eq(info, c.ConstantS32Scalar(0))
+  v = _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1, 1)), v,
+                           _nan_like(c, v))
+  w = _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1,)), w,
+                           _nan_like(c, w))
+  return c.Tuple(v, w)
+
+eigh_subset_p = Primitive('eigh_subset')
+eigh_subset_p.def_impl(_eigh_subset_impl)
+eigh_subset_p.def_abstract_eval(_eigh_subset_abstract_eval)
+xla.translations[eigh_subset_p] = xla.lower_fun(_eigh_subset_python,
+                                                instantiate=True)
+xla.backend_specific_translations['cpu'][eigh_subset_p] = \
+    _eigh_subset_cpu_translation_rule
+ad.primitive_jvps[eigh_subset_p] = _eigh_subset_jvp_rule
+batching.primitive_batchers[eigh_subset_p] = _eigh_subset_batching_rule
+
+
 
 triangular_solve_dtype_rule = partial(
     binop_dtype_rule, _input_dtype, (_float | _complex, _float | _complex),
@@ -353,6 +636,26 @@ def triangular_solve_batching_rule(batched_args, batch_dims, left_side,
                                    unit_diagonal):
   x, y = batched_args
   bx, by = batch_dims
+  if bx is None and x.ndim == 2:
+    # Every batch element is solved against the same matrix, so rather than
+    # broadcasting `a` we fold the batch dimension of `b` into its rows or
+    # columns and issue a single triangular solve.
+    if left_side:
+      y = np.moveaxis(y, by, 1)
+      m, size, n = y.shape
+      out = triangular_solve(x, np.reshape(y, (m, size * n)),
+                             left_side=left_side, lower=lower,
+                             transpose_a=transpose_a, conjugate_a=conjugate_a,
+                             unit_diagonal=unit_diagonal)
+      return np.reshape(out, (m, size, n)), 1
+    else:
+      y = batching.bdim_at_front(y, by)
+      size, m, n = y.shape
+      out = triangular_solve(x, np.reshape(y, (size * m, n)),
+                             left_side=left_side, lower=lower,
+                             transpose_a=transpose_a, conjugate_a=conjugate_a,
+                             unit_diagonal=unit_diagonal)
+      return np.reshape(out, (size, m, n)), 0
   size = next(t.shape[i] for t, i in zip(batched_args, batch_dims)
               if i is not None)
   x = batching.bdim_at_front(x, bx, size, force_broadcast=True)
@@ -375,7 +678,8 @@ def triangular_solve_cpu_translation_rule(
     c, a, b, left_side, lower, transpose_a, conjugate_a, unit_diagonal):
   shape = c.GetShape(a)
   dtype = shape.element_type().type
-  if len(shape.dimensions()) == 2 and dtype in _cpu_lapack_types:
+  if dtype in _cpu_lapack_types and (len(shape.dimensions()) == 2 or
+                                     _cpu_batched_lapack):
     if conjugate_a and not transpose_a:
       a = c.Conj(a)
       conjugate_a = False
@@ -383,15 +687,143 @@ def triangular_solve_cpu_translation_rule(
       c, c.Constant(onp.array(1, dtype=dtype)), a, b, left_side, lower,
                     transpose_a, conjugate_a, unit_diagonal)
   else:
-    # Fall back to the HLO implementation for batched triangular_solve or
-    # unsupported types.
-    # TODO(phawkins): support BLAS primitives in batched mode.
+    # Fall back to the HLO implementation for unsupported types or older
+    # jaxlibs without batched trsm.
     return c.TriangularSolve(a, b, left_side, lower, transpose_a, conjugate_a,
                              unit_diagonal)
 
 xla.backend_specific_translations['cpu'][triangular_solve_p] = triangular_solve_cpu_translation_rule
 
 
+# Solves against a Cholesky-factored or positive definite matrix
+
+_solve_dtype_rule = partial(
+    binop_dtype_rule, _input_dtype, (_float | _complex, _float | _complex),
+    'solve')
+
+def _solve_shape_rule(a, b, **unused_kwargs):
+  if a.ndim < 2 or a.shape[-1] != a.shape[-2]:
+    msg = ("The arguments to solve must have shapes a=[..., m, m] and "
+           "b=[..., m, k]; got a={} and b={}")
+    raise TypeError(msg.format(a.shape, b.shape))
+  if a.ndim != b.ndim or a.shape[:-2] != b.shape[:-2] or \
+     a.shape[-1] != b.shape[-2]:
+    msg = ("The arguments to solve must have equal batch dimensions and "
+           "shapes a=[..., m, m] and b=[..., m, k]; got a={} and b={}")
+    raise TypeError(msg.format(a.shape, b.shape))
+  return b.shape
+
+def _solve_batching_rule(prim, batched_args, batch_dims, **params):
+  size = next(t.shape[i] for t, i in zip(batched_args, batch_dims)
+              if i is not None)
+  args = [batching.bdim_at_front(x, bd, size, force_broadcast=True)
+          for x, bd in zip(batched_args, batch_dims)]
+  return prim.bind(*args, **params), 0
+
+def _cholesky_factor(c, lower):
+  """Returns the lower triangular factor L, with A = L L^H."""
+  return np.tril(c) if lower else _H(np.triu(c))
+
+def _cholesky_solve_python(c, b, lower):
+  l = _cholesky_factor(c, lower)
+  b = triangular_solve(l, b, left_side=True, lower=True)
+  return triangular_solve(l, b, left_side=True, lower=True, transpose_a=True,
+                          conjugate_a=True)
+
+def _cholesky_solve_jvp_rule_c(g_c, ans, c, b, lower):
+  # A = L L^H, so A' = L' L^H + L L'^H and x' = -A^{-1} A' x.
+  l = _cholesky_factor(c, lower)
+  g_l = _cholesky_factor(g_c, lower)
+  g_a_x = (np.matmul(g_l, np.matmul(_H(l), ans)) +
+           np.matmul(l, np.matmul(_H(g_l), ans)))
+  return cholesky_solve(c, lax.neg(g_a_x), lower=lower)
+
+def _cholesky_solve_transpose_rule(cotangent, c, b, lower):
+  # A is Hermitian, so A^{-T} = conj(A)^{-1}.
+  assert c is not None and b is None
+  return [None, cholesky_solve(np.conj(c), cotangent, lower=lower)]
+
+cholesky_solve_p = standard_primitive(
+    _solve_shape_rule, _solve_dtype_rule, 'cholesky_solve',
+    translation_rule=xla.lower_fun(_cholesky_solve_python, instantiate=True))
+ad.defjvp2(cholesky_solve_p,
+           _cholesky_solve_jvp_rule_c,
+           lambda g_b, _, c, b, **kws: cholesky_solve(c, g_b, **kws))
+ad.primitive_transposes[cholesky_solve_p] = _cholesky_solve_transpose_rule
+batching.primitive_batchers[cholesky_solve_p] = partial(
+    _solve_batching_rule, cholesky_solve_p)
+
+def _cholesky_solve_cpu_translation_rule(c, factor, b, lower):
+  dtype = c.GetShape(factor).element_type().type
+  if (dtype in _cpu_lapack_types and _cpu_batched_lapack and
+      hasattr(lapack, "potrs")):
+    x, _ = lapack.potrs(c, factor, b, lower=lower)
+    return x
+  else:
+    return xla.lower_fun(_cholesky_solve_python, instantiate=True)(
+        c, factor, b, lower=lower)
+
+xla.backend_specific_translations['cpu'][cholesky_solve_p] = \
+    _cholesky_solve_cpu_translation_rule
+
+
+def _hermitian_from_triangle(a, lower):
+  """Rebuilds the Hermitian matrix whose `lower` or upper triangle is `a`'s."""
+  if lower:
+    return np.tril(a) + _H(np.tril(a, -1))
+  else:
+    return np.triu(a) + _H(np.triu(a, 1))
+
+def _positive_definite_solve_python(a, b, lower, mixed_precision=False):
+  l = cholesky_p.bind(a if lower else _H(a))
+  return _cholesky_solve_python(l, b, lower=True)
+
+def _positive_definite_solve_jvp_rule_a(g_a, ans, a, b, lower,
+                                        mixed_precision):
+  g_a = _hermitian_from_triangle(g_a, lower)
+  l = cholesky(a if lower else _H(a), symmetrize_input=False)
+  return cholesky_solve(l, lax.neg(np.matmul(g_a, ans)), lower=True)
+
+def _positive_definite_solve_transpose_rule(cotangent, a, b, lower,
+                                            mixed_precision):
+  assert a is not None and b is None
+  return [None, positive_definite_solve(np.conj(a), cotangent, lower=lower,
+                                        mixed_precision=mixed_precision)]
+
+positive_definite_solve_p = standard_primitive(
+    _solve_shape_rule, _solve_dtype_rule, 'positive_definite_solve',
+    translation_rule=xla.lower_fun(_positive_definite_solve_python,
+                                   instantiate=True))
+ad.defjvp2(positive_definite_solve_p,
+           _positive_definite_solve_jvp_rule_a,
+           lambda g_b, _, a, b, **kws: positive_definite_solve(a, g_b, **kws))
+ad.primitive_transposes[positive_definite_solve_p] = \
+    _positive_definite_solve_transpose_rule
+batching.primitive_batchers[positive_definite_solve_p] = partial(
+    _solve_batching_rule, positive_definite_solve_p)
+
+def _positive_definite_solve_cpu_translation_rule(c, a, b, lower,
+                                                  mixed_precision):
+  shape = c.GetShape(a)
+  dtype = shape.element_type().type
+  batch_dims = shape.dimensions()[:-2]
+  if (mixed_precision and dtype in _cpu_mixed_precision_types and
+      hasattr(lapack, "mixed_posv")):
+    x, _, info = lapack.mixed_posv(c, a, b, lower=lower)
+  elif (dtype in _cpu_lapack_types and _cpu_batched_lapack and
+        hasattr(lapack, "posv")):
+    _, x, info = lapack.posv(c, a, b, lower=lower)
+  else:
+    return xla.lower_fun(_positive_definite_solve_python, instantiate=True)(
+        c, a, b, lower=lower)
+  ok = c.Eq(info, c.ConstantS32Scalar(0))
+  return _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1, 1)),
+                              x, _nan_like(c, x))
+
+xla.backend_specific_translations['cpu'][positive_definite_solve_p] = \
+    _positive_definite_solve_cpu_translation_rule
+
+
 # LU decomposition
 
 # Computes a pivoted LU decomposition such that
@@ -584,7 +1016,7 @@ if cusolver:
     _lu_cpu_gpu_translation_rule, cusolver.getrf)
 
 
-def lu_pivots_to_permutation(swaps, m):
+def lu_pivots_to_permutation(swaps, m, inverse=False):
   """Converts the pivots (row swaps) returned by LU to a permutation.
 
   We build a permutation rather than applying `swaps` directly to the rows
@@ -593,25 +1025,466 @@ def lu_pivots_to_permutation(swaps, m):
   Args:
     swaps: an array of shape (..., k) of row swaps to perform
     m: the size of the output permutation. m should be >= k.
+    inverse: if True, also return the inverse permutation.
   Returns:
-    An int32 array of shape (..., m).
+    An int32 array of shape (..., m), or a pair of them if `inverse` is True.
   """
   assert len(swaps.shape) >= 1
+  out = lu_pivots_to_permutation_p.bind(swaps, permutation_size=m,
+                                        inverse=inverse)
+  if inverse:
+    permutation, inverse_permutation = out
+    return permutation, inverse_permutation
+  return out
+
+def _lu_pivots_to_permutation_python(swaps, permutation_size, inverse):
   batch_dims = swaps.shape[:-1]
   k = swaps.shape[-1]
+  m = permutation_size
+  iotas = np.ix_(*(lax.iota(np.int32, b) for b in batch_dims))
 
   def body_fn(i, permutation):
     j = swaps[..., i]
-    iotas = np.ix_(*(lax.iota(np.int32, b) for b in batch_dims))
     x = permutation[..., i]
     y = permutation[iotas + (j,)]
     permutation = ops.index_update(permutation, ops.index[..., i], y)
     return ops.index_update(permutation, ops.index[iotas + (j,)], x)
 
-  permutation = lax.broadcasted_iota(np.int32, batch_dims + (m,),
-                                     len(batch_dims))
-  return lax.fori_loop(
-    onp.array(0, onp.int32), onp.array(k, onp.int32), body_fn, permutation)
+  iota = lax.broadcasted_iota(np.int32, batch_dims + (m,), len(batch_dims))
+  permutation = lax.fori_loop(
+    onp.array(0, onp.int32), onp.array(k, onp.int32), body_fn, iota)
+  if not inverse:
+    return permutation
+  rows = np.ix_(*(lax.iota(np.int32, b) for b in batch_dims + (1,)))[:-1]
+  inverse_permutation = ops.index_update(
+      iota, ops.index[rows + (permutation,)], iota)
+  return core.pack((permutation, inverse_permutation))
+
+def _lu_pivots_to_permutation_impl(swaps, permutation_size, inverse):
+  out = xla.apply_primitive(lu_pivots_to_permutation_p, swaps,
+                            permutation_size=permutation_size,
+                            inverse=inverse)
+  return core.pack(out) if inverse else out
+
+def _lu_pivots_to_permutation_abstract_eval(swaps, permutation_size,
+                                            inverse):
+  if isinstance(swaps, ShapedArray):
+    if swaps.ndim < 1 or swaps.dtype != np.int32:
+      raise ValueError(
+          "Argument to lu_pivots_to_permutation must have rank >= 1 and "
+          "dtype int32, got shape {} and dtype {}".format(swaps.shape,
+                                                          swaps.dtype))
+    if permutation_size < swaps.shape[-1]:
+      raise ValueError(
+          "Output permutation size {} has to exceed the trailing dimension "
+          "of the pivots {}".format(permutation_size, swaps.shape[-1]))
+    permutation = ShapedArray(swaps.shape[:-1] + (permutation_size,),
+                              swaps.dtype)
+  else:
+    permutation = swaps
+  if inverse:
+    return core.AbstractTuple((permutation, permutation))
+  return permutation
+
+def _lu_pivots_to_permutation_batching_rule(batched_args, batch_dims,
+                                            permutation_size, inverse):
+  x, = batched_args
+  bd, = batch_dims
+  x = batching.bdim_at_front(x, bd)
+  return lu_pivots_to_permutation_p.bind(
+      x, permutation_size=permutation_size, inverse=inverse), 0
+
+def _lu_pivots_to_permutation_cpu_translation_rule(c, swaps, permutation_size,
+                                                   inverse):
+  if not hasattr(lapack, "lu_pivots_to_permutation"):
+    return xla.lower_fun(_lu_pivots_to_permutation_python, instantiate=True)(
+        c, swaps, permutation_size=permutation_size, inverse=inverse)
+  out = lapack.lu_pivots_to_permutation(c, swaps, permutation_size,
+                                        inverse=inverse)
+  return c.Tuple(*out) if inverse else out
+
+lu_pivots_to_permutation_p = Primitive('lu_pivots_to_permutation')
+lu_pivots_to_permutation_p.def_impl(_lu_pivots_to_permutation_impl)
+lu_pivots_to_permutation_p.def_abstract_eval(
+    _lu_pivots_to_permutation_abstract_eval)
+xla.translations[lu_pivots_to_permutation_p] = xla.lower_fun(
+    _lu_pivots_to_permutation_python, instantiate=True)
+xla.backend_specific_translations['cpu'][lu_pivots_to_permutation_p] = \
+    _lu_pivots_to_permutation_cpu_translation_rule
+ad.defjvp_zero(lu_pivots_to_permutation_p)
+batching.primitive_batchers[lu_pivots_to_permutation_p] = \
+    _lu_pivots_to_permutation_batching_rule
+
+
+# Solves against an LU-factored or general matrix
+
+def _lu_solve_dtype_rule(lu, pivots, b, **unused_kwargs):
+  if pivots.dtype != np.int32:
+    msg = "lu_solve requires int32 pivots, got {}."
+    raise TypeError(msg.format(pivots.dtype))
+  return _solve_dtype_rule(lu, b)
+
+def _lu_solve_shape_rule(lu, pivots, b, **unused_kwargs):
+  if pivots.shape != lu.shape[:-1]:
+    msg = ("lu_solve requires pivots of shape [..., m] for LU factors of "
+           "shape [..., m, m]; got pivots={} and lu={}")
+    raise TypeError(msg.format(pivots.shape, lu.shape))
+  return _solve_shape_rule(lu, b)
+
+def _permuted_rows(pivots, m, inverse=False):
+  """Returns an index that gathers the rows of a batch of matrices by P, or by
+  P^T if `inverse` is true."""
+  batch_dims = pivots.shape[:-1]
+  permutation = lu_pivots_to_permutation(pivots, m, inverse=inverse)
+  if inverse:
+    _, permutation = permutation
+  iotas = np.ix_(*(lax.iota(np.int32, d) for d in batch_dims + (1,)))
+  return iotas[:-1] + (permutation, slice(None))
+
+def _lu_solve_python(lu, pivots, b, trans):
+  m = lu.shape[-1]
+  if trans == 0:
+    # P A = L U, so A x = b becomes L U x = P b.
+    x = triangular_solve(lu, b[_permuted_rows(pivots, m)], left_side=True,
+                         lower=True, unit_diagonal=True)
+    return triangular_solve(lu, x, left_side=True, lower=False)
+  else:
+    # A^T x = b becomes U^T L^T (P x) = b.
+    conjugate_a = trans == 2
+    x = triangular_solve(lu, b, left_side=True, lower=False, transpose_a=True,
+                         conjugate_a=conjugate_a)
+    x = triangular_solve(lu, x, left_side=True, lower=True, transpose_a=True,
+                         conjugate_a=conjugate_a, unit_diagonal=True)
+    return x[_permuted_rows(pivots, m, inverse=True)]
+
+def _lu_solve_jvp_rule_lu(g_lu, ans, lu, pivots, b, trans):
+  # A = P^T M with M = L U, so A' = P^T M' with M' = L' U + L U'.
+  m = lu.shape[-1]
+  l = np.tril(lu, -1) + np.eye(m, dtype=lu.dtype)
+  u = np.triu(lu)
+  g_l = np.tril(g_lu, -1)
+  g_u = np.triu(g_lu)
+  if trans == 0:
+    # x' = -A^{-1} A' x = -U^{-1} L^{-1} M' x.
+    y = np.matmul(g_l, np.matmul(u, ans)) + np.matmul(l, np.matmul(g_u, ans))
+    y = triangular_solve(lu, y, left_side=True, lower=True, unit_diagonal=True)
+    return lax.neg(triangular_solve(lu, y, left_side=True, lower=False))
+  else:
+    # x' = -op(A)^{-1} op(A') x = -op(A)^{-1} op(M') P x.
+    op = _T if trans == 1 else _H
+    z = ans[_permuted_rows(pivots, m)]
+    y = (np.matmul(op(u), np.matmul(op(g_l), z)) +
+         np.matmul(op(g_u), np.matmul(op(l), z)))
+    return lax.neg(lu_solve(lu, pivots, y, trans=trans))
+
+def _transposed_solve(solve, a, cotangent, trans, *args):
+  # The transpose of op(A)^{-1} is op(A)^{-T}; for op = ^H that is conj(A)^{-1}.
+  if trans == 0:
+    return solve(a, *(args + (cotangent,)), trans=1)
+  elif trans == 1:
+    return solve(a, *(args + (cotangent,)), trans=0)
+  else:
+    return solve(np.conj(a), *(args + (cotangent,)), trans=0)
+
+def _lu_solve_transpose_rule(cotangent, lu, pivots, b, trans):
+  assert lu is not None and pivots is not None and b is None
+  return [None, None,
+          _transposed_solve(lu_solve, lu, cotangent, trans, pivots)]
+
+lu_solve_p = standard_primitive(
+    _lu_solve_shape_rule, _lu_solve_dtype_rule, 'lu_solve',
+    translation_rule=xla.lower_fun(_lu_solve_python, instantiate=True))
+ad.defjvp2(lu_solve_p,
+           _lu_solve_jvp_rule_lu,
+           None,
+           lambda g_b, _, lu, pivots, b, **kws:
+               lu_solve(lu, pivots, g_b, **kws))
+ad.primitive_transposes[lu_solve_p] = _lu_solve_transpose_rule
+batching.primitive_batchers[lu_solve_p] = partial(
+    _solve_batching_rule, lu_solve_p)
+
+def _lu_solve_cpu_translation_rule(c, lu, pivots, b, trans):
+  dtype = c.GetShape(lu).element_type().type
+  if (dtype in _cpu_lapack_types and _cpu_batched_lapack and
+      hasattr(lapack, "getrs")):
+    # ?getrs takes LAPACK's 1-based pivots.
+    pivots = c.Add(pivots, c.ConstantS32Scalar(1))
+    x, _ = lapack.getrs(c, lu, pivots, b, trans=trans)
+    return x
+  else:
+    return xla.lower_fun(_lu_solve_python, instantiate=True)(
+        c, lu, pivots, b, trans=trans)
+
+xla.backend_specific_translations['cpu'][lu_solve_p] = \
+    _lu_solve_cpu_translation_rule
+
+
+def _general_solve_python(a, b, trans, mixed_precision=False):
+  lu, pivots = lu_p.bind(a)
+  return _lu_solve_python(lu, pivots, b, trans)
+
+def _general_solve_jvp_rule_a(g_a, ans, a, b, trans, mixed_precision):
+  # op(A) x = b, so x' = -op(A)^{-1} op(A') x.
+  g_a = g_a if trans == 0 else _T(g_a)
+  g_a = np.conj(g_a) if trans == 2 else g_a
+  return general_solve(a, lax.neg(np.matmul(g_a, ans)), trans=trans,
+                       mixed_precision=mixed_precision)
+
+def _general_solve_transpose_rule(cotangent, a, b, trans, mixed_precision):
+  assert a is not None and b is None
+  solve = partial(general_solve, mixed_precision=mixed_precision)
+  return [None, _transposed_solve(solve, a, cotangent, trans)]
+
+general_solve_p = standard_primitive(
+    _solve_shape_rule, _solve_dtype_rule, 'general_solve',
+    translation_rule=xla.lower_fun(_general_solve_python, instantiate=True))
+ad.defjvp2(general_solve_p,
+           _general_solve_jvp_rule_a,
+           lambda g_b, _, a, b, **kws: general_solve(a, g_b, **kws))
+ad.primitive_transposes[general_solve_p] = _general_solve_transpose_rule
+batching.primitive_batchers[general_solve_p] = partial(
+    _solve_batching_rule, general_solve_p)
+
+def _general_solve_cpu_translation_rule(c, a, b, trans, mixed_precision):
+  shape = c.GetShape(a)
+  dtype = shape.element_type().type
+  batch_dims = shape.dimensions()[:-2]
+  if (mixed_precision and trans == 0 and
+      dtype in _cpu_mixed_precision_types and hasattr(lapack, "mixed_gesv")):
+    # The mixed-precision solvers only handle the untransposed system.
+    x, _, info = lapack.mixed_gesv(c, a, b)
+  elif (dtype in _cpu_lapack_types and _cpu_batched_lapack and
+        hasattr(lapack, "gesv")):
+    if trans == 0:
+      _, _, x, info = lapack.gesv(c, a, b)
+    else:
+      # ?gesv only solves the untransposed system.
+      lu, pivots, info = lapack.getrf(c, a)
+      x, _ = lapack.getrs(c, lu, pivots, b, trans=trans)
+  else:
+    return xla.lower_fun(_general_solve_python, instantiate=True)(
+        c, a, b, trans=trans)
+  ok = c.Eq(info, c.ConstantS32Scalar(0))
+  return _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1, 1)),
+                              x, _nan_like(c, x))
+
+xla.backend_specific_translations['cpu'][general_solve_p] = \
+    _general_solve_cpu_translation_rule
+
+
+# Banded solves
+
+def _shift(x, s, axis):
+  """Shifts `x` by `s` places along `axis`, towards higher indices if `s` is
+  positive, and fills the vacated places with zeros."""
+  axis = axis % x.ndim
+  if abs(s) >= x.shape[axis]:
+    return np.zeros_like(x)
+  padding = [(0, 0, 0)] * x.ndim
+  padding[axis] = (s, -s, 0)
+  return lax.pad(x, np._constant_like(x, 0), padding)
+
+def _banded_matmul(ab, x, kl, ku):
+  """Computes a @ x for `a` in band storage; see banded_solve."""
+  # Row r of `ab` holds the diagonal a[j + r - ku, j].
+  out = np.zeros_like(x)
+  for r in range(kl + ku + 1):
+    out = out + _shift(ab[..., r, :, None] * x, r - ku, -2)
+  return out
+
+def _band_transpose(ab, kl, ku):
+  """Returns the band storage of a^T, whose bandwidths are (ku, kl)."""
+  return np.stack([_shift(ab[..., kl + ku - r, :], kl - r, -1)
+                   for r in range(kl + ku + 1)], axis=-2)
+
+def _band_to_dense(ab, kl, ku):
+  n = ab.shape[-1]
+  a = np.zeros(ab.shape[:-2] + (n, n), dtype=ab.dtype)
+  for r in range(kl + ku + 1):
+    a = a + np.eye(n, k=ku - r, dtype=ab.dtype) * ab[..., r, None, :]
+  return a
+
+def _hermitian_band_bandwidths(ab, lower):
+  # The stored triangle is itself a banded matrix.
+  kd = ab.shape[-2] - 1
+  return (kd, 0) if lower else (0, kd)
+
+def _hermitian_banded_matmul(ab, x, lower):
+  """Computes a @ x for the Hermitian `a` whose `lower` or upper triangle is
+  in band storage; see positive_definite_banded_solve."""
+  kl, ku = _hermitian_band_bandwidths(ab, lower)
+  diag = ab[..., ku, :, None]
+  return (_banded_matmul(ab, x, kl, ku) +
+          _banded_matmul(np.conj(_band_transpose(ab, kl, ku)), x, ku, kl) -
+          diag * x)
+
+def _band_solve_shape_rule(ab, b, **unused_kwargs):
+  if ab.ndim < 2 or b.ndim != ab.ndim or ab.shape[:-2] != b.shape[:-2] or \
+     ab.shape[-1] != b.shape[-2]:
+    msg = ("The arguments to a banded solve must have equal batch dimensions "
+           "and shapes ab=[..., bands, m] and b=[..., m, k]; got ab={} and "
+           "b={}")
+    raise TypeError(msg.format(ab.shape, b.shape))
+  return b.shape
+
+def _nan_on_info(c, x, info):
+  batch_dims = c.GetShape(info).dimensions()
+  ok = c.Eq(info, c.ConstantS32Scalar(0))
+  return _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1, 1)), x,
+                              _nan_like(c, x))
+
+
+def _tridiagonal_to_band(dl, d, du):
+  return np.stack([_shift(du, 1, -1), d, _shift(dl, -1, -1)], axis=-2)
+
+def _tridiagonal_solve_python(dl, d, du, b):
+  a = _band_to_dense(_tridiagonal_to_band(dl, d, du), 1, 1)
+  return _general_solve_python(a, b, trans=0)
+
+def _tridiagonal_solve_shape_rule(dl, d, du, b):
+  if d.ndim < 1 or dl.shape != d.shape or du.shape != d.shape or \
+     b.ndim != d.ndim + 1 or b.shape[:-1] != d.shape:
+    msg = ("The arguments to tridiagonal_solve must have shapes "
+           "dl=d=du=[..., m] and b=[..., m, k]; got dl={}, d={}, du={} and "
+           "b={}")
+    raise TypeError(msg.format(dl.shape, d.shape, du.shape, b.shape))
+  return b.shape
+
+_tridiagonal_solve_dtype_rule = partial(
+    binop_dtype_rule, _input_dtype, (_float | _complex,) * 4,
+    'tridiagonal_solve')
+
+def _tridiagonal_solve_transpose_rule(cotangent, dl, d, du, b):
+  # a^T has subdiagonal du[i - 1] and superdiagonal dl[i + 1].
+  assert dl is not None and d is not None and du is not None and b is None
+  return [None, None, None,
+          tridiagonal_solve(_shift(du, 1, -1), d, _shift(dl, -1, -1),
+                            cotangent)]
+
+tridiagonal_solve_p = standard_primitive(
+    _tridiagonal_solve_shape_rule, _tridiagonal_solve_dtype_rule,
+    'tridiagonal_solve',
+    translation_rule=xla.lower_fun(_tridiagonal_solve_python,
+                                   instantiate=True))
+# x' = -a^{-1} a' x, where each diagonal contributes its own term of a' x.
+ad.defjvp2(tridiagonal_solve_p,
+           lambda g_dl, ans, dl, d, du, b: tridiagonal_solve(
+               dl, d, du, lax.neg(g_dl[..., None] * _shift(ans, 1, -2))),
+           lambda g_d, ans, dl, d, du, b: tridiagonal_solve(
+               dl, d, du, lax.neg(g_d[..., None] * ans)),
+           lambda g_du, ans, dl, d, du, b: tridiagonal_solve(
+               dl, d, du, lax.neg(g_du[..., None] * _shift(ans, -1, -2))),
+           lambda g_b, _, dl, d, du, b: tridiagonal_solve(dl, d, du, g_b))
+ad.primitive_transposes[tridiagonal_solve_p] = \
+    _tridiagonal_solve_transpose_rule
+batching.primitive_batchers[tridiagonal_solve_p] = partial(
+    _solve_batching_rule, tridiagonal_solve_p)
+
+def _tridiagonal_solve_cpu_translation_rule(c, dl, d, du, b):
+  dtype = c.GetShape(d).element_type().type
+  if (dtype in _cpu_lapack_types and _cpu_batched_lapack and
+      hasattr(lapack, "gtsv")):
+    x, info = lapack.gtsv(c, dl, d, du, b)
+    return _nan_on_info(c, x, info)
+  else:
+    return xla.lower_fun(_tridiagonal_solve_python, instantiate=True)(
+        c, dl, d, du, b)
+
+xla.backend_specific_translations['cpu'][tridiagonal_solve_p] = \
+    _tridiagonal_solve_cpu_translation_rule
+
+
+def _banded_solve_python(ab, b, lower_bandwidth, upper_bandwidth):
+  a = _band_to_dense(ab, lower_bandwidth, upper_bandwidth)
+  return _general_solve_python(a, b, trans=0)
+
+def _banded_solve_shape_rule(ab, b, lower_bandwidth, upper_bandwidth):
+  if lower_bandwidth < 0 or upper_bandwidth < 0 or \
+     ab.ndim < 2 or ab.shape[-2] != lower_bandwidth + upper_bandwidth + 1:
+    msg = ("banded_solve requires ab to have lower_bandwidth + "
+           "upper_bandwidth + 1 = {} rows, got ab={}")
+    raise TypeError(msg.format(lower_bandwidth + upper_bandwidth + 1,
+                               ab.shape))
+  return _band_solve_shape_rule(ab, b)
+
+def _banded_solve_jvp_rule_ab(g_ab, ans, ab, b, lower_bandwidth,
+                              upper_bandwidth):
+  g_a_x = _banded_matmul(g_ab, ans, lower_bandwidth, upper_bandwidth)
+  return banded_solve(ab, lax.neg(g_a_x), lower_bandwidth, upper_bandwidth)
+
+def _banded_solve_transpose_rule(cotangent, ab, b, lower_bandwidth,
+                                 upper_bandwidth):
+  assert ab is not None and b is None
+  ab_t = _band_transpose(ab, lower_bandwidth, upper_bandwidth)
+  return [None, banded_solve(ab_t, cotangent, upper_bandwidth,
+                             lower_bandwidth)]
+
+banded_solve_p = standard_primitive(
+    _banded_solve_shape_rule, _solve_dtype_rule, 'banded_solve',
+    translation_rule=xla.lower_fun(_banded_solve_python, instantiate=True))
+ad.defjvp2(banded_solve_p,
+           _banded_solve_jvp_rule_ab,
+           lambda g_b, _, ab, b, **kws: banded_solve_p.bind(ab, g_b, **kws))
+ad.primitive_transposes[banded_solve_p] = _banded_solve_transpose_rule
+batching.primitive_batchers[banded_solve_p] = partial(
+    _solve_batching_rule, banded_solve_p)
+
+def _banded_solve_cpu_translation_rule(c, ab, b, lower_bandwidth,
+                                       upper_bandwidth):
+  dtype = c.GetShape(ab).element_type().type
+  if (dtype in _cpu_lapack_types and _cpu_batched_lapack and
+      hasattr(lapack, "gbsv")):
+    x, info = lapack.gbsv(c, ab, b, lower_bandwidth, upper_bandwidth)
+    return _nan_on_info(c, x, info)
+  else:
+    return xla.lower_fun(_banded_solve_python, instantiate=True)(
+        c, ab, b, lower_bandwidth=lower_bandwidth,
+        upper_bandwidth=upper_bandwidth)
+
+xla.backend_specific_translations['cpu'][banded_solve_p] = \
+    _banded_solve_cpu_translation_rule
+
+
+def _positive_definite_banded_solve_python(ab, b, lower):
+  kl, ku = _hermitian_band_bandwidths(ab, lower)
+  return _positive_definite_solve_python(_band_to_dense(ab, kl, ku), b, lower)
+
+def _positive_definite_banded_solve_jvp_rule_ab(g_ab, ans, ab, b, lower):
+  g_a_x = _hermitian_banded_matmul(g_ab, ans, lower)
+  return positive_definite_banded_solve(ab, lax.neg(g_a_x), lower=lower)
+
+def _positive_definite_banded_solve_transpose_rule(cotangent, ab, b, lower):
+  # a is Hermitian, so a^T = conj(a).
+  assert ab is not None and b is None
+  return [None, positive_definite_banded_solve(np.conj(ab), cotangent,
+                                               lower=lower)]
+
+positive_definite_banded_solve_p = standard_primitive(
+    _band_solve_shape_rule, _solve_dtype_rule,
+    'positive_definite_banded_solve',
+    translation_rule=xla.lower_fun(_positive_definite_banded_solve_python,
+                                   instantiate=True))
+ad.defjvp2(positive_definite_banded_solve_p,
+           _positive_definite_banded_solve_jvp_rule_ab,
+           lambda g_b, _, ab, b, **kws:
+               positive_definite_banded_solve(ab, g_b, **kws))
+ad.primitive_transposes[positive_definite_banded_solve_p] = \
+    _positive_definite_banded_solve_transpose_rule
+batching.primitive_batchers[positive_definite_banded_solve_p] = partial(
+    _solve_batching_rule, positive_definite_banded_solve_p)
+
+def _positive_definite_banded_solve_cpu_translation_rule(c, ab, b, lower):
+  dtype = c.GetShape(ab).element_type().type
+  if (dtype in _cpu_lapack_types and _cpu_batched_lapack and
+      hasattr(lapack, "pbsv")):
+    x, info = lapack.pbsv(c, ab, b, lower=lower)
+    return _nan_on_info(c, x, info)
+  else:
+    return xla.lower_fun(_positive_definite_banded_solve_python,
+                         instantiate=True)(c, ab, b, lower=lower)
+
+xla.backend_specific_translations['cpu'][positive_definite_banded_solve_p] = \
+    _positive_definite_banded_solve_cpu_translation_rule
 
 
 # QR decomposition
@@ -664,6 +1537,43 @@ qr_p.def_impl(qr_impl)
 qr_p.def_abstract_eval(qr_abstract_eval)
 xla.translations[qr_p] = qr_translation_rule
 ad.primitive_jvps[qr_p] = qr_jvp_rule
+
+def qr_cpu_translation_rule(c, operand, full_matrices):
+  shape = c.GetShape(operand)
+  dtype = shape.element_type().type
+  dims = shape.dimensions()
+  if (dtype not in _cpu_lapack_types or not _cpu_batched_lapack or
+      not hasattr(lapack, "geqrf")):
+    return c.QR(operand, full_matrices=full_matrices)
+
+  batch_dims = dims[:-2]
+  m, n = dims[-2:]
+  k = min(m, n)
+  zero = c.Constant(onp.array(0, dtype=dtype))
+  r, tau, _ = lapack.geqrf(c, operand)
+
+  # ?orgqr needs at least as many rows as columns, so Q is built from the
+  # first k reflectors, padded out to m columns when the full Q is wanted.
+  if m < n:
+    q = c.Slice(r, (0,) * len(dims), batch_dims + (m, m))
+  elif full_matrices and m > n:
+    q = c.Pad(r, zero, [(0, 0, 0)] * len(batch_dims) + [(0, 0, 0),
+                                                         (0, m - n, 0)])
+  else:
+    q = r
+  q, _ = lapack.orgqr(c, q, tau)
+
+  # R is the upper triangle left behind by ?geqrf.
+  if not full_matrices and m > n:
+    r = c.Slice(r, (0,) * len(dims), batch_dims + (k, n))
+  r_dims = c.GetShape(r).dimensions()
+  ndims = len(r_dims)
+  upper = c.Ge(c.BroadcastedIota(onp.int32, r_dims, ndims - 1),
+               c.BroadcastedIota(onp.int32, r_dims, ndims - 2))
+  r = c.Select(upper, r, c.Broadcast(zero, r_dims))
+  return c.Tuple(q, r)
+
+xla.backend_specific_translations['cpu'][qr_p] = qr_cpu_translation_rule
 batching.primitive_batchers[qr_p] = qr_batching_rule
 
 
@@ -721,23 +1631,27 @@ def svd_jvp_rule(primals, tangents, full_matrices, compute_uv):
     dV = dV + np.dot(np.eye(n) - np.dot(V, Vt), np.dot(np.conj(dA).T, U)) / s_dim
   return core.pack((s, U, Vt)), core.pack((ds, dU, dV.T))
 
-def _svd_cpu_gpu_translation_rule(gesvd_impl, c, operand, full_matrices, compute_uv):
+def _svd_cpu_gpu_translation_rule(gesvd_impl, batched, c, operand,
+                                  full_matrices, compute_uv):
   shape = c.GetShape(operand)
   dtype = shape.element_type().type
-  if len(shape.dimensions()) == 2 and dtype in _cpu_lapack_types:
+  dims = shape.dimensions()
+  if (len(dims) == 2 or batched) and dtype in _cpu_lapack_types:
+    batch_dims = dims[:-2]
     s, u, vt, info = gesvd_impl(c, operand, full_matrices=full_matrices,
                                 compute_uv=compute_uv)
     ok = c.Eq(info, c.ConstantS32Scalar(0))
-    s = _broadcasting_select(c, c.Reshape(ok, None, (1,)), s,
+    s = _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1,)), s,
                              _nan_like(c, s))
-    u = _broadcasting_select(c, c.Reshape(ok, None, (1, 1)), u,
+    u = _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1, 1)), u,
                              _nan_like(c, u))
-    vt = _broadcasting_select(c, c.Reshape(ok, None, (1, 1)), vt,
+    vt = _broadcasting_select(c, c.Reshape(ok, None, batch_dims + (1, 1)), vt,
                               _nan_like(c, vt))
     return c.Tuple(s, u, vt)
   else:
     raise NotImplementedError(
-        "Only unbatched singular value decomposition is implemented on CPU")
+        "Only unbatched singular value decomposition is implemented on this "
+        "backend")
 
 def svd_batching_rule(batched_args, batch_dims, full_matrices, compute_uv):
   x, = batched_args
@@ -760,10 +1674,10 @@ else:
   _cpu_gesdd = _unpack_tuple(lapack.jax_gesdd, 4)
 
 xla.backend_specific_translations['cpu'][svd_p] = partial(
-  _svd_cpu_gpu_translation_rule, _cpu_gesdd)
+  _svd_cpu_gpu_translation_rule, _cpu_gesdd, _cpu_batched_lapack)
 
 # TODO(phawkins): remove if-condition after increasing minimum Jaxlib version to
 # 0.1.23.
 if cusolver:
   xla.backend_specific_translations['gpu'][svd_p] = partial(
-    _svd_cpu_gpu_translation_rule, cusolver.gesvd)
+    _svd_cpu_gpu_translation_rule, cusolver.gesvd, False)
@@ -98,6 +98,12 @@ def eig(a):
   return w, vr
 
 
+@_wraps(onp.linalg.eigvals)
+def eigvals(a):
+  a = _promote_arg_dtypes(np.asarray(a))
+  return lax_linalg.eigvals(a)
+
+
 @_wraps(onp.linalg.eigh)
 def eigh(a, UPLO=None, symmetrize_input=True):
   if UPLO is None or UPLO == "L":
@@ -113,6 +119,16 @@ def eigh(a, UPLO=None, symmetrize_input=True):
   return w, v
 
 
+@_wraps(onp.linalg.eigvalsh)
+def eigvalsh(a, UPLO='L'):
+  if UPLO not in ("L", "U"):
+    msg = "UPLO must be one of 'L' or 'U', got {}".format(UPLO)
+    raise ValueError(msg)
+
+  a = _promote_arg_dtypes(np.asarray(a))
+  return lax_linalg.eigvalsh(a, lower=UPLO == "L")
+
+
 @_wraps(onp.linalg.inv)
 def inv(a):
   if np.ndim(a) < 2 or a.shape[-1] != a.shape[-2]:
@@ -228,7 +244,7 @@ def qr(a, mode="reduced"):
 
 
 @_wraps(onp.linalg.solve)
-def solve(a, b):
+def solve(a, b, mixed_precision=False):
   a, b = _promote_arg_dtypes(np.asarray(a), np.asarray(b))
   a_shape = np.shape(a)
   b_shape = np.shape(b)
@@ -238,27 +254,26 @@ def solve(a, b):
     msg = ("The arguments to solve must have shapes a=[..., m, m] and "
            "b=[..., m, k] or b=[..., m]; got a={} and b={}")
     raise ValueError(msg.format(a_shape, b_shape))
-  lu, pivots = lax_linalg.lu(a)
-  dtype = lax.dtype(a)
-
   m = a_shape[-1]
 
   # Numpy treats the RHS as a (batched) vector if the number of dimensions
   # differ by 1. Otherwise, broadcasting rules apply.
   x = b[..., None] if a_ndims == b_ndims + 1 else b
 
-  batch_dims = lax.broadcast_shapes(lu.shape[:-2], x.shape[:-2])
+  batch_dims = lax.broadcast_shapes(a_shape[:-2], x.shape[:-2])
   x = np.broadcast_to(x, batch_dims + x.shape[-2:])
-  lu = np.broadcast_to(lu, batch_dims + lu.shape[-2:])
-
-  permutation = lax_linalg.lu_pivots_to_permutation(pivots, m)
-  permutation = np.broadcast_to(permutation, batch_dims + (m,))
-  iotas = np.ix_(*(lax.iota(np.int32, b) for b in batch_dims + (1,)))
-  x = x[iotas[:-1] + (permutation, slice(None))]
-
-  x = lax_linalg.triangular_solve(lu, x, left_side=True, lower=True,
-                                  unit_diagonal=True)
-  x = lax_linalg.triangular_solve(lu, x, left_side=True, lower=False)
+  if mixed_precision:
+    # The mixed-precision solver factors and refines each system separately.
+    a = np.broadcast_to(a, batch_dims + (m, m))
+  if np.shape(a)[:-2] == batch_dims:
+    x = lax_linalg.general_solve(a, x, mixed_precision=mixed_precision)
+  else:
+    # Factor each distinct matrix once and share the factors across the
+    # broadcast batch, rather than refactoring a broadcast copy of `a`.
+    lu, pivots = lax_linalg.lu(a)
+    lu = np.broadcast_to(lu, batch_dims + (m, m))
+    pivots = np.broadcast_to(pivots, batch_dims + (m,))
+    x = lax_linalg.lu_solve(lu, pivots, x)
 
   return x[..., 0] if a_ndims == b_ndims + 1 else x
 
@@ -58,13 +58,10 @@ def cho_solve(c_and_lower, b, overwrite_b=False, check_finite=True):
            "b=[..., m, k] or b=[..., m]; got a={} and b={}")
     raise ValueError(msg.format(c_shape, b_shape))
 
-  # TODO(phawkins): triangular_solve only supports matrices on the RHS, so we
+  # TODO(phawkins): cholesky_solve only supports matrices on the RHS, so we
   # add a dummy dimension. Extend it to support vectors and simplify this.
   b = b if c_ndims == b_ndims else b[..., None]
-  b = lax_linalg.triangular_solve(c, b, left_side=True, lower=lower,
-                                  transpose_a=not lower, conjugate_a=not lower)
-  b = lax_linalg.triangular_solve(c, b, left_side=True, lower=lower,
-                                  transpose_a=lower, conjugate_a=lower)
+  b = lax_linalg.cholesky_solve(c, b, lower=lower)
   return b[..., 0] if c_ndims != b_ndims else b
 
 
@@ -91,12 +88,15 @@ def eigh(a, b=None, lower=True, eigvals_only=False, overwrite_a=False,
     raise NotImplementedError("Only the b=None case of eigh is implemented")
   if type != 1:
     raise NotImplementedError("Only the type=1 case of eigh is implemented.")
-  if eigvals is not None:
-    raise NotImplementedError(
-        "Only the eigvals=None case of eigh is implemented.")
 
   a = np_linalg._promote_arg_dtypes(np.asarray(a))
-  v, w = lax_linalg.eigh(a, lower=lower)
+  if eigvals is None and eigvals_only:
+    return lax_linalg.eigvalsh(a, lower=lower)
+  elif eigvals is None:
+    v, w = lax_linalg.eigh(a, lower=lower)
+  else:
+    lo, hi = eigvals
+    v, w = lax_linalg.eigh_subset(a, (lo, hi + 1), lower=lower)
 
   if eigvals_only:
     return w
@@ -118,6 +118,29 @@ def lu_factor(a, overwrite_a=False, check_finite=True):
   return lax_linalg.lu(a)
 
 
+@_wraps(scipy.linalg.lu_solve)
+def lu_solve(lu_and_piv, b, trans=0, overwrite_b=False, check_finite=True):
+  del overwrite_b, check_finite
+  lu, pivots = lu_and_piv
+
+  if trans == 0 or trans == "N":
+    trans = 0
+  elif trans == 1 or trans == "T":
+    trans = 1
+  elif trans == 2 or trans == "C":
+    trans = 2
+  else:
+    raise ValueError("Invalid 'trans' value {}".format(trans))
+
+  lu, b = np_linalg._promote_arg_dtypes(np.asarray(lu), np.asarray(b))
+  pivots = lax.convert_element_type(pivots, np.int32)
+  b_is_vector = np.ndim(lu) == np.ndim(b) + 1
+  if b_is_vector:
+    b = b[..., None]
+  out = lax_linalg.lu_solve(lu, pivots, b, trans=trans)
+  return out[..., 0] if b_is_vector else out
+
+
 @_wraps(scipy.linalg.lu)
 def lu(a, permute_l=False, overwrite_a=False, check_finite=True):
   del overwrite_a, check_finite
@@ -157,13 +180,45 @@ def qr(a, overwrite_a=False, lwork=None, mode="full", pivoting=False,
 
 @_wraps(scipy.linalg.solve)
 def solve(a, b, sym_pos=False, lower=False, overwrite_a=False, overwrite_b=False,
-          debug=False, check_finite=True):
+          debug=False, check_finite=True, mixed_precision=False):
   del overwrite_a, overwrite_b, debug, check_finite
   if not sym_pos:
-    return np_linalg.solve(a, b)
+    return np_linalg.solve(a, b, mixed_precision=mixed_precision)
 
   a, b = np_linalg._promote_arg_dtypes(np.asarray(a), np.asarray(b))
-  return cho_solve(cho_factor(a, lower=lower), b)
+  b_is_vector = np.ndim(a) == np.ndim(b) + 1
+  if b_is_vector:
+    b = b[..., None]
+  out = lax_linalg.positive_definite_solve(a, b, lower=lower,
+                                          mixed_precision=mixed_precision)
+  return out[..., 0] if b_is_vector else out
+
+
+@_wraps(scipy.linalg.solve_banded)
+def solve_banded(l_and_u, ab, b, overwrite_ab=False, overwrite_b=False,
+                 debug=None, check_finite=True):
+  del overwrite_ab, overwrite_b, debug, check_finite
+  l, u = l_and_u
+
+  ab, b = np_linalg._promote_arg_dtypes(np.asarray(ab), np.asarray(b))
+  b_is_vector = np.ndim(ab) == np.ndim(b) + 1
+  if b_is_vector:
+    b = b[..., None]
+  out = lax_linalg.banded_solve(ab, b, l, u)
+  return out[..., 0] if b_is_vector else out
+
+
+@_wraps(scipy.linalg.solveh_banded)
+def solveh_banded(ab, b, overwrite_ab=False, overwrite_b=False, lower=False,
+                  check_finite=True):
+  del overwrite_ab, overwrite_b, check_finite
+
+  ab, b = np_linalg._promote_arg_dtypes(np.asarray(ab), np.asarray(b))
+  b_is_vector = np.ndim(ab) == np.ndim(b) + 1
+  if b_is_vector:
+    b = b[..., None]
+  out = lax_linalg.positive_definite_banded_solve(ab, b, lower=lower)
+  return out[..., 0] if b_is_vector else out
 
 
 @_wraps(scipy.linalg.solve_triangular)
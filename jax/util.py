@@ -33,6 +33,8 @@ def safe_zip(*args):
 
 
 def safe_map(f, *args):
+  if len(args) == 1:
+    return list(map(f, args[0]))
   args = list(map(list, args))
   n = len(args[0])
   for arg in args[1:]:
@@ -96,6 +98,7 @@ def curry(f):
 
 def toposort(end_node):
   child_counts = {}
+  parents = {}  # node.parents may be recomputed on each access
   stack = [end_node]
   while stack:
     node = stack.pop()
@@ -103,14 +106,15 @@ def toposort(end_node):
       child_counts[id(node)] += 1
     else:
       child_counts[id(node)] = 1
-      stack.extend(node.parents)
+      parents[id(node)] = node.parents
+      stack.extend(parents[id(node)])
 
   sorted_nodes = []
   childless_nodes = [end_node]
   while childless_nodes:
     node = childless_nodes.pop()
     sorted_nodes.append(node)
-    for parent in node.parents:
+    for parent in parents[id(node)]:
       if child_counts[id(parent)] == 1:
         childless_nodes.append(parent)
       else:
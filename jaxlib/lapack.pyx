@@ -19,17 +19,34 @@
 
 from __future__ import print_function
 
-from libc.stdlib cimport malloc, free
+cimport cython
 from libc.stdint cimport int32_t
-from libc.string cimport memcpy
+from libc.math cimport fabs, sqrt
+from libc.string cimport memcpy, memset
+from libcpp.map cimport map
 from libcpp.string cimport string
+from libcpp.utility cimport pair
+from libcpp.vector cimport vector
+from posix.time cimport clock_gettime, timespec, CLOCK_MONOTONIC
 from cpython.pycapsule cimport PyCapsule_New
 
 from scipy.linalg.cython_blas cimport strsm, dtrsm, ctrsm, ztrsm
+from scipy.linalg.cython_blas cimport sgemm, dgemm, cgemm, zgemm
 from scipy.linalg.cython_lapack cimport sgetrf, dgetrf, cgetrf, zgetrf
+from scipy.linalg.cython_lapack cimport sgetrs, dgetrs, cgetrs, zgetrs
+from scipy.linalg.cython_lapack cimport sgesv, dgesv, cgesv, zgesv
 from scipy.linalg.cython_lapack cimport spotrf, dpotrf, cpotrf, zpotrf
+from scipy.linalg.cython_lapack cimport spotrs, dpotrs, cpotrs, zpotrs
+from scipy.linalg.cython_lapack cimport sposv, dposv, cposv, zposv
+from scipy.linalg.cython_lapack cimport dsgesv, zcgesv, dsposv, zcposv
+from scipy.linalg.cython_lapack cimport sgtsv, dgtsv, cgtsv, zgtsv
+from scipy.linalg.cython_lapack cimport sgbsv, dgbsv, cgbsv, zgbsv
+from scipy.linalg.cython_lapack cimport spbsv, dpbsv, cpbsv, zpbsv
+from scipy.linalg.cython_lapack cimport sgeqrf, dgeqrf, cgeqrf, zgeqrf
+from scipy.linalg.cython_lapack cimport sorgqr, dorgqr, cungqr, zungqr
 from scipy.linalg.cython_lapack cimport sgesdd, dgesdd, cgesdd, zgesdd
 from scipy.linalg.cython_lapack cimport ssyevd, dsyevd, cheevd, zheevd
+from scipy.linalg.cython_lapack cimport ssyevr, dsyevr, cheevr, zheevr
 from scipy.linalg.cython_lapack cimport sgeev, dgeev, cgeev, zgeev
 
 import numpy as np
@@ -37,31 +54,373 @@ from jaxlib import xla_client
 
 Shape = xla_client.Shape
 
+def _custom_call(c, fn, operands, shape_with_layout,
+                 operand_shapes_with_layout):
+  """Builds a CustomCall to `fn`, instrumented if kernel stats are enabled."""
+  if _kernel_stats_enabled and fn in _kernel_ids:
+    fn, operands, operand_shapes_with_layout = _instrument(
+        c, fn, operands, operand_shapes_with_layout)
+  return c.CustomCall(
+      fn, operands=operands, shape_with_layout=shape_with_layout,
+      operand_shapes_with_layout=operand_shapes_with_layout)
+
 
+# Layouts of a batch of matrices with `num_bd` batch dimensions.
+#
+# XLA arrays are row-major by default, so every column-major operand costs a
+# transposing copy on the way in and every column-major result one on the way
+# out. A row-major matrix is the column-major storage of its transpose, so
+# builders whose LAPACK call can be rephrased in terms of the transposed
+# problem (for example A^T = U^T U for Cholesky, with the opposite `uplo`)
+# use row-major layouts and adjust the arguments they pass instead.
+def _column_major_layout(num_bd):
+  return (num_bd, num_bd + 1) + tuple(range(num_bd - 1, -1, -1))
+
+def _row_major_layout(num_bd):
+  return tuple(range(num_bd + 1, -1, -1))
+
+
+ctypedef void (*custom_call_fn)(void* out, void** data) noexcept nogil
+
+# Every registered kernel, indexed by the id that `lapack_instrumented` is
+# passed to identify it.
+cdef vector[custom_call_fn] _kernel_fns
+_kernel_names = []
+_kernel_ids = {}
+
+# TODO: declare operand-output aliasing for the kernels that compute an
+# output in place from an operand (trsm, getrf, potrf, gesdd, syevd, ...), so
+# that XLA can donate a dead operand's buffer and the kernel's memcpy of it is
+# skipped. The XLA client jaxlib is built against has no way to express this
+# on CustomCall yet.
 cdef register_cpu_custom_call_target(fn_name, void* fn):
   cdef const char* name = "xla._CPU_CUSTOM_CALL_TARGET"
+  _kernel_ids[fn_name] = len(_kernel_names)
+  _kernel_names.append(fn_name)
+  _kernel_fns.push_back(<custom_call_fn>fn)
   xla_client.register_cpu_custom_call_target(
     fn_name, PyCapsule_New(fn, name, NULL))
 
+# Thread pool for batched kernels.
+#
+# The batched kernels below loop over their batch on the calling XLA thread.
+# For batches of small matrices neither that loop nor the BLAS underneath it
+# uses more than one core, so the kernels instead hand their loop to
+# `parallel_batch`, which splits it into chunks across a process-wide pool of
+# worker threads. The calling thread always takes part; if another custom call
+# already owns the pool, the batch simply runs serially on the caller.
+
+cdef extern from "<pthread.h>" nogil:
+  ctypedef struct pthread_t:
+    pass
+  ctypedef struct pthread_attr_t:
+    pass
+  ctypedef struct pthread_mutex_t:
+    pass
+  ctypedef struct pthread_mutexattr_t:
+    pass
+  ctypedef struct pthread_cond_t:
+    pass
+  ctypedef struct pthread_condattr_t:
+    pass
+  int pthread_create(pthread_t*, const pthread_attr_t*,
+                     void* (*)(void*) noexcept nogil, void*)
+  int pthread_detach(pthread_t)
+  int pthread_mutex_init(pthread_mutex_t*, const pthread_mutexattr_t*)
+  int pthread_mutex_lock(pthread_mutex_t*)
+  int pthread_mutex_trylock(pthread_mutex_t*)
+  int pthread_mutex_unlock(pthread_mutex_t*)
+  int pthread_cond_init(pthread_cond_t*, const pthread_condattr_t*)
+  int pthread_cond_wait(pthread_cond_t*, pthread_mutex_t*)
+  int pthread_cond_signal(pthread_cond_t*)
+  int pthread_cond_broadcast(pthread_cond_t*)
+
+# Computes elements [begin, end) of a batch. `slot` is in [0, parallelism) and
+# is distinct among the threads working on the batch, so kernels that need
+# scratch space can give each thread its own.
+ctypedef void (*batch_fn)(void* out, void** data, int begin, int end,
+                          int slot) noexcept nogil
+
+# Work per thread, in flops, below which waking another thread costs more
+# than it saves.
+DEF MIN_FLOPS_PER_THREAD = 1e5
+
+# Work per matrix, in flops, above which the BLAS parallelizes each call
+# internally; batch-level threads would only oversubscribe the machine.
+#
+# This is only an estimate of where the BLAS starts threading. The pool doesn't
+# limit the BLAS's own threads, so with a multithreaded BLAS that threads calls
+# below this size, a batch can run up to (pool threads x BLAS threads) at once.
+# If that happens, limit one or the other, via set_max_threads or
+# JAX_LAPACK_NUM_THREADS, or the BLAS's own setting (e.g. OPENBLAS_NUM_THREADS
+# or MKL_NUM_THREADS).
+DEF BLAS_THREADING_FLOPS = 1e7
+
+cdef pthread_mutex_t _pool_mu       # Guards all of the _pool and _job state.
+cdef pthread_mutex_t _pool_owner_mu # Held by the call that owns the pool.
+cdef pthread_cond_t _pool_work_cv   # Signalled when a new batch is posted.
+cdef pthread_cond_t _pool_done_cv   # Signalled when the last helper finishes.
+cdef int _pool_max_threads = 1      # Thread limit, counting the caller.
+cdef int _pool_num_workers = 0      # Worker threads started so far.
+cdef unsigned long _pool_generation = 0
+
+cdef batch_fn _job_fn
+cdef void* _job_out
+cdef void** _job_data
+cdef int _job_size = 0
+cdef int _job_chunk = 1
+cdef int _job_next = 0
+cdef int _job_parallelism = 0       # Zero once the batch no longer takes help.
+cdef int _job_joined = 0
+cdef int _job_running = 0
+
+pthread_mutex_init(&_pool_mu, NULL)
+pthread_mutex_init(&_pool_owner_mu, NULL)
+pthread_cond_init(&_pool_work_cv, NULL)
+pthread_cond_init(&_pool_done_cv, NULL)
+
+# Runs chunks of the current batch until none are left. Called, and returns,
+# with _pool_mu held.
+cdef void _run_chunks(int slot) noexcept nogil:
+  global _job_next
+  cdef int begin, end
+  while _job_next < _job_size:
+    begin = _job_next
+    end = min(begin + _job_chunk, _job_size)
+    _job_next = end
+    pthread_mutex_unlock(&_pool_mu)
+    _job_fn(_job_out, _job_data, begin, end, slot)
+    pthread_mutex_lock(&_pool_mu)
+
+cdef void* _pool_worker(void* arg) noexcept nogil:
+  global _job_joined, _job_running
+  cdef unsigned long seen = 0
+  cdef int slot
+  pthread_mutex_lock(&_pool_mu)
+  while True:
+    if _pool_generation != seen:
+      seen = _pool_generation
+      if _job_joined < _job_parallelism:
+        slot = _job_joined
+        _job_joined += 1
+        _job_running += 1
+        _run_chunks(slot)
+        _job_running -= 1
+        if _job_running == 0:
+          pthread_cond_signal(&_pool_done_cv)
+        continue
+    pthread_cond_wait(&_pool_work_cv, &_pool_mu)
+  return NULL
+
+cdef void parallel_batch(batch_fn fn, void* out, void** data, int size,
+                         int parallelism) noexcept nogil:
+  global _job_fn, _job_out, _job_data, _job_size, _job_chunk, _job_next
+  global _job_parallelism, _job_joined, _job_running, _pool_generation
+  global _pool_num_workers
+  cdef pthread_t thread
+  if parallelism <= 1 or pthread_mutex_trylock(&_pool_owner_mu) != 0:
+    fn(out, data, 0, size, 0)
+    return
+
+  pthread_mutex_lock(&_pool_mu)
+  while _pool_num_workers < parallelism - 1:
+    if pthread_create(&thread, NULL, _pool_worker, NULL) != 0:
+      break
+    pthread_detach(thread)
+    _pool_num_workers += 1
+
+  _job_fn = fn
+  _job_out = out
+  _job_data = data
+  _job_size = size
+  _job_parallelism = min(parallelism, _pool_num_workers + 1)
+  # A few chunks per thread evens out matrices that converge at different
+  # rates without paying for a lock round trip per matrix.
+  _job_chunk = max(1, size // (4 * _job_parallelism))
+  _job_next = 0
+  _job_joined = 1
+  _job_running = 1
+  _pool_generation += 1
+  pthread_cond_broadcast(&_pool_work_cv)
+
+  _run_chunks(0)
+  _job_running -= 1
+  _job_parallelism = 0
+  while _job_running > 0:
+    pthread_cond_wait(&_pool_done_cv, &_pool_mu)
+  pthread_mutex_unlock(&_pool_mu)
+  pthread_mutex_unlock(&_pool_owner_mu)
+
+# Cost model: the number of threads to split a batch of `b` problems, each
+# costing about `flops`, across. Problems big enough for the BLAS to thread
+# internally are left to it, and small batches stay on one thread unless each
+# thread gets enough work to amortize waking it.
+cdef int batch_parallelism(int b, double flops) noexcept nogil:
+  if _pool_max_threads <= 1 or b <= 1 or flops >= BLAS_THREADING_FLOPS:
+    return 1
+  cdef double threads = b * flops / MIN_FLOPS_PER_THREAD
+  if threads < 1:
+    return 1
+  return <int>min(threads, <double>min(b, _pool_max_threads))
+
+def set_max_threads(int n):
+  """Sets the number of threads, including the calling one, that batched
+  LAPACK custom calls may use. Computations built afterwards size their
+  per-thread workspaces for at most this many threads."""
+  if n < 1:
+    raise ValueError("Thread limit must be positive, got {}".format(n))
+  global _pool_max_threads
+  _pool_max_threads = n
+
+def get_max_threads():
+  return _pool_max_threads
+
+def _default_max_threads():
+  import multiprocessing
+  import os
+  n = os.getenv("JAX_LAPACK_NUM_THREADS")
+  if n is not None:
+    return int(n)
+  try:
+    return multiprocessing.cpu_count()
+  except NotImplementedError:
+    return 1
+
+set_max_threads(_default_max_threads())
+
+# Kernel statistics.
+#
+# While statistics are enabled, computations built afterwards call each kernel
+# through `lapack_instrumented`, which times the call and adds it to the
+# totals for that kernel and problem size. The kernel's id and the problem
+# size are passed to it as four extra leading operands. Computations built
+# while statistics are disabled call the kernels directly, and pay nothing.
+
+ctypedef pair[pair[int, int], pair[int, int]] _stats_key  # ((id, batch), (m, n))
+
+cdef struct _kernel_stats:
+  long long calls
+  long long total_ns
+  long long max_ns
+
+cdef pthread_mutex_t _stats_mu
+pthread_mutex_init(&_stats_mu, NULL)
+cdef map[_stats_key, _kernel_stats] _stats
+_kernel_stats_enabled = False
+
+cdef long long _now_ns() noexcept nogil:
+  cdef timespec t
+  clock_gettime(CLOCK_MONOTONIC, &t)
+  return t.tv_sec * 1000000000LL + t.tv_nsec
+
+cdef void lapack_instrumented(void* out, void** data) noexcept nogil:
+  cdef _stats_key key
+  key.first.first = (<int32_t*>(data[0]))[0]
+  key.first.second = (<int32_t*>(data[1]))[0]
+  key.second.first = (<int32_t*>(data[2]))[0]
+  key.second.second = (<int32_t*>(data[3]))[0]
+
+  cdef long long start = _now_ns()
+  _kernel_fns[key.first.first](out, &data[4])
+  cdef long long ns = _now_ns() - start
+
+  pthread_mutex_lock(&_stats_mu)
+  cdef _kernel_stats* s = &_stats[key]
+  s.calls += 1
+  s.total_ns += ns
+  if ns > s.max_ns:
+    s.max_ns = ns
+  pthread_mutex_unlock(&_stats_mu)
+
+xla_client.register_cpu_custom_call_target(
+  b"lapack_instrumented",
+  PyCapsule_New(<void*>lapack_instrumented, "xla._CPU_CUSTOM_CALL_TARGET",
+                NULL))
+
+def _instrument(c, fn, operands, operand_shapes_with_layout):
+  """Reroutes a CustomCall to `fn` through `lapack_instrumented`.
+
+  The problem size recorded is that of the operand of highest rank: the
+  product of its leading dimensions, and its last two dimensions.
+  """
+  dims = max((s.dimensions() for s in operand_shapes_with_layout), key=len)
+  dims = (1, 1) + tuple(dims)
+  batch = int(np.prod(dims[:-2]))
+  scalar = Shape.array_shape(np.dtype(np.int32), (), ())
+  operands = tuple(
+      c.ConstantS32Scalar(int(v))
+      for v in (_kernel_ids[fn], batch, dims[-2], dims[-1])) + tuple(operands)
+  operand_shapes_with_layout = (
+      (scalar,) * 4 + tuple(operand_shapes_with_layout))
+  return b"lapack_instrumented", operands, operand_shapes_with_layout
+
+def set_kernel_stats_enabled(enabled):
+  """Sets whether kernels record call counts and timings.
+
+  Like `set_max_threads`, this affects only computations built afterwards.
+  Computations already compiled, including cached jit functions, keep
+  whichever kind of call they were built with.
+  """
+  global _kernel_stats_enabled
+  _kernel_stats_enabled = bool(enabled)
+
+def get_kernel_stats_enabled():
+  return _kernel_stats_enabled
+
+def get_kernel_stats():
+  """Returns the statistics recorded since the last `reset_kernel_stats`.
+
+  The result maps each kernel name that has run to a dict with keys `calls`,
+  `total_ns` and `max_ns`, and `shapes`, which maps each (batch, m, n) problem
+  size the kernel ran with to a dict of the same three statistics for it.
+  """
+  pthread_mutex_lock(&_stats_mu)
+  entries = [(e.first.first.first, e.first.first.second, e.first.second.first,
+              e.first.second.second, e.second.calls, e.second.total_ns,
+              e.second.max_ns) for e in _stats]
+  pthread_mutex_unlock(&_stats_mu)
+
+  result = {}
+  for kernel, batch, m, n, calls, total_ns, max_ns in entries:
+    name = _kernel_names[kernel].decode("ascii")
+    kernel_stats = result.setdefault(
+        name, {"calls": 0, "total_ns": 0, "max_ns": 0, "shapes": {}})
+    kernel_stats["calls"] += calls
+    kernel_stats["total_ns"] += total_ns
+    kernel_stats["max_ns"] = max(kernel_stats["max_ns"], max_ns)
+    kernel_stats["shapes"][(batch, m, n)] = {
+        "calls": calls, "total_ns": total_ns, "max_ns": max_ns}
+  return result
+
+def reset_kernel_stats():
+  pthread_mutex_lock(&_stats_mu)
+  _stats.clear()
+  pthread_mutex_unlock(&_stats_mu)
+
 # TODO(phawkins): it would be nice to avoid duplicating code for each type.
 
-# ?trsm(left_side, lower, trans_a, diag, m, n, alpha, a, b):
-# triangular solve
+# ?trsm(left_side, lower, trans_a, diag, batch, m, n, alpha, a, b):
+# triangular solve, for each of a batch of matrices
 
-cdef void blas_strsm(void* out, void** data) nogil:
+cdef void blas_strsm_range(void* out, void** data, int begin, int end,
+                          int slot) noexcept nogil:
   cdef int32_t left_side = (<int32_t*>(data[0]))[0]
   cdef int32_t lower = (<int32_t*>(data[1]))[0]
   cdef int32_t trans_a = (<int32_t*>(data[2]))[0]
   cdef int32_t diag = (<int32_t*>(data[3]))[0]
-  cdef int m = (<int32_t*>(data[4]))[0]
-  cdef int n = (<int32_t*>(data[5]))[0]
-  cdef float* alpha = <float*>(data[6])
-  cdef float* a = <float*>(data[7])
-  cdef float* b = <float*>(data[8])
+  cdef int m = (<int32_t*>(data[5]))[0]
+  cdef int n = (<int32_t*>(data[6]))[0]
+  cdef float* alpha = <float*>(data[7])
+  cdef float* a = <float*>(data[8])
+  cdef float* b = <float*>(data[9])
 
-  cdef float* x = <float*>(out)
+  cdef int lda = m if left_side else n
+  cdef int ldb = m
+  a += begin * lda * lda
+  b += begin * m * n
+  cdef float* x = <float*>(out) + begin * m * n
   if x != b:
-    memcpy(x, b, m * n * sizeof(float))
+    memcpy(x, b, (end - begin) * m * n * sizeof(float))
 
   cdef char cside = 'L' if left_side else 'R'
   cdef char cuplo = 'L' if lower else 'U'
@@ -71,26 +430,41 @@ cdef void blas_strsm(void* out, void** data) nogil:
   elif trans_a == 2:
     ctransa = 'C'
   cdef char cdiag = 'U' if diag else 'N'
-  cdef int lda = m if left_side else n
-  cdef int ldb = m
-  strsm(&cside, &cuplo, &ctransa, &cdiag, &m, &n, alpha, a, &lda, x, &ldb)
+  for _ in range(begin, end):
+    strsm(&cside, &cuplo, &ctransa, &cdiag, &m, &n, alpha, a, &lda, x, &ldb)
+    a += lda * lda
+    x += m * n
+
+cdef void blas_strsm(void* out, void** data) noexcept nogil:
+  cdef int32_t left_side = (<int32_t*>(data[0]))[0]
+  cdef int batch = (<int32_t*>(data[4]))[0]
+  cdef int m = (<int32_t*>(data[5]))[0]
+  cdef int n = (<int32_t*>(data[6]))[0]
+  cdef double flops = <double>m * n * (m if left_side else n)
+  parallel_batch(blas_strsm_range, out, data, batch,
+                 batch_parallelism(batch, flops))
 
 register_cpu_custom_call_target(b"blas_strsm", <void*>(blas_strsm))
 
-cdef void blas_dtrsm(void* out, void** data) nogil:
+cdef void blas_dtrsm_range(void* out, void** data, int begin, int end,
+                          int slot) noexcept nogil:
   cdef int32_t left_side = (<int32_t*>(data[0]))[0]
   cdef int32_t lower = (<int32_t*>(data[1]))[0]
   cdef int32_t trans_a = (<int32_t*>(data[2]))[0]
   cdef int32_t diag = (<int32_t*>(data[3]))[0]
-  cdef int m = (<int32_t*>(data[4]))[0]
-  cdef int n = (<int32_t*>(data[5]))[0]
-  cdef double* alpha = <double*>(data[6])
-  cdef double* a = <double*>(data[7])
-  cdef double* b = <double*>(data[8])
+  cdef int m = (<int32_t*>(data[5]))[0]
+  cdef int n = (<int32_t*>(data[6]))[0]
+  cdef double* alpha = <double*>(data[7])
+  cdef double* a = <double*>(data[8])
+  cdef double* b = <double*>(data[9])
 
-  cdef double* x = <double*>(out)
+  cdef int lda = m if left_side else n
+  cdef int ldb = m
+  a += begin * lda * lda
+  b += begin * m * n
+  cdef double* x = <double*>(out) + begin * m * n
   if x != b:
-    memcpy(x, b, m * n * sizeof(double))
+    memcpy(x, b, (end - begin) * m * n * sizeof(double))
 
   cdef char cside = 'L' if left_side else 'R'
   cdef char cuplo = 'L' if lower else 'U'
@@ -100,27 +474,42 @@ cdef void blas_dtrsm(void* out, void** data) nogil:
   elif trans_a == 2:
     ctransa = 'C'
   cdef char cdiag = 'U' if diag else 'N'
-  cdef int lda = m if left_side else n
-  cdef int ldb = m
-  dtrsm(&cside, &cuplo, &ctransa, &cdiag, &m, &n, alpha, a, &lda, x, &ldb)
+  for _ in range(begin, end):
+    dtrsm(&cside, &cuplo, &ctransa, &cdiag, &m, &n, alpha, a, &lda, x, &ldb)
+    a += lda * lda
+    x += m * n
+
+cdef void blas_dtrsm(void* out, void** data) noexcept nogil:
+  cdef int32_t left_side = (<int32_t*>(data[0]))[0]
+  cdef int batch = (<int32_t*>(data[4]))[0]
+  cdef int m = (<int32_t*>(data[5]))[0]
+  cdef int n = (<int32_t*>(data[6]))[0]
+  cdef double flops = <double>m * n * (m if left_side else n)
+  parallel_batch(blas_dtrsm_range, out, data, batch,
+                 batch_parallelism(batch, flops))
 
 register_cpu_custom_call_target(b"blas_dtrsm", <void*>(blas_dtrsm))
 
 
-cdef void blas_ctrsm(void* out, void** data) nogil:
+cdef void blas_ctrsm_range(void* out, void** data, int begin, int end,
+                          int slot) noexcept nogil:
   cdef int32_t left_side = (<int32_t*>(data[0]))[0]
   cdef int32_t lower = (<int32_t*>(data[1]))[0]
   cdef int32_t trans_a = (<int32_t*>(data[2]))[0]
   cdef int32_t diag = (<int32_t*>(data[3]))[0]
-  cdef int m = (<int32_t*>(data[4]))[0]
-  cdef int n = (<int32_t*>(data[5]))[0]
-  cdef float complex* alpha = <float complex*>(data[6])
-  cdef float complex* a = <float complex*>(data[7])
-  cdef float complex* b = <float complex*>(data[8])
+  cdef int m = (<int32_t*>(data[5]))[0]
+  cdef int n = (<int32_t*>(data[6]))[0]
+  cdef float complex* alpha = <float complex*>(data[7])
+  cdef float complex* a = <float complex*>(data[8])
+  cdef float complex* b = <float complex*>(data[9])
 
-  cdef float complex* x = <float complex*>(out)
+  cdef int lda = m if left_side else n
+  cdef int ldb = m
+  a += begin * lda * lda
+  b += begin * m * n
+  cdef float complex* x = <float complex*>(out) + begin * m * n
   if x != b:
-    memcpy(x, b, m * n * sizeof(float complex))
+    memcpy(x, b, (end - begin) * m * n * sizeof(float complex))
 
   cdef char cside = 'L' if left_side else 'R'
   cdef char cuplo = 'L' if lower else 'U'
@@ -130,26 +519,41 @@ cdef void blas_ctrsm(void* out, void** data) nogil:
   elif trans_a == 2:
     ctransa = 'C'
   cdef char cdiag = 'U' if diag else 'N'
-  cdef int lda = m if left_side else n
-  cdef int ldb = m
-  ctrsm(&cside, &cuplo, &ctransa, &cdiag, &m, &n, alpha, a, &lda, x, &ldb)
+  for _ in range(begin, end):
+    ctrsm(&cside, &cuplo, &ctransa, &cdiag, &m, &n, alpha, a, &lda, x, &ldb)
+    a += lda * lda
+    x += m * n
+
+cdef void blas_ctrsm(void* out, void** data) noexcept nogil:
+  cdef int32_t left_side = (<int32_t*>(data[0]))[0]
+  cdef int batch = (<int32_t*>(data[4]))[0]
+  cdef int m = (<int32_t*>(data[5]))[0]
+  cdef int n = (<int32_t*>(data[6]))[0]
+  cdef double flops = <double>m * n * (m if left_side else n)
+  parallel_batch(blas_ctrsm_range, out, data, batch,
+                 batch_parallelism(batch, flops))
 
 register_cpu_custom_call_target(b"blas_ctrsm", <void*>(blas_ctrsm))
 
-cdef void blas_ztrsm(void* out, void** data) nogil:
+cdef void blas_ztrsm_range(void* out, void** data, int begin, int end,
+                          int slot) noexcept nogil:
   cdef int32_t left_side = (<int32_t*>(data[0]))[0]
   cdef int32_t lower = (<int32_t*>(data[1]))[0]
   cdef int32_t trans_a = (<int32_t*>(data[2]))[0]
   cdef int32_t diag = (<int32_t*>(data[3]))[0]
-  cdef int m = (<int32_t*>(data[4]))[0]
-  cdef int n = (<int32_t*>(data[5]))[0]
-  cdef double complex* alpha = <double complex*>(data[6])
-  cdef double complex* a = <double complex*>(data[7])
-  cdef double complex* b = <double complex*>(data[8])
+  cdef int m = (<int32_t*>(data[5]))[0]
+  cdef int n = (<int32_t*>(data[6]))[0]
+  cdef double complex* alpha = <double complex*>(data[7])
+  cdef double complex* a = <double complex*>(data[8])
+  cdef double complex* b = <double complex*>(data[9])
 
-  cdef double complex* x = <double complex*>(out)
+  cdef int lda = m if left_side else n
+  cdef int ldb = m
+  a += begin * lda * lda
+  b += begin * m * n
+  cdef double complex* x = <double complex*>(out) + begin * m * n
   if x != b:
-    memcpy(x, b, m * n * sizeof(double complex))
+    memcpy(x, b, (end - begin) * m * n * sizeof(double complex))
 
   cdef char cside = 'L' if left_side else 'R'
   cdef char cuplo = 'L' if lower else 'U'
@@ -159,9 +563,19 @@ cdef void blas_ztrsm(void* out, void** data) nogil:
   elif trans_a == 2:
     ctransa = 'C'
   cdef char cdiag = 'U' if diag else 'N'
-  cdef int lda = m if left_side else n
-  cdef int ldb = m
-  ztrsm(&cside, &cuplo, &ctransa, &cdiag, &m, &n, alpha, a, &lda, x, &ldb)
+  for _ in range(begin, end):
+    ztrsm(&cside, &cuplo, &ctransa, &cdiag, &m, &n, alpha, a, &lda, x, &ldb)
+    a += lda * lda
+    x += m * n
+
+cdef void blas_ztrsm(void* out, void** data) noexcept nogil:
+  cdef int32_t left_side = (<int32_t*>(data[0]))[0]
+  cdef int batch = (<int32_t*>(data[4]))[0]
+  cdef int m = (<int32_t*>(data[5]))[0]
+  cdef int n = (<int32_t*>(data[6]))[0]
+  cdef double flops = <double>m * n * (m if left_side else n)
+  parallel_batch(blas_ztrsm_range, out, data, batch,
+                 batch_parallelism(batch, flops))
 
 register_cpu_custom_call_target(b"blas_ztrsm", <void*>(blas_ztrsm))
 
@@ -170,11 +584,18 @@ def trsm(c, alpha, a, b, left_side=False, lower=False, trans_a=False,
              conj_a=False, diag=False):
   b_shape = c.GetShape(b)
   dtype = b_shape.element_type()
-  m, n = b_shape.dimensions()
+  dims = b_shape.dimensions()
+  m, n = dims[-2:]
   k = m if left_side else n
+  batch_dims = tuple(dims[:-2])
+  num_bd = len(batch_dims)
+  batch = 1
+  for d in batch_dims:
+    batch *= d
 
   a_shape = c.GetShape(a)
-  if (k, k) != a_shape.dimensions() or a_shape.element_type() != dtype:
+  if (batch_dims + (k, k) != a_shape.dimensions() or
+      a_shape.element_type() != dtype):
     raise ValueError("Argument mismatch for trsm, got {} and {}".format(
       a_shape, b_shape))
 
@@ -192,17 +613,22 @@ def trsm(c, alpha, a, b, left_side=False, lower=False, trans_a=False,
   if conj_a and not trans_a:
     raise NotImplementedError("Conjugation without transposition not supported")
 
-  return c.CustomCall(
-      fn,
+  # The operands are row-major, so the kernel sees B^T and A^T. Solving
+  # op(A) X = B is then solving X^T op(A)^T = B^T: the side and the stored
+  # triangle flip and m and n swap, but op is unchanged.
+  layout = _row_major_layout(num_bd)
+  return _custom_call(
+      c, fn,
       operands=(
-        c.ConstantS32Scalar(int(left_side)),
-        c.ConstantS32Scalar(int(lower)),
+        c.ConstantS32Scalar(int(not left_side)),
+        c.ConstantS32Scalar(int(not lower)),
         c.ConstantS32Scalar((2 if conj_a else 1) if trans_a else 0),
         c.ConstantS32Scalar(int(diag)),
-        c.ConstantS32Scalar(m),
+        c.ConstantS32Scalar(batch),
         c.ConstantS32Scalar(n),
+        c.ConstantS32Scalar(m),
         alpha, a, b),
-      shape_with_layout=Shape.array_shape(dtype, b_shape.dimensions(), (0, 1)),
+      shape_with_layout=Shape.array_shape(dtype, dims, layout),
       operand_shapes_with_layout=(
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
@@ -210,99 +636,534 @@ def trsm(c, alpha, a, b, left_side=False, lower=False, trans_a=False,
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(dtype, (), ()),
-          Shape.array_shape(dtype, a_shape.dimensions(), (0, 1)),
-          Shape.array_shape(dtype, b_shape.dimensions(), (0, 1)),
+          Shape.array_shape(dtype, a_shape.dimensions(), layout),
+          Shape.array_shape(dtype, dims, layout),
       ))
 jax_trsm = trsm
 
-# ?getrf: LU decomposition
+# Batched ?gemm(trans_a, trans_b, b, m, n, k, a, b): C[i] = op(A[i]) op(B[i])
+# for a batch of row-major matrices, where op optionally transposes. Small
+# matrices are multiplied by a loop nest that the C++ compiler can unroll and
+# vectorize over the contiguous columns of B and C, which avoids the per-call
+# overhead of BLAS; larger ones go to ?gemm.
+
+ctypedef float complex float_complex
+ctypedef double complex double_complex
+
+ctypedef fused gemm_type:
+  float
+  double
+  float_complex
+  double_complex
+
+# Largest dimension of the matrices handled by the loop nest.
+DEF SMALL_GEMM_MAX_DIM = 32
+
+cdef void small_gemm(bint trans_a, bint trans_b, int m, int n, int k,
+                     gemm_type* a, gemm_type* b, gemm_type* c) noexcept nogil:
+  cdef int i, j, l
+  cdef gemm_type a_il, acc
+  if not trans_b:
+    for i in range(m * n):
+      c[i] = 0
+    for i in range(m):
+      for l in range(k):
+        a_il = a[l * m + i] if trans_a else a[i * k + l]
+        for j in range(n):
+          c[i * n + j] += a_il * b[l * n + j]
+  else:
+    for i in range(m):
+      for j in range(n):
+        acc = 0
+        for l in range(k):
+          acc += (a[l * m + i] if trans_a else a[i * k + l]) * b[j * k + l]
+        c[i * n + j] = acc
+
+cdef void gemm_batched_impl(gemm_type* c, void** data, int begin,
+                            int end) noexcept nogil:
+  cdef int32_t trans_a = (<int32_t*>(data[0]))[0]
+  cdef int32_t trans_b = (<int32_t*>(data[1]))[0]
+  cdef int m = (<int32_t*>(data[3]))[0]
+  cdef int n = (<int32_t*>(data[4]))[0]
+  cdef int k = (<int32_t*>(data[5]))[0]
+  cdef gemm_type* a = <gemm_type*>(data[6]) + begin * m * k
+  cdef gemm_type* b = <gemm_type*>(data[7]) + begin * k * n
+  c += begin * m * n
+
+  # A row-major C = op(A) op(B) is the column-major C^T = op(B)^T op(A)^T.
+  cdef char ctransa = 'T' if trans_a else 'N'
+  cdef char ctransb = 'T' if trans_b else 'N'
+  cdef int lda = m if trans_a else k
+  cdef int ldb = k if trans_b else n
+  cdef gemm_type alpha = 1
+  cdef gemm_type beta = 0
+  cdef bint small = (m <= SMALL_GEMM_MAX_DIM and n <= SMALL_GEMM_MAX_DIM and
+                     k <= SMALL_GEMM_MAX_DIM)
+
+  for _ in range(begin, end):
+    if small:
+      small_gemm(trans_a, trans_b, m, n, k, a, b, c)
+    elif gemm_type is float:
+      sgemm(&ctransb, &ctransa, &n, &m, &k, &alpha, b, &ldb, a, &lda, &beta,
+            c, &n)
+    elif gemm_type is double:
+      dgemm(&ctransb, &ctransa, &n, &m, &k, &alpha, b, &ldb, a, &lda, &beta,
+            c, &n)
+    elif gemm_type is float_complex:
+      cgemm(&ctransb, &ctransa, &n, &m, &k, &alpha, b, &ldb, a, &lda, &beta,
+            c, &n)
+    else:
+      zgemm(&ctransb, &ctransa, &n, &m, &k, &alpha, b, &ldb, a, &lda, &beta,
+            c, &n)
+    a += m * k
+    b += k * n
+    c += m * n
+
+cdef void gemm_batched_parallel(batch_fn fn, void* out, void** data) noexcept nogil:
+  cdef int batch = (<int32_t*>(data[2]))[0]
+  cdef int m = (<int32_t*>(data[3]))[0]
+  cdef int n = (<int32_t*>(data[4]))[0]
+  cdef int k = (<int32_t*>(data[5]))[0]
+  parallel_batch(fn, out, data, batch,
+                 batch_parallelism(batch, 2. * m * n * k))
+
+cdef void blas_sgemm_batched_range(void* out, void** data, int begin, int end,
+                                   int slot) noexcept nogil:
+  gemm_batched_impl(<float*>(out), data, begin, end)
+
+cdef void blas_sgemm_batched(void* out, void** data) noexcept nogil:
+  gemm_batched_parallel(blas_sgemm_batched_range, out, data)
+
+register_cpu_custom_call_target(b"blas_sgemm_batched",
+                                <void*>(blas_sgemm_batched))
+
+cdef void blas_dgemm_batched_range(void* out, void** data, int begin, int end,
+                                   int slot) noexcept nogil:
+  gemm_batched_impl(<double*>(out), data, begin, end)
+
+cdef void blas_dgemm_batched(void* out, void** data) noexcept nogil:
+  gemm_batched_parallel(blas_dgemm_batched_range, out, data)
+
+register_cpu_custom_call_target(b"blas_dgemm_batched",
+                                <void*>(blas_dgemm_batched))
+
+cdef void blas_cgemm_batched_range(void* out, void** data, int begin, int end,
+                                   int slot) noexcept nogil:
+  gemm_batched_impl(<float complex*>(out), data, begin, end)
+
+cdef void blas_cgemm_batched(void* out, void** data) noexcept nogil:
+  gemm_batched_parallel(blas_cgemm_batched_range, out, data)
+
+register_cpu_custom_call_target(b"blas_cgemm_batched",
+                                <void*>(blas_cgemm_batched))
+
+cdef void blas_zgemm_batched_range(void* out, void** data, int begin, int end,
+                                   int slot) noexcept nogil:
+  gemm_batched_impl(<double complex*>(out), data, begin, end)
+
+cdef void blas_zgemm_batched(void* out, void** data) noexcept nogil:
+  gemm_batched_parallel(blas_zgemm_batched_range, out, data)
+
+register_cpu_custom_call_target(b"blas_zgemm_batched",
+                                <void*>(blas_zgemm_batched))
 
-cdef void lapack_sgetrf(void* out_tuple, void** data) nogil:
+
+def gemm_batched(c, a, b, trans_a=False, trans_b=False):
+  """Builds a batched matrix product of row-major `a` and `b`.
+
+  `a` has shape batch_dims + (m, k), or batch_dims + (k, m) if `trans_a`, and
+  `b` has shape batch_dims + (k, n), or batch_dims + (n, k) if `trans_b`. The
+  result has shape batch_dims + (m, n).
+  """
+  a_shape = c.GetShape(a)
+  b_shape = c.GetShape(b)
+  dtype = a_shape.element_type()
+  a_dims = a_shape.dimensions()
+  b_dims = b_shape.dimensions()
+  batch_dims = tuple(a_dims[:-2])
+  m, k = a_dims[-2:][::-1] if trans_a else a_dims[-2:]
+  n = b_dims[-2] if trans_b else b_dims[-1]
+  if (tuple(b_dims[:-2]) != batch_dims or b_shape.element_type() != dtype or
+      (b_dims[-1] if trans_b else b_dims[-2]) != k):
+    raise ValueError("Argument mismatch for batched gemm, got {} and {}".format(
+      a_shape, b_shape))
+  batch = 1
+  for d in batch_dims:
+    batch *= d
+
+  if dtype == np.float32:
+    fn = b"blas_sgemm_batched"
+  elif dtype == np.float64:
+    fn = b"blas_dgemm_batched"
+  elif dtype == np.complex64:
+    fn = b"blas_cgemm_batched"
+  elif dtype == np.complex128:
+    fn = b"blas_zgemm_batched"
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  row_major = tuple(range(len(a_dims) - 1, -1, -1))
+  return _custom_call(
+      c, fn,
+      operands=(
+        c.ConstantS32Scalar(int(trans_a)),
+        c.ConstantS32Scalar(int(trans_b)),
+        c.ConstantS32Scalar(batch),
+        c.ConstantS32Scalar(m),
+        c.ConstantS32Scalar(n),
+        c.ConstantS32Scalar(k),
+        a, b),
+      shape_with_layout=Shape.array_shape(dtype, batch_dims + (m, n),
+                                          row_major),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, a_dims, row_major),
+          Shape.array_shape(dtype, b_dims, row_major),
+      ))
+
+# Small-matrix Cholesky and LU decompositions.
+#
+# For matrices of dimension SMALL_MATRIX_MAX_DIM or less, the cost of a LAPACK
+# call is dominated by call and argument-checking overhead rather than flops.
+# These kernels instead factor SMALL_BATCH_WIDTH matrices at a time, stored
+# structure-of-arrays in a stack buffer so that element (i, j) of every matrix
+# in the group is contiguous. Every arithmetic loop then runs over the group
+# with a trip count known at compile time, which the C compiler vectorizes.
+# Unused lanes of the last group are padded with the identity.
+#
+# The kernels take the same operands as their LAPACK counterparts and produce
+# the same results up to rounding, provided the factorization succeeds. On
+# failure, info is set as LAPACK would set it, but the factor may hold
+# different values.
+
+DEF SMALL_MATRIX_MAX_DIM = 8
+DEF SMALL_BATCH_WIDTH = 8
+
+ctypedef fused small_type:
+  float
+  double
+
+# Copies matrices [begin, begin + w) of `a`, each n x n, into `buf`.
+cdef void small_load(small_type* buf, const small_type* a, int n,
+                     int w) noexcept nogil:
+  cdef int e, l
+  for e in range(n * n):
+    for l in range(SMALL_BATCH_WIDTH):
+      if l < w:
+        buf[e * SMALL_BATCH_WIDTH + l] = a[l * n * n + e]
+      else:
+        buf[e * SMALL_BATCH_WIDTH + l] = 1 if e % (n + 1) == 0 else 0
+
+cdef void small_store(small_type* a, const small_type* buf, int n,
+                      int w) noexcept nogil:
+  cdef int e, l
+  for l in range(w):
+    for e in range(n * n):
+      a[l * n * n + e] = buf[e * SMALL_BATCH_WIDTH + l]
+
+# Both kernels use C division: a lane with a zero pivot must produce inf or NaN,
+# reported through info, rather than raise ZeroDivisionError without the GIL.
+@cython.cdivision(True)
+cdef void small_potrf_impl(small_type* a_out, const small_type* a_in,
+                           int* info, bint lower, int n, int begin,
+                           int end) noexcept nogil:
+  cdef small_type buf[SMALL_MATRIX_MAX_DIM * SMALL_MATRIX_MAX_DIM *
+                      SMALL_BATCH_WIDTH]
+  cdef small_type d
+  cdef int lane_info[SMALL_BATCH_WIDTH]
+  cdef int g, w, i, j, k, l, ij, ik, jk, jj
+  # Element (i, j) of the factor, which is L(i, j) when lower and U(j, i)
+  # otherwise, is stored at column-major offset i + j * n or j + i * n.
+  cdef int si = 1 if lower else n
+  cdef int sj = n if lower else 1
+
+  for g in range(begin, end, SMALL_BATCH_WIDTH):
+    w = min(SMALL_BATCH_WIDTH, end - g)
+    small_load(buf, a_in + g * n * n, n, w)
+    for l in range(SMALL_BATCH_WIDTH):
+      lane_info[l] = 0
+
+    for j in range(n):
+      jj = (j * si + j * sj) * SMALL_BATCH_WIDTH
+      for k in range(j):
+        jk = (j * si + k * sj) * SMALL_BATCH_WIDTH
+        for l in range(SMALL_BATCH_WIDTH):
+          buf[jj + l] -= buf[jk + l] * buf[jk + l]
+      for l in range(SMALL_BATCH_WIDTH):
+        d = buf[jj + l]
+        if not d > 0 and lane_info[l] == 0:
+          lane_info[l] = j + 1
+        buf[jj + l] = sqrt(d)
+      for i in range(j + 1, n):
+        ij = (i * si + j * sj) * SMALL_BATCH_WIDTH
+        for k in range(j):
+          ik = (i * si + k * sj) * SMALL_BATCH_WIDTH
+          jk = (j * si + k * sj) * SMALL_BATCH_WIDTH
+          for l in range(SMALL_BATCH_WIDTH):
+            buf[ij + l] -= buf[ik + l] * buf[jk + l]
+        for l in range(SMALL_BATCH_WIDTH):
+          buf[ij + l] /= buf[jj + l]
+
+    # The opposite triangle is left as it was, as LAPACK does.
+    small_store(a_out + g * n * n, buf, n, w)
+    for l in range(w):
+      info[g + l] = lane_info[l]
+
+@cython.cdivision(True)
+cdef void small_getrf_impl(small_type* a_out, const small_type* a_in,
+                           int* ipiv, int* info, int n, int begin,
+                           int end) noexcept nogil:
+  cdef small_type buf[SMALL_MATRIX_MAX_DIM * SMALL_MATRIX_MAX_DIM *
+                      SMALL_BATCH_WIDTH]
+  cdef small_type amax[SMALL_BATCH_WIDTH]
+  cdef small_type scale[SMALL_BATCH_WIDTH]
+  cdef small_type v, t
+  cdef int piv[SMALL_BATCH_WIDTH]
+  cdef int lane_ipiv[SMALL_MATRIX_MAX_DIM * SMALL_BATCH_WIDTH]
+  cdef int lane_info[SMALL_BATCH_WIDTH]
+  cdef int g, w, i, j, k, l, ik, kj, ij, kk
+
+  for g in range(begin, end, SMALL_BATCH_WIDTH):
+    w = min(SMALL_BATCH_WIDTH, end - g)
+    small_load(buf, a_in + g * n * n, n, w)
+    for l in range(SMALL_BATCH_WIDTH):
+      lane_info[l] = 0
+
+    for k in range(n):
+      # Partial pivoting: the first row of largest magnitude in column k.
+      kk = (k + k * n) * SMALL_BATCH_WIDTH
+      for l in range(SMALL_BATCH_WIDTH):
+        piv[l] = k
+        amax[l] = fabs(buf[kk + l])
+      for i in range(k + 1, n):
+        ik = (i + k * n) * SMALL_BATCH_WIDTH
+        for l in range(SMALL_BATCH_WIDTH):
+          v = fabs(buf[ik + l])
+          if v > amax[l]:
+            amax[l] = v
+            piv[l] = i
+      for l in range(SMALL_BATCH_WIDTH):
+        lane_ipiv[k * SMALL_BATCH_WIDTH + l] = piv[l] + 1
+        if piv[l] != k:
+          for j in range(n):
+            kj = (k + j * n) * SMALL_BATCH_WIDTH + l
+            ij = (piv[l] + j * n) * SMALL_BATCH_WIDTH + l
+            t = buf[kj]
+            buf[kj] = buf[ij]
+            buf[ij] = t
+
+      # A zero pivot leaves its column unscaled and is reported through info.
+      for l in range(SMALL_BATCH_WIDTH):
+        if buf[kk + l] != 0:
+          scale[l] = 1 / buf[kk + l]
+        else:
+          scale[l] = 1
+          if lane_info[l] == 0:
+            lane_info[l] = k + 1
+      for i in range(k + 1, n):
+        ik = (i + k * n) * SMALL_BATCH_WIDTH
+        for l in range(SMALL_BATCH_WIDTH):
+          buf[ik + l] *= scale[l]
+
+      for j in range(k + 1, n):
+        kj = (k + j * n) * SMALL_BATCH_WIDTH
+        for i in range(k + 1, n):
+          ij = (i + j * n) * SMALL_BATCH_WIDTH
+          ik = (i + k * n) * SMALL_BATCH_WIDTH
+          for l in range(SMALL_BATCH_WIDTH):
+            buf[ij + l] -= buf[ik + l] * buf[kj + l]
+
+    small_store(a_out + g * n * n, buf, n, w)
+    for l in range(w):
+      for k in range(n):
+        ipiv[(g + l) * n + k] = lane_ipiv[k * SMALL_BATCH_WIDTH + l]
+      info[g + l] = lane_info[l]
+
+cdef void lapack_spotrf_small_range(void* out_tuple, void** data, int begin,
+                                    int end, int slot) noexcept nogil:
+  cdef void** out = <void**>(out_tuple)
+  small_potrf_impl(<float*>(out[0]), <float*>(data[3]), <int*>(out[1]),
+                   (<int32_t*>(data[0]))[0], (<int32_t*>(data[2]))[0],
+                   begin, end)
+
+cdef void lapack_spotrf_small(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_spotrf_small_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>n * n * n / 3))
+
+register_cpu_custom_call_target(b"lapack_spotrf_small",
+                                <void*>(lapack_spotrf_small))
+
+cdef void lapack_dpotrf_small_range(void* out_tuple, void** data, int begin,
+                                    int end, int slot) noexcept nogil:
+  cdef void** out = <void**>(out_tuple)
+  small_potrf_impl(<double*>(out[0]), <double*>(data[3]), <int*>(out[1]),
+                   (<int32_t*>(data[0]))[0], (<int32_t*>(data[2]))[0],
+                   begin, end)
+
+cdef void lapack_dpotrf_small(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_dpotrf_small_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>n * n * n / 3))
+
+register_cpu_custom_call_target(b"lapack_dpotrf_small",
+                                <void*>(lapack_dpotrf_small))
+
+cdef void lapack_sgetrf_small_range(void* out_tuple, void** data, int begin,
+                                    int end, int slot) noexcept nogil:
+  cdef void** out = <void**>(out_tuple)
+  small_getrf_impl(<float*>(out[0]), <float*>(data[3]), <int*>(out[1]),
+                   <int*>(out[2]), (<int32_t*>(data[2]))[0], begin, end)
+
+cdef void lapack_sgetrf_small(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_sgetrf_small_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>n * n * n))
+
+register_cpu_custom_call_target(b"lapack_sgetrf_small",
+                                <void*>(lapack_sgetrf_small))
+
+cdef void lapack_dgetrf_small_range(void* out_tuple, void** data, int begin,
+                                    int end, int slot) noexcept nogil:
+  cdef void** out = <void**>(out_tuple)
+  small_getrf_impl(<double*>(out[0]), <double*>(data[3]), <int*>(out[1]),
+                   <int*>(out[2]), (<int32_t*>(data[2]))[0], begin, end)
+
+cdef void lapack_dgetrf_small(void* out_tuple, void** data) noexcept nogil:
   cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_dgetrf_small_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>n * n * n))
+
+register_cpu_custom_call_target(b"lapack_dgetrf_small",
+                                <void*>(lapack_dgetrf_small))
+
+
+# ?getrf: LU decomposition
+
+cdef void lapack_sgetrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int m = (<int32_t*>(data[1]))[0]
   cdef int n = (<int32_t*>(data[2]))[0]
-  cdef const float* a_in = <float*>(data[3])
+  cdef const float* a_in = <float*>(data[3]) + begin * m * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef float* a_out = <float*>(out[0])
-  cdef int* ipiv = <int*>(out[1])
-  cdef int* info = <int*>(out[2])
+  cdef float* a_out = <float*>(out[0]) + begin * m * n
+  cdef int* ipiv = <int*>(out[1]) + begin * min(m, n)
+  cdef int* info = <int*>(out[2]) + begin
   if a_out != a_in:
-    memcpy(a_out, a_in, b * m * n * sizeof(float))
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(float))
 
-  for i in range(b):
+  for _ in range(begin, end):
     sgetrf(&m, &n, a_out, &m, ipiv, info)
     a_out += m * n
     ipiv += min(m, n)
     info += 1
 
+cdef void lapack_sgetrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int m = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_sgetrf_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>m * n * min(m, n)))
+
 register_cpu_custom_call_target(b"lapack_sgetrf", <void*>(lapack_sgetrf))
 
 
-cdef void lapack_dgetrf(void* out_tuple, void** data) nogil:
-  cdef int b = (<int32_t*>(data[0]))[0]
+cdef void lapack_dgetrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int m = (<int32_t*>(data[1]))[0]
   cdef int n = (<int32_t*>(data[2]))[0]
-  cdef const double* a_in = <double*>(data[3])
+  cdef const double* a_in = <double*>(data[3]) + begin * m * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef double* a_out = <double*>(out[0])
-  cdef int* ipiv = <int*>(out[1])
-  cdef int* info = <int*>(out[2])
+  cdef double* a_out = <double*>(out[0]) + begin * m * n
+  cdef int* ipiv = <int*>(out[1]) + begin * min(m, n)
+  cdef int* info = <int*>(out[2]) + begin
   if a_out != a_in:
-    memcpy(a_out, a_in, b * m * n * sizeof(double))
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(double))
 
-  for i in range(b):
+  for _ in range(begin, end):
     dgetrf(&m, &n, a_out, &m, ipiv, info)
     a_out += m * n
     ipiv += min(m, n)
     info += 1
 
+cdef void lapack_dgetrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int m = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_dgetrf_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>m * n * min(m, n)))
+
 register_cpu_custom_call_target(b"lapack_dgetrf", <void*>(lapack_dgetrf))
 
 
-cdef void lapack_cgetrf(void* out_tuple, void** data) nogil:
-  cdef int b = (<int32_t*>(data[0]))[0]
+cdef void lapack_cgetrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int m = (<int32_t*>(data[1]))[0]
   cdef int n = (<int32_t*>(data[2]))[0]
-  cdef const float complex* a_in = <float complex*>(data[3])
+  cdef const float complex* a_in = <float complex*>(data[3]) + begin * m * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef float complex* a_out = <float complex*>(out[0])
-  cdef int* ipiv = <int*>(out[1])
-  cdef int* info = <int*>(out[2])
+  cdef float complex* a_out = <float complex*>(out[0]) + begin * m * n
+  cdef int* ipiv = <int*>(out[1]) + begin * min(m, n)
+  cdef int* info = <int*>(out[2]) + begin
   if a_out != a_in:
-    memcpy(a_out, a_in, b * m * n * sizeof(float complex))
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(float complex))
 
-  for i in range(b):
+  for _ in range(begin, end):
     cgetrf(&m, &n, a_out, &m, ipiv, info)
     a_out += m * n
     ipiv += min(m, n)
     info += 1
 
+cdef void lapack_cgetrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int m = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_cgetrf_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>m * n * min(m, n)))
+
 register_cpu_custom_call_target(b"lapack_cgetrf", <void*>(lapack_cgetrf))
 
 
-cdef void lapack_zgetrf(void* out_tuple, void** data) nogil:
-  cdef int b = (<int32_t*>(data[0]))[0]
+cdef void lapack_zgetrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int m = (<int32_t*>(data[1]))[0]
   cdef int n = (<int32_t*>(data[2]))[0]
-  cdef const double complex* a_in = <double complex*>(data[3])
+  cdef const double complex* a_in = <double complex*>(data[3]) + begin * m * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef double complex* a_out = <double complex*>(out[0])
-  cdef int* ipiv = <int*>(out[1])
-  cdef int* info = <int*>(out[2])
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * m * n
+  cdef int* ipiv = <int*>(out[1]) + begin * min(m, n)
+  cdef int* info = <int*>(out[2]) + begin
   if a_out != a_in:
-    memcpy(a_out, a_in, b * m * n * sizeof(double complex))
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(double complex))
 
-  for i in range(b):
+  for _ in range(begin, end):
     zgetrf(&m, &n, a_out, &m, ipiv, info)
     a_out += m * n
     ipiv += min(m, n)
     info += 1
 
+cdef void lapack_zgetrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int m = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_zgetrf_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>m * n * min(m, n)))
+
 register_cpu_custom_call_target(b"lapack_zgetrf", <void*>(lapack_zgetrf))
 
 def getrf(c, a):
@@ -319,10 +1180,11 @@ def getrf(c, a):
   for d in batch_dims:
     b *= d
 
+  small = m == n and n <= SMALL_MATRIX_MAX_DIM
   if dtype == np.float32:
-    fn = b"lapack_sgetrf"
+    fn = b"lapack_sgetrf_small" if small else b"lapack_sgetrf"
   elif dtype == np.float64:
-    fn = b"lapack_dgetrf"
+    fn = b"lapack_dgetrf_small" if small else b"lapack_dgetrf"
   elif dtype == np.complex64:
     fn = b"lapack_cgetrf"
   elif dtype == np.complex128:
@@ -330,8 +1192,10 @@ def getrf(c, a):
   else:
     raise NotImplementedError("Unsupported dtype {}".format(dtype))
 
-  out = c.CustomCall(
-      fn,
+  # Row pivoting of A^T would be column pivoting of A, so unlike the Cholesky
+  # and triangular solve builders this one must stay column-major.
+  out = _custom_call(
+      c, fn,
       operands=(
         c.ConstantS32Scalar(b),
         c.ConstantS32Scalar(m),
@@ -341,7 +1205,7 @@ def getrf(c, a):
           Shape.array_shape(
             dtype,
             batch_dims + (m, n),
-            (num_bd, num_bd + 1) + tuple(range(num_bd - 1, -1, -1))),
+            _column_major_layout(num_bd)),
           Shape.array_shape(
             np.dtype(np.int32),
             batch_dims + (min(m, n),),
@@ -356,147 +1220,2578 @@ def getrf(c, a):
           Shape.array_shape(
             dtype,
             batch_dims + (m, n),
-            (num_bd, num_bd + 1) + tuple(range(num_bd - 1, -1, -1))),
+            _column_major_layout(num_bd)),
       ))
   return tuple(c.GetTupleElement(out, i) for i in range(3))
 
 def jax_getrf(c, a):
   return c.Tuple(*getrf(c, a))
 
-# ?potrf: Cholesky decomposition
+# ?getrs: Solves a system of linear equations with an LU-factored matrix
 
-cdef void lapack_spotrf(void* out_tuple, void** data) nogil:
-  cdef int32_t lower = (<int32_t*>(data[0]))[0]
-  cdef int n = (<int32_t*>(data[1]))[0]
-  cdef const float* a_in = <float*>(data[2])
-  cdef char uplo = 'L' if lower else 'U'
+# Flop counts used by the thread pool's cost model.
+cdef double getrs_flops(int n, int nrhs) noexcept nogil:
+  return 2. * n * n * nrhs
 
-  cdef void** out = <void**>(out_tuple)
-  cdef float* a_out = <float*>(out[0])
-  cdef int* info = <int*>(out[1])
-  if a_out != a_in:
-    memcpy(a_out, a_in, n * n * sizeof(float))
+cdef double gesv_flops(int n, int nrhs) noexcept nogil:
+  return 2. * n * n * n / 3 + 2. * n * n * nrhs
 
-  spotrf(&uplo, &n, a_out, &n, info)
+cdef void lapack_sgetrs_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t trans = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef float* a = <float*>(data[4]) + begin * n * n
+  cdef int* ipiv = <int*>(data[5]) + begin * n
+  cdef const float* b_in = <float*>(data[6]) + begin * n * nrhs
+  cdef char trans_c = 'C' if trans == 2 else ('T' if trans == 1 else 'N')
 
-register_cpu_custom_call_target(b"lapack_spotrf", <void*>(lapack_spotrf))
+  cdef void** out = <void**>(out_tuple)
+  cdef float* b_out = <float*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(float))
+
+  for _ in range(begin, end):
+    sgetrs(&trans_c, &n, &nrhs, a, &n, ipiv, b_out, &n, info)
+    a += n * n
+    ipiv += n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_sgetrs(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_sgetrs_range, out_tuple, data, b,
+                 batch_parallelism(b, getrs_flops(n, nrhs)))
 
+register_cpu_custom_call_target(b"lapack_sgetrs", <void*>(lapack_sgetrs))
 
-cdef void lapack_dpotrf(void* out_tuple, void** data) nogil:
-  cdef int32_t lower = (<int32_t*>(data[0]))[0]
-  cdef int n = (<int32_t*>(data[1]))[0]
-  cdef const double* a_in = <double*>(data[2])
-  cdef char uplo = 'L' if lower else 'U'
+cdef void lapack_dgetrs_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t trans = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef double* a = <double*>(data[4]) + begin * n * n
+  cdef int* ipiv = <int*>(data[5]) + begin * n
+  cdef const double* b_in = <double*>(data[6]) + begin * n * nrhs
+  cdef char trans_c = 'C' if trans == 2 else ('T' if trans == 1 else 'N')
 
   cdef void** out = <void**>(out_tuple)
-  cdef double* a_out = <double*>(out[0])
-  cdef int* info = <int*>(out[1])
-  if a_out != a_in:
-    memcpy(a_out, a_in, n * n * sizeof(double))
-
-  dpotrf(&uplo, &n, a_out, &n, info)
+  cdef double* b_out = <double*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(double))
+
+  for _ in range(begin, end):
+    dgetrs(&trans_c, &n, &nrhs, a, &n, ipiv, b_out, &n, info)
+    a += n * n
+    ipiv += n
+    b_out += n * nrhs
+    info += 1
 
-register_cpu_custom_call_target(b"lapack_dpotrf", <void*>(lapack_dpotrf))
+cdef void lapack_dgetrs(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_dgetrs_range, out_tuple, data, b,
+                 batch_parallelism(b, getrs_flops(n, nrhs)))
 
+register_cpu_custom_call_target(b"lapack_dgetrs", <void*>(lapack_dgetrs))
 
-cdef void lapack_cpotrf(void* out_tuple, void** data) nogil:
-  cdef int32_t lower = (<int32_t*>(data[0]))[0]
-  cdef int n = (<int32_t*>(data[1]))[0]
-  cdef const float complex* a_in = <float complex*>(data[2])
-  cdef char uplo = 'L' if lower else 'U'
+cdef void lapack_cgetrs_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t trans = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef float complex* a = <float complex*>(data[4]) + begin * n * n
+  cdef int* ipiv = <int*>(data[5]) + begin * n
+  cdef const float complex* b_in = <float complex*>(data[6]) + begin * n * nrhs
+  cdef char trans_c = 'C' if trans == 2 else ('T' if trans == 1 else 'N')
 
   cdef void** out = <void**>(out_tuple)
-  cdef float complex* a_out = <float complex*>(out[0])
-  cdef int* info = <int*>(out[1])
-  if a_out != a_in:
-    memcpy(a_out, a_in, n * n * sizeof(float complex))
+  cdef float complex* b_out = <float complex*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(float complex))
+
+  for _ in range(begin, end):
+    cgetrs(&trans_c, &n, &nrhs, a, &n, ipiv, b_out, &n, info)
+    a += n * n
+    ipiv += n
+    b_out += n * nrhs
+    info += 1
 
-  cpotrf(&uplo, &n, a_out, &n, info)
+cdef void lapack_cgetrs(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_cgetrs_range, out_tuple, data, b,
+                 batch_parallelism(b, getrs_flops(n, nrhs)))
 
-register_cpu_custom_call_target(b"lapack_cpotrf", <void*>(lapack_cpotrf))
+register_cpu_custom_call_target(b"lapack_cgetrs", <void*>(lapack_cgetrs))
 
-cdef void lapack_zpotrf(void* out_tuple, void** data) nogil:
-  cdef int32_t lower = (<int32_t*>(data[0]))[0]
-  cdef int n = (<int32_t*>(data[1]))[0]
-  cdef const double complex* a_in = <double complex*>(data[2])
-  cdef char uplo = 'L' if lower else 'U'
+cdef void lapack_zgetrs_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t trans = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef double complex* a = <double complex*>(data[4]) + begin * n * n
+  cdef int* ipiv = <int*>(data[5]) + begin * n
+  cdef const double complex* b_in = <double complex*>(data[6]) + begin * n * nrhs
+  cdef char trans_c = 'C' if trans == 2 else ('T' if trans == 1 else 'N')
 
   cdef void** out = <void**>(out_tuple)
-  cdef double complex* a_out = <double complex*>(out[0])
-  cdef int* info = <int*>(out[1])
-  if a_out != a_in:
-    memcpy(a_out, a_in, n * n * sizeof(double complex))
+  cdef double complex* b_out = <double complex*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(double complex))
+
+  for _ in range(begin, end):
+    zgetrs(&trans_c, &n, &nrhs, a, &n, ipiv, b_out, &n, info)
+    a += n * n
+    ipiv += n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_zgetrs(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_zgetrs_range, out_tuple, data, b,
+                 batch_parallelism(b, getrs_flops(n, nrhs)))
 
-  zpotrf(&uplo, &n, a_out, &n, info)
+register_cpu_custom_call_target(b"lapack_zgetrs", <void*>(lapack_zgetrs))
 
-register_cpu_custom_call_target(b"lapack_zpotrf", <void*>(lapack_zpotrf))
+def getrs(c, a, ipiv, b, trans=0):
+  """Solves op(a) @ x = b given the LU factors and pivots returned by `getrf`.
 
-def potrf(c, a, lower=False):
+  `a` has shape batch + (n, n), `ipiv` holds LAPACK's 1-based pivots with
+  shape batch + (n,), and `b` has shape batch + (n, nrhs). `trans` is 0, 1 or
+  2 for op(a) = a, a^T or a^H. Returns x and info.
+  """
   assert sizeof(int32_t) == sizeof(int)
 
   a_shape = c.GetShape(a)
   dtype = a_shape.element_type()
-  m, n = a_shape.dimensions()
+  dims = a_shape.dimensions()
+  m, n = dims[-2:]
   if m != n:
-    raise ValueError("potrf expects a square matrix, got {}".format(a_shape))
+    raise ValueError("getrs expects a square matrix, got {}".format(a_shape))
+  b_shape = c.GetShape(b)
+  b_dims = b_shape.dimensions()
+  batch_dims = tuple(dims[:-2])
+  if len(b_dims) != len(dims) or b_dims[:-2] != batch_dims or b_dims[-2] != n:
+    raise ValueError("Argument mismatch for getrs, got {} and {}".format(
+      a_shape, b_shape))
+  nrhs = b_dims[-1]
+  num_bd = len(batch_dims)
+  batch = 1
+  for d in batch_dims:
+    batch *= d
+
   if dtype == np.float32:
-    fn = b"lapack_spotrf"
+    fn = b"lapack_sgetrs"
   elif dtype == np.float64:
-    fn = b"lapack_dpotrf"
+    fn = b"lapack_dgetrs"
   elif dtype == np.complex64:
-    fn = b"lapack_cpotrf"
+    fn = b"lapack_cgetrs"
   elif dtype == np.complex128:
-    fn = b"lapack_zpotrf"
+    fn = b"lapack_zgetrs"
   else:
     raise NotImplementedError("Unsupported dtype {}".format(dtype))
 
-  out = c.CustomCall(
-      fn,
-      operands=(c.ConstantS32Scalar(int(lower)), c.ConstantS32Scalar(n), a),
+  layout = _column_major_layout(num_bd)
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(int(trans)), c.ConstantS32Scalar(batch),
+                c.ConstantS32Scalar(n), c.ConstantS32Scalar(nrhs), a, ipiv, b),
       shape_with_layout=Shape.tuple_shape((
-          Shape.array_shape(dtype, (n, n), (0, 1)),
-          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, b_dims, layout),
+          Shape.array_shape(
+            np.dtype(np.int32), batch_dims, tuple(range(num_bd - 1, -1, -1))),
       )),
       operand_shapes_with_layout=(
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
-          Shape.array_shape(dtype, (n, n), (0, 1)),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(np.dtype(np.int32), batch_dims + (n,),
+                            tuple(range(num_bd, -1, -1))),
+          Shape.array_shape(dtype, b_dims, layout),
       ))
-  return tuple(c.GetTupleElement(out, i) for i in range(2))
+  return c.GetTupleElement(out, 0), c.GetTupleElement(out, 1)
 
-def jax_potrf(c, a, lower=False):
-  return c.Tuple(*potrf(c, a, lower))
 
+# ?gesv: LU factorization and solve of a general system
 
-# ?gesdd: Singular value decomposition
+cdef void lapack_sgesv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[1]))[0]
+  cdef int nrhs = (<int32_t*>(data[2]))[0]
+  cdef const float* a_in = <float*>(data[3]) + begin * n * n
+  cdef const float* b_in = <float*>(data[4]) + begin * n * nrhs
 
-cdef int gesdd_iwork_size(int m, int n) nogil:
-  return 8 * min(m, n)
+  cdef void** out = <void**>(out_tuple)
+  cdef float* a_out = <float*>(out[0]) + begin * n * n
+  cdef int* ipiv = <int*>(out[1]) + begin * n
+  cdef float* b_out = <float*>(out[2]) + begin * n * nrhs
+  cdef int* info = <int*>(out[3]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(float))
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(float))
 
-cdef int cgesdd_rwork_size(int m, int n, int compute_uv) nogil:
-  cdef int mn = min(m, n)
-  if compute_uv == 0:
-    return 7 * mn
-  cdef int mx = max(m, n)
-  return max(5 * mn * mn + 5 * mn, 2 * mx * mn + 2 * mn * mn + mn)
+  for _ in range(begin, end):
+    sgesv(&n, &nrhs, a_out, &n, ipiv, b_out, &n, info)
+    a_out += n * n
+    ipiv += n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_sgesv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[1]))[0]
+  cdef int nrhs = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_sgesv_range, out_tuple, data, b,
+                 batch_parallelism(b, gesv_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_sgesv", <void*>(lapack_sgesv))
+
+cdef void lapack_dgesv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[1]))[0]
+  cdef int nrhs = (<int32_t*>(data[2]))[0]
+  cdef const double* a_in = <double*>(data[3]) + begin * n * n
+  cdef const double* b_in = <double*>(data[4]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* a_out = <double*>(out[0]) + begin * n * n
+  cdef int* ipiv = <int*>(out[1]) + begin * n
+  cdef double* b_out = <double*>(out[2]) + begin * n * nrhs
+  cdef int* info = <int*>(out[3]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double))
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(double))
+
+  for _ in range(begin, end):
+    dgesv(&n, &nrhs, a_out, &n, ipiv, b_out, &n, info)
+    a_out += n * n
+    ipiv += n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_dgesv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[1]))[0]
+  cdef int nrhs = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_dgesv_range, out_tuple, data, b,
+                 batch_parallelism(b, gesv_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_dgesv", <void*>(lapack_dgesv))
+
+cdef void lapack_cgesv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[1]))[0]
+  cdef int nrhs = (<int32_t*>(data[2]))[0]
+  cdef const float complex* a_in = <float complex*>(data[3]) + begin * n * n
+  cdef const float complex* b_in = <float complex*>(data[4]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float complex* a_out = <float complex*>(out[0]) + begin * n * n
+  cdef int* ipiv = <int*>(out[1]) + begin * n
+  cdef float complex* b_out = <float complex*>(out[2]) + begin * n * nrhs
+  cdef int* info = <int*>(out[3]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(float complex))
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(float complex))
+
+  for _ in range(begin, end):
+    cgesv(&n, &nrhs, a_out, &n, ipiv, b_out, &n, info)
+    a_out += n * n
+    ipiv += n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_cgesv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[1]))[0]
+  cdef int nrhs = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_cgesv_range, out_tuple, data, b,
+                 batch_parallelism(b, gesv_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_cgesv", <void*>(lapack_cgesv))
+
+cdef void lapack_zgesv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[1]))[0]
+  cdef int nrhs = (<int32_t*>(data[2]))[0]
+  cdef const double complex* a_in = <double complex*>(data[3]) + begin * n * n
+  cdef const double complex* b_in = <double complex*>(data[4]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * n * n
+  cdef int* ipiv = <int*>(out[1]) + begin * n
+  cdef double complex* b_out = <double complex*>(out[2]) + begin * n * nrhs
+  cdef int* info = <int*>(out[3]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double complex))
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(double complex))
+
+  for _ in range(begin, end):
+    zgesv(&n, &nrhs, a_out, &n, ipiv, b_out, &n, info)
+    a_out += n * n
+    ipiv += n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_zgesv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[1]))[0]
+  cdef int nrhs = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_zgesv_range, out_tuple, data, b,
+                 batch_parallelism(b, gesv_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_zgesv", <void*>(lapack_zgesv))
+
+def gesv(c, a, b):
+  """Factors `a` and solves a @ x = b in one call.
+
+  Returns the LU factors, the 1-based pivots, x and info; info > 0 means `a`
+  is singular.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  a_shape = c.GetShape(a)
+  dtype = a_shape.element_type()
+  dims = a_shape.dimensions()
+  m, n = dims[-2:]
+  if m != n:
+    raise ValueError("gesv expects a square matrix, got {}".format(a_shape))
+  b_shape = c.GetShape(b)
+  b_dims = b_shape.dimensions()
+  batch_dims = tuple(dims[:-2])
+  if len(b_dims) != len(dims) or b_dims[:-2] != batch_dims or b_dims[-2] != n:
+    raise ValueError("Argument mismatch for gesv, got {} and {}".format(
+      a_shape, b_shape))
+  nrhs = b_dims[-1]
+  num_bd = len(batch_dims)
+  batch = 1
+  for d in batch_dims:
+    batch *= d
+
+  if dtype == np.float32:
+    fn = b"lapack_sgesv"
+  elif dtype == np.float64:
+    fn = b"lapack_dgesv"
+  elif dtype == np.complex64:
+    fn = b"lapack_cgesv"
+  elif dtype == np.complex128:
+    fn = b"lapack_zgesv"
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  layout = _column_major_layout(num_bd)
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(batch), c.ConstantS32Scalar(n),
+                c.ConstantS32Scalar(nrhs), a, b),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(np.dtype(np.int32), batch_dims + (n,),
+                            tuple(range(num_bd, -1, -1))),
+          Shape.array_shape(dtype, b_dims, layout),
+          Shape.array_shape(
+            np.dtype(np.int32), batch_dims, tuple(range(num_bd - 1, -1, -1))),
+      )),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, b_dims, layout),
+      ))
+  return tuple(c.GetTupleElement(out, i) for i in range(4))
+
+# Converts the row swaps returned by ?getrf to a permutation.
+
+cdef void lapack_lu_pivots_to_permutation_range(
+    void* out_tuple, void** data, int begin, int end, int slot) noexcept nogil:
+  cdef int32_t inverse = (<int32_t*>(data[0]))[0]
+  cdef int k = (<int32_t*>(data[2]))[0]
+  cdef int m = (<int32_t*>(data[3]))[0]
+  cdef const int32_t* pivots = <int32_t*>(data[4]) + begin * k
+
+  cdef void** out = <void**>(out_tuple)
+  cdef int32_t* perm = <int32_t*>(out[0]) + begin * m
+  cdef int32_t* inv = <int32_t*>(out[1]) + begin * m if inverse else NULL
+  cdef int j, p
+  cdef int32_t tmp
+
+  for _ in range(begin, end):
+    for p in range(m):
+      perm[p] = p
+    for p in range(k):
+      j = pivots[p]
+      # Out-of-range swaps only come from malformed input; ignore them rather
+      # than write outside the permutation.
+      if j >= 0 and j < m:
+        tmp = perm[p]
+        perm[p] = perm[j]
+        perm[j] = tmp
+    if inverse:
+      for p in range(m):
+        inv[perm[p]] = p
+      inv += m
+    pivots += k
+    perm += m
+
+cdef void lapack_lu_pivots_to_permutation(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int m = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_lu_pivots_to_permutation_range, out_tuple, data, b,
+                 batch_parallelism(b, 2. * m))
+
+register_cpu_custom_call_target(
+  b"lapack_lu_pivots_to_permutation",
+  <void*>(lapack_lu_pivots_to_permutation))
+
+def lu_pivots_to_permutation(c, pivots, permutation_size, inverse=False):
+  """Applies the 0-based row swaps `pivots`, of shape batch_dims + (k,), to
+  the identity permutation of size `permutation_size`.
+
+  Returns the permutation, and also its inverse if `inverse` is true.
+  """
+  pivots_shape = c.GetShape(pivots)
+  dims = pivots_shape.dimensions()
+  assert len(dims) >= 1
+  if pivots_shape.element_type() != np.int32:
+    raise ValueError("Pivots must be int32, got {}".format(pivots_shape))
+  batch_dims = tuple(dims[:-1])
+  k = dims[-1]
+  m = permutation_size
+  if m < k:
+    raise ValueError("Permutation size {} is smaller than the number of "
+                     "pivots {}".format(m, k))
+  num_bd = len(batch_dims)
+  b = 1
+  for d in batch_dims:
+    b *= d
+
+  layout = tuple(range(num_bd, -1, -1))
+  perm_shape = Shape.array_shape(np.dtype(np.int32), batch_dims + (m,), layout)
+  out = _custom_call(
+      c, b"lapack_lu_pivots_to_permutation",
+      operands=(c.ConstantS32Scalar(int(inverse)), c.ConstantS32Scalar(b),
+                c.ConstantS32Scalar(k), c.ConstantS32Scalar(m), pivots),
+      shape_with_layout=Shape.tuple_shape(
+          (perm_shape, perm_shape) if inverse else (perm_shape,)),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), dims, layout),
+      ))
+  if inverse:
+    return c.GetTupleElement(out, 0), c.GetTupleElement(out, 1)
+  return c.GetTupleElement(out, 0)
+
+
+# ?potrf: Cholesky decomposition
+
+cdef void lapack_spotrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef const float* a_in = <float*>(data[3]) + begin * n * n
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float* a_out = <float*>(out[0]) + begin * n * n
+  cdef int* info = <int*>(out[1]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(float))
+
+  for _ in range(begin, end):
+    spotrf(&uplo, &n, a_out, &n, info)
+    a_out += n * n
+    info += 1
+
+cdef void lapack_spotrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_spotrf_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>n * n * n / 3))
+
+register_cpu_custom_call_target(b"lapack_spotrf", <void*>(lapack_spotrf))
+
+
+cdef void lapack_dpotrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef const double* a_in = <double*>(data[3]) + begin * n * n
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* a_out = <double*>(out[0]) + begin * n * n
+  cdef int* info = <int*>(out[1]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double))
+
+  for _ in range(begin, end):
+    dpotrf(&uplo, &n, a_out, &n, info)
+    a_out += n * n
+    info += 1
+
+cdef void lapack_dpotrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_dpotrf_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>n * n * n / 3))
+
+register_cpu_custom_call_target(b"lapack_dpotrf", <void*>(lapack_dpotrf))
+
+
+cdef void lapack_cpotrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef const float complex* a_in = <float complex*>(data[3]) + begin * n * n
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float complex* a_out = <float complex*>(out[0]) + begin * n * n
+  cdef int* info = <int*>(out[1]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(float complex))
+
+  for _ in range(begin, end):
+    cpotrf(&uplo, &n, a_out, &n, info)
+    a_out += n * n
+    info += 1
+
+cdef void lapack_cpotrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_cpotrf_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>n * n * n / 3))
+
+register_cpu_custom_call_target(b"lapack_cpotrf", <void*>(lapack_cpotrf))
+
+cdef void lapack_zpotrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef const double complex* a_in = <double complex*>(data[3]) + begin * n * n
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * n * n
+  cdef int* info = <int*>(out[1]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double complex))
+
+  for _ in range(begin, end):
+    zpotrf(&uplo, &n, a_out, &n, info)
+    a_out += n * n
+    info += 1
+
+cdef void lapack_zpotrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  parallel_batch(lapack_zpotrf_range, out_tuple, data, b,
+                 batch_parallelism(b, <double>n * n * n / 3))
+
+register_cpu_custom_call_target(b"lapack_zpotrf", <void*>(lapack_zpotrf))
+
+def potrf(c, a, lower=False):
+  assert sizeof(int32_t) == sizeof(int)
+
+  a_shape = c.GetShape(a)
+  dtype = a_shape.element_type()
+  dims = a_shape.dimensions()
+  m, n = dims[-2:]
+  if m != n:
+    raise ValueError("potrf expects a square matrix, got {}".format(a_shape))
+  batch_dims = tuple(dims[:-2])
+  num_bd = len(batch_dims)
+  b = 1
+  for d in batch_dims:
+    b *= d
+
+  small = n <= SMALL_MATRIX_MAX_DIM
+  if dtype == np.float32:
+    fn = b"lapack_spotrf_small" if small else b"lapack_spotrf"
+  elif dtype == np.float64:
+    fn = b"lapack_dpotrf_small" if small else b"lapack_dpotrf"
+  elif dtype == np.complex64:
+    fn = b"lapack_cpotrf"
+  elif dtype == np.complex128:
+    fn = b"lapack_zpotrf"
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  # `a` is row-major, so the kernel sees A^T = conj(A). Factoring its
+  # opposite triangle gives conj(A) = U^H U, i.e. A = U^T (U^T)^H, and U^T is
+  # the factor we want, already in row-major order.
+  layout = _row_major_layout(num_bd)
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(int(not lower)),
+                c.ConstantS32Scalar(b), c.ConstantS32Scalar(n), a),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(
+            np.dtype(np.int32), batch_dims, tuple(range(num_bd - 1, -1, -1))),
+      )),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+      ))
+  return tuple(c.GetTupleElement(out, i) for i in range(2))
+
+def jax_potrf(c, a, lower=False):
+  return c.Tuple(*potrf(c, a, lower))
+
+
+# ?potrs: Solves a system of linear equations with a Cholesky-factored matrix
+
+# Flop counts used by the thread pool's cost model.
+cdef double potrs_flops(int n, int nrhs) noexcept nogil:
+  return 2. * n * n * nrhs
+
+cdef double posv_flops(int n, int nrhs) noexcept nogil:
+  return <double>n * n * n / 3 + 2. * n * n * nrhs
+
+cdef void lapack_spotrs_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef float* a = <float*>(data[4]) + begin * n * n
+  cdef const float* b_in = <float*>(data[5]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float* b_out = <float*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(float))
+
+  for _ in range(begin, end):
+    spotrs(&uplo, &n, &nrhs, a, &n, b_out, &n, info)
+    a += n * n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_spotrs(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_spotrs_range, out_tuple, data, b,
+                 batch_parallelism(b, potrs_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_spotrs", <void*>(lapack_spotrs))
+
+cdef void lapack_dpotrs_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef double* a = <double*>(data[4]) + begin * n * n
+  cdef const double* b_in = <double*>(data[5]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* b_out = <double*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(double))
+
+  for _ in range(begin, end):
+    dpotrs(&uplo, &n, &nrhs, a, &n, b_out, &n, info)
+    a += n * n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_dpotrs(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_dpotrs_range, out_tuple, data, b,
+                 batch_parallelism(b, potrs_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_dpotrs", <void*>(lapack_dpotrs))
+
+cdef void lapack_cpotrs_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef float complex* a = <float complex*>(data[4]) + begin * n * n
+  cdef const float complex* b_in = <float complex*>(data[5]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float complex* b_out = <float complex*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(float complex))
+
+  for _ in range(begin, end):
+    cpotrs(&uplo, &n, &nrhs, a, &n, b_out, &n, info)
+    a += n * n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_cpotrs(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_cpotrs_range, out_tuple, data, b,
+                 batch_parallelism(b, potrs_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_cpotrs", <void*>(lapack_cpotrs))
+
+cdef void lapack_zpotrs_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef double complex* a = <double complex*>(data[4]) + begin * n * n
+  cdef const double complex* b_in = <double complex*>(data[5]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* b_out = <double complex*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(double complex))
+
+  for _ in range(begin, end):
+    zpotrs(&uplo, &n, &nrhs, a, &n, b_out, &n, info)
+    a += n * n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_zpotrs(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_zpotrs_range, out_tuple, data, b,
+                 batch_parallelism(b, potrs_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_zpotrs", <void*>(lapack_zpotrs))
+
+def potrs(c, a, b, lower=False):
+  """Solves a @ x = b given the Cholesky factor `a` of shape batch + (n, n).
+
+  `b` has shape batch + (n, nrhs). Only the `lower` or upper triangle of `a`
+  is read. Returns x and info.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  a_shape = c.GetShape(a)
+  dtype = a_shape.element_type()
+  dims = a_shape.dimensions()
+  m, n = dims[-2:]
+  if m != n:
+    raise ValueError("potrs expects a square matrix, got {}".format(a_shape))
+  b_shape = c.GetShape(b)
+  b_dims = b_shape.dimensions()
+  batch_dims = tuple(dims[:-2])
+  if len(b_dims) != len(dims) or b_dims[:-2] != batch_dims or b_dims[-2] != n:
+    raise ValueError("Argument mismatch for potrs, got {} and {}".format(
+      a_shape, b_shape))
+  nrhs = b_dims[-1]
+  num_bd = len(batch_dims)
+  batch = 1
+  for d in batch_dims:
+    batch *= d
+
+  if dtype == np.float32:
+    fn = b"lapack_spotrs"
+  elif dtype == np.float64:
+    fn = b"lapack_dpotrs"
+  elif dtype == np.complex64:
+    fn = b"lapack_cpotrs"
+  elif dtype == np.complex128:
+    fn = b"lapack_zpotrs"
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  layout = _column_major_layout(num_bd)
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(int(lower)), c.ConstantS32Scalar(batch),
+                c.ConstantS32Scalar(n), c.ConstantS32Scalar(nrhs), a, b),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, b_dims, layout),
+          Shape.array_shape(
+            np.dtype(np.int32), batch_dims, tuple(range(num_bd - 1, -1, -1))),
+      )),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, b_dims, layout),
+      ))
+  return c.GetTupleElement(out, 0), c.GetTupleElement(out, 1)
+
+
+# ?posv: Cholesky factorization and solve of a positive definite system
+
+cdef void lapack_sposv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef const float* a_in = <float*>(data[4]) + begin * n * n
+  cdef const float* b_in = <float*>(data[5]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float* a_out = <float*>(out[0]) + begin * n * n
+  cdef float* b_out = <float*>(out[1]) + begin * n * nrhs
+  cdef int* info = <int*>(out[2]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(float))
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(float))
+
+  for _ in range(begin, end):
+    sposv(&uplo, &n, &nrhs, a_out, &n, b_out, &n, info)
+    a_out += n * n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_sposv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_sposv_range, out_tuple, data, b,
+                 batch_parallelism(b, posv_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_sposv", <void*>(lapack_sposv))
+
+cdef void lapack_dposv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef const double* a_in = <double*>(data[4]) + begin * n * n
+  cdef const double* b_in = <double*>(data[5]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* a_out = <double*>(out[0]) + begin * n * n
+  cdef double* b_out = <double*>(out[1]) + begin * n * nrhs
+  cdef int* info = <int*>(out[2]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double))
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(double))
+
+  for _ in range(begin, end):
+    dposv(&uplo, &n, &nrhs, a_out, &n, b_out, &n, info)
+    a_out += n * n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_dposv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_dposv_range, out_tuple, data, b,
+                 batch_parallelism(b, posv_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_dposv", <void*>(lapack_dposv))
+
+cdef void lapack_cposv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef const float complex* a_in = <float complex*>(data[4]) + begin * n * n
+  cdef const float complex* b_in = <float complex*>(data[5]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float complex* a_out = <float complex*>(out[0]) + begin * n * n
+  cdef float complex* b_out = <float complex*>(out[1]) + begin * n * nrhs
+  cdef int* info = <int*>(out[2]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(float complex))
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(float complex))
+
+  for _ in range(begin, end):
+    cposv(&uplo, &n, &nrhs, a_out, &n, b_out, &n, info)
+    a_out += n * n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_cposv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_cposv_range, out_tuple, data, b,
+                 batch_parallelism(b, posv_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_cposv", <void*>(lapack_cposv))
+
+cdef void lapack_zposv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef const double complex* a_in = <double complex*>(data[4]) + begin * n * n
+  cdef const double complex* b_in = <double complex*>(data[5]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * n * n
+  cdef double complex* b_out = <double complex*>(out[1]) + begin * n * nrhs
+  cdef int* info = <int*>(out[2]) + begin
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double complex))
+  if b_out != b_in:
+    memcpy(b_out, b_in, (end - begin) * n * nrhs * sizeof(double complex))
+
+  for _ in range(begin, end):
+    zposv(&uplo, &n, &nrhs, a_out, &n, b_out, &n, info)
+    a_out += n * n
+    b_out += n * nrhs
+    info += 1
+
+cdef void lapack_zposv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_zposv_range, out_tuple, data, b,
+                 batch_parallelism(b, posv_flops(n, nrhs)))
+
+register_cpu_custom_call_target(b"lapack_zposv", <void*>(lapack_zposv))
+
+def posv(c, a, b, lower=False):
+  """Factors the positive definite `a` and solves a @ x = b in one call.
+
+  Only the `lower` or upper triangle of `a` is read. Returns the Cholesky
+  factor, x and info; info > 0 means `a` is not positive definite.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  a_shape = c.GetShape(a)
+  dtype = a_shape.element_type()
+  dims = a_shape.dimensions()
+  m, n = dims[-2:]
+  if m != n:
+    raise ValueError("posv expects a square matrix, got {}".format(a_shape))
+  b_shape = c.GetShape(b)
+  b_dims = b_shape.dimensions()
+  batch_dims = tuple(dims[:-2])
+  if len(b_dims) != len(dims) or b_dims[:-2] != batch_dims or b_dims[-2] != n:
+    raise ValueError("Argument mismatch for posv, got {} and {}".format(
+      a_shape, b_shape))
+  nrhs = b_dims[-1]
+  num_bd = len(batch_dims)
+  batch = 1
+  for d in batch_dims:
+    batch *= d
+
+  if dtype == np.float32:
+    fn = b"lapack_sposv"
+  elif dtype == np.float64:
+    fn = b"lapack_dposv"
+  elif dtype == np.complex64:
+    fn = b"lapack_cposv"
+  elif dtype == np.complex128:
+    fn = b"lapack_zposv"
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  layout = _column_major_layout(num_bd)
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(int(lower)), c.ConstantS32Scalar(batch),
+                c.ConstantS32Scalar(n), c.ConstantS32Scalar(nrhs), a, b),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, b_dims, layout),
+          Shape.array_shape(
+            np.dtype(np.int32), batch_dims, tuple(range(num_bd - 1, -1, -1))),
+      )),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, b_dims, layout),
+      ))
+  return tuple(c.GetTupleElement(out, i) for i in range(3))
+
+
+# dsgesv/dsposv: Mixed-precision solves with iterative refinement
+#
+# These factor the matrix in single precision, which runs at about twice the
+# speed of the double precision factorization, and then refine the solution
+# with double precision residuals until it is accurate to double precision.
+# If refinement does not converge, or `a` is too badly conditioned for a
+# single precision factorization, LAPACK refactors in double precision; the
+# returned iteration count is then negative.
+#
+# Refinement can also report convergence on iterates that have overflowed,
+# since the norms LAPACK compares skip NaNs. In that case `a` is still
+# unchanged, so the kernels redo the solve in double precision and return an
+# iteration count of -1, LAPACK's code for a double precision fallback.
+
+# Whether the `size` doubles at `x` are all finite.
+cdef bint all_finite(const double* x, int size) noexcept nogil:
+  for i in range(size):
+    if not (x[i] - x[i] == 0):
+      return False
+  return True
+
+cdef void lapack_dsgesv_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef const double* a_in = <double*>(data[4]) + begin * n * n
+  cdef double* b_in = <double*>(data[5]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* a_out = <double*>(out[0]) + begin * n * n
+  cdef double* x_out = <double*>(out[1]) + begin * n * nrhs
+  cdef int* iter = <int*>(out[2]) + begin
+  cdef int* info = <int*>(out[3]) + begin
+  cdef int* ipiv = <int*>(out[4]) + slot * n
+  cdef double* work = <double*>(out[5]) + slot * n * nrhs
+  cdef float* swork = <float*>(out[6]) + slot * n * (n + nrhs)
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double))
+
+  cdef int ld = max(n, 1)
+  for _ in range(begin, end):
+    dsgesv(&n, &nrhs, a_out, &ld, ipiv, b_in, &ld, x_out, &ld, work, swork,
+           iter, info)
+    if iter[0] >= 0 and not all_finite(x_out, n * nrhs):
+      memcpy(x_out, b_in, n * nrhs * sizeof(double))
+      dgesv(&n, &nrhs, a_out, &ld, ipiv, x_out, &ld, info)
+      iter[0] = -1
+    a_out += n * n
+    b_in += n * nrhs
+    x_out += n * nrhs
+    iter += 1
+    info += 1
+
+cdef void lapack_dsgesv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_dsgesv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, gesv_flops(n, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_dsgesv", <void*>(lapack_dsgesv))
+
+cdef void lapack_zcgesv_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef const double complex* a_in = <double complex*>(data[4]) + begin * n * n
+  cdef double complex* b_in = <double complex*>(data[5]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * n * n
+  cdef double complex* x_out = <double complex*>(out[1]) + begin * n * nrhs
+  cdef int* iter = <int*>(out[2]) + begin
+  cdef int* info = <int*>(out[3]) + begin
+  cdef int* ipiv = <int*>(out[4]) + slot * n
+  cdef double complex* work = <double complex*>(out[5]) + slot * n * nrhs
+  cdef float complex* swork = <float complex*>(out[6]) + slot * n * (n + nrhs)
+  cdef double* rwork = <double*>(out[7]) + slot * n
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double complex))
+
+  cdef int ld = max(n, 1)
+  for _ in range(begin, end):
+    zcgesv(&n, &nrhs, a_out, &ld, ipiv, b_in, &ld, x_out, &ld, work, swork,
+           rwork, iter, info)
+    if iter[0] >= 0 and not all_finite(<double*>x_out, 2 * n * nrhs):
+      memcpy(x_out, b_in, n * nrhs * sizeof(double complex))
+      zgesv(&n, &nrhs, a_out, &ld, ipiv, x_out, &ld, info)
+      iter[0] = -1
+    a_out += n * n
+    b_in += n * nrhs
+    x_out += n * nrhs
+    iter += 1
+    info += 1
+
+cdef void lapack_zcgesv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_zcgesv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, gesv_flops(n, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_zcgesv", <void*>(lapack_zcgesv))
+
+cdef void lapack_dsposv_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int nrhs = (<int32_t*>(data[4]))[0]
+  cdef const double* a_in = <double*>(data[5]) + begin * n * n
+  cdef double* b_in = <double*>(data[6]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* a_out = <double*>(out[0]) + begin * n * n
+  cdef double* x_out = <double*>(out[1]) + begin * n * nrhs
+  cdef int* iter = <int*>(out[2]) + begin
+  cdef int* info = <int*>(out[3]) + begin
+  cdef double* work = <double*>(out[4]) + slot * n * nrhs
+  cdef float* swork = <float*>(out[5]) + slot * n * (n + nrhs)
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double))
+
+  cdef int ld = max(n, 1)
+  for _ in range(begin, end):
+    dsposv(&uplo, &n, &nrhs, a_out, &ld, b_in, &ld, x_out, &ld, work, swork,
+           iter, info)
+    if iter[0] >= 0 and not all_finite(x_out, n * nrhs):
+      memcpy(x_out, b_in, n * nrhs * sizeof(double))
+      dposv(&uplo, &n, &nrhs, a_out, &ld, x_out, &ld, info)
+      iter[0] = -1
+    a_out += n * n
+    b_in += n * nrhs
+    x_out += n * nrhs
+    iter += 1
+    info += 1
+
+cdef void lapack_dsposv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int nrhs = (<int32_t*>(data[4]))[0]
+  parallel_batch(lapack_dsposv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, posv_flops(n, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_dsposv", <void*>(lapack_dsposv))
+
+cdef void lapack_zcposv_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int nrhs = (<int32_t*>(data[4]))[0]
+  cdef const double complex* a_in = <double complex*>(data[5]) + begin * n * n
+  cdef double complex* b_in = <double complex*>(data[6]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * n * n
+  cdef double complex* x_out = <double complex*>(out[1]) + begin * n * nrhs
+  cdef int* iter = <int*>(out[2]) + begin
+  cdef int* info = <int*>(out[3]) + begin
+  cdef double complex* work = <double complex*>(out[4]) + slot * n * nrhs
+  cdef float complex* swork = <float complex*>(out[5]) + slot * n * (n + nrhs)
+  cdef double* rwork = <double*>(out[6]) + slot * n
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double complex))
+
+  cdef int ld = max(n, 1)
+  for _ in range(begin, end):
+    zcposv(&uplo, &n, &nrhs, a_out, &ld, b_in, &ld, x_out, &ld, work, swork,
+           rwork, iter, info)
+    if iter[0] >= 0 and not all_finite(<double*>x_out, 2 * n * nrhs):
+      memcpy(x_out, b_in, n * nrhs * sizeof(double complex))
+      zposv(&uplo, &n, &nrhs, a_out, &ld, x_out, &ld, info)
+      iter[0] = -1
+    a_out += n * n
+    b_in += n * nrhs
+    x_out += n * nrhs
+    iter += 1
+    info += 1
+
+cdef void lapack_zcposv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int nrhs = (<int32_t*>(data[4]))[0]
+  parallel_batch(lapack_zcposv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, posv_flops(n, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_zcposv", <void*>(lapack_zcposv))
+
+def _mixed_solve_operands(c, name, a, b):
+  a_shape = c.GetShape(a)
+  dtype = a_shape.element_type()
+  dims = a_shape.dimensions()
+  m, n = dims[-2:]
+  if m != n:
+    raise ValueError("{} expects a square matrix, got {}".format(name, a_shape))
+  b_shape = c.GetShape(b)
+  b_dims = b_shape.dimensions()
+  batch_dims = tuple(dims[:-2])
+  if len(b_dims) != len(dims) or b_dims[:-2] != batch_dims or b_dims[-2] != n:
+    raise ValueError("Argument mismatch for {}, got {} and {}".format(
+      name, a_shape, b_shape))
+  if dtype == np.float64:
+    single = np.dtype(np.float32)
+  elif dtype == np.complex128:
+    single = np.dtype(np.complex64)
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+  batch = 1
+  for d in batch_dims:
+    batch *= d
+  return dtype, single, dims, b_dims, batch_dims, batch
+
+def mixed_gesv(c, a, b):
+  """Solves a @ x = b by mixed-precision iterative refinement.
+
+  `a` and `b` must be float64 or complex128; zcgesv is used for the latter.
+  Returns x, the number of refinement iterations and info. A negative
+  iteration count means the solve fell back to a full precision
+  factorization; info > 0 means `a` is singular.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  dtype, single, dims, b_dims, batch_dims, batch = _mixed_solve_operands(
+      c, "mixed_gesv", a, b)
+  n = dims[-1]
+  nrhs = b_dims[-1]
+  num_bd = len(batch_dims)
+  slots = batch_parallelism(batch, gesv_flops(n, nrhs))
+
+  workspaces = (
+      Shape.array_shape(np.dtype(np.int32), (slots * n,), (0,)),
+      Shape.array_shape(dtype, (slots * n * nrhs,), (0,)),
+      Shape.array_shape(single, (slots * n * (n + nrhs),), (0,)),
+  )
+  if dtype == np.float64:
+    fn = b"lapack_dsgesv"
+  else:
+    fn = b"lapack_zcgesv"
+    workspaces += (
+        Shape.array_shape(np.dtype(np.float64), (slots * n,), (0,)),)
+
+  layout = _column_major_layout(num_bd)
+  info_layout = tuple(range(num_bd - 1, -1, -1))
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(batch), c.ConstantS32Scalar(slots),
+                c.ConstantS32Scalar(n), c.ConstantS32Scalar(nrhs), a, b),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, b_dims, layout),
+          Shape.array_shape(np.dtype(np.int32), batch_dims, info_layout),
+          Shape.array_shape(np.dtype(np.int32), batch_dims, info_layout),
+      ) + workspaces),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, b_dims, layout),
+      ))
+  return tuple(c.GetTupleElement(out, i) for i in range(1, 4))
+
+def mixed_posv(c, a, b, lower=False):
+  """Solves a @ x = b for a positive definite `a` by mixed-precision
+  iterative refinement.
+
+  `a` and `b` must be float64 or complex128; zcposv is used for the latter.
+  Only the `lower` or upper triangle of `a` is read. Returns x, the number of
+  refinement iterations and info, as for `mixed_gesv`; info > 0 means `a` is
+  not positive definite.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  dtype, single, dims, b_dims, batch_dims, batch = _mixed_solve_operands(
+      c, "mixed_posv", a, b)
+  n = dims[-1]
+  nrhs = b_dims[-1]
+  num_bd = len(batch_dims)
+  slots = batch_parallelism(batch, posv_flops(n, nrhs))
+
+  workspaces = (
+      Shape.array_shape(dtype, (slots * n * nrhs,), (0,)),
+      Shape.array_shape(single, (slots * n * (n + nrhs),), (0,)),
+  )
+  if dtype == np.float64:
+    fn = b"lapack_dsposv"
+  else:
+    fn = b"lapack_zcposv"
+    workspaces += (
+        Shape.array_shape(np.dtype(np.float64), (slots * n,), (0,)),)
+
+  layout = _column_major_layout(num_bd)
+  info_layout = tuple(range(num_bd - 1, -1, -1))
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(int(lower)), c.ConstantS32Scalar(batch),
+                c.ConstantS32Scalar(slots), c.ConstantS32Scalar(n),
+                c.ConstantS32Scalar(nrhs), a, b),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, b_dims, layout),
+          Shape.array_shape(np.dtype(np.int32), batch_dims, info_layout),
+          Shape.array_shape(np.dtype(np.int32), batch_dims, info_layout),
+      ) + workspaces),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, b_dims, layout),
+      ))
+  return tuple(c.GetTupleElement(out, i) for i in range(1, 4))
+
+
+# ?gtsv: Solves a tridiagonal system of linear equations
+#
+# The banded solvers below take their matrices in compact storage and cost
+# O(n) time and memory per matrix for fixed bandwidth, rather than the O(n^3)
+# time and O(n^2) memory of ?gesv on the dense matrix.
+
+# Flop counts used by the thread pool's cost model.
+cdef double gtsv_flops(int n, int nrhs) noexcept nogil:
+  return 8. * n * (nrhs + 1)
+
+cdef double gbsv_flops(int n, int kl, int ku, int nrhs) noexcept nogil:
+  return 2. * n * (kl + 1) * (kl + ku + 1) + 2. * n * (2 * kl + ku + 1) * nrhs
+
+cdef double pbsv_flops(int n, int kd, int nrhs) noexcept nogil:
+  return <double>n * (kd + 1) * (kd + 1) + 4. * n * (kd + 1) * nrhs
+
+cdef void lapack_sgtsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef const float* dl_in = <float*>(data[4]) + begin * n
+  cdef const float* d_in = <float*>(data[5]) + begin * n
+  cdef const float* du_in = <float*>(data[6]) + begin * n
+  cdef const float* b_in = <float*>(data[7]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float* x_out = <float*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?gtsv overwrites the diagonals, so each thread works on its own copy.
+  cdef float* dl = <float*>(out[2]) + slot * 3 * n
+  cdef float* d = dl + n
+  cdef float* du = d + n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(float))
+
+  cdef int ldb = max(n, 1)
+  for _ in range(begin, end):
+    if n > 0:
+      memcpy(dl, dl_in + 1, (n - 1) * sizeof(float))
+      memcpy(d, d_in, n * sizeof(float))
+      memcpy(du, du_in, (n - 1) * sizeof(float))
+    sgtsv(&n, &nrhs, dl, d, du, x_out, &ldb, info)
+    dl_in += n
+    d_in += n
+    du_in += n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_sgtsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_sgtsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, gtsv_flops(n, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_sgtsv", <void*>(lapack_sgtsv))
+
+cdef void lapack_dgtsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef const double* dl_in = <double*>(data[4]) + begin * n
+  cdef const double* d_in = <double*>(data[5]) + begin * n
+  cdef const double* du_in = <double*>(data[6]) + begin * n
+  cdef const double* b_in = <double*>(data[7]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* x_out = <double*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?gtsv overwrites the diagonals, so each thread works on its own copy.
+  cdef double* dl = <double*>(out[2]) + slot * 3 * n
+  cdef double* d = dl + n
+  cdef double* du = d + n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(double))
+
+  cdef int ldb = max(n, 1)
+  for _ in range(begin, end):
+    if n > 0:
+      memcpy(dl, dl_in + 1, (n - 1) * sizeof(double))
+      memcpy(d, d_in, n * sizeof(double))
+      memcpy(du, du_in, (n - 1) * sizeof(double))
+    dgtsv(&n, &nrhs, dl, d, du, x_out, &ldb, info)
+    dl_in += n
+    d_in += n
+    du_in += n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_dgtsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_dgtsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, gtsv_flops(n, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_dgtsv", <void*>(lapack_dgtsv))
+
+cdef void lapack_cgtsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef const float complex* dl_in = <float complex*>(data[4]) + begin * n
+  cdef const float complex* d_in = <float complex*>(data[5]) + begin * n
+  cdef const float complex* du_in = <float complex*>(data[6]) + begin * n
+  cdef const float complex* b_in = <float complex*>(data[7]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float complex* x_out = <float complex*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?gtsv overwrites the diagonals, so each thread works on its own copy.
+  cdef float complex* dl = <float complex*>(out[2]) + slot * 3 * n
+  cdef float complex* d = dl + n
+  cdef float complex* du = d + n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(float complex))
+
+  cdef int ldb = max(n, 1)
+  for _ in range(begin, end):
+    if n > 0:
+      memcpy(dl, dl_in + 1, (n - 1) * sizeof(float complex))
+      memcpy(d, d_in, n * sizeof(float complex))
+      memcpy(du, du_in, (n - 1) * sizeof(float complex))
+    cgtsv(&n, &nrhs, dl, d, du, x_out, &ldb, info)
+    dl_in += n
+    d_in += n
+    du_in += n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_cgtsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_cgtsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, gtsv_flops(n, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_cgtsv", <void*>(lapack_cgtsv))
+
+cdef void lapack_zgtsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  cdef const double complex* dl_in = <double complex*>(data[4]) + begin * n
+  cdef const double complex* d_in = <double complex*>(data[5]) + begin * n
+  cdef const double complex* du_in = <double complex*>(data[6]) + begin * n
+  cdef const double complex* b_in = <double complex*>(data[7]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* x_out = <double complex*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?gtsv overwrites the diagonals, so each thread works on its own copy.
+  cdef double complex* dl = <double complex*>(out[2]) + slot * 3 * n
+  cdef double complex* d = dl + n
+  cdef double complex* du = d + n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(double complex))
+
+  cdef int ldb = max(n, 1)
+  for _ in range(begin, end):
+    if n > 0:
+      memcpy(dl, dl_in + 1, (n - 1) * sizeof(double complex))
+      memcpy(d, d_in, n * sizeof(double complex))
+      memcpy(du, du_in, (n - 1) * sizeof(double complex))
+    zgtsv(&n, &nrhs, dl, d, du, x_out, &ldb, info)
+    dl_in += n
+    d_in += n
+    du_in += n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_zgtsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int nrhs = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_zgtsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, gtsv_flops(n, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_zgtsv", <void*>(lapack_zgtsv))
+
+# ?gbsv: Solves a general banded system of linear equations
+
+cdef void lapack_sgbsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int kl = (<int32_t*>(data[3]))[0]
+  cdef int ku = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  cdef int ldab_in = kl + ku + 1
+  cdef const float* ab_in = <float*>(data[6]) + begin * ldab_in * n
+  cdef const float* b_in = <float*>(data[7]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float* x_out = <float*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?gbsv needs kl extra rows above the band for fill-in, so the band is
+  # copied into a per-thread workspace with a larger leading dimension.
+  cdef int ldab = 2 * kl + ku + 1
+  cdef float* ab = <float*>(out[2]) + slot * ldab * n
+  cdef int* ipiv = <int*>(out[3]) + slot * n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(float))
+
+  cdef int ldb = max(n, 1)
+  cdef int j
+  for _ in range(begin, end):
+    for j in range(n):
+      memcpy(ab + j * ldab + kl, ab_in + j * ldab_in, ldab_in * sizeof(float))
+    sgbsv(&n, &kl, &ku, &nrhs, ab, &ldab, ipiv, x_out, &ldb, info)
+    ab_in += ldab_in * n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_sgbsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int kl = (<int32_t*>(data[3]))[0]
+  cdef int ku = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_sgbsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, gbsv_flops(n, kl, ku, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_sgbsv", <void*>(lapack_sgbsv))
+
+cdef void lapack_dgbsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int kl = (<int32_t*>(data[3]))[0]
+  cdef int ku = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  cdef int ldab_in = kl + ku + 1
+  cdef const double* ab_in = <double*>(data[6]) + begin * ldab_in * n
+  cdef const double* b_in = <double*>(data[7]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* x_out = <double*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?gbsv needs kl extra rows above the band for fill-in, so the band is
+  # copied into a per-thread workspace with a larger leading dimension.
+  cdef int ldab = 2 * kl + ku + 1
+  cdef double* ab = <double*>(out[2]) + slot * ldab * n
+  cdef int* ipiv = <int*>(out[3]) + slot * n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(double))
+
+  cdef int ldb = max(n, 1)
+  cdef int j
+  for _ in range(begin, end):
+    for j in range(n):
+      memcpy(ab + j * ldab + kl, ab_in + j * ldab_in, ldab_in * sizeof(double))
+    dgbsv(&n, &kl, &ku, &nrhs, ab, &ldab, ipiv, x_out, &ldb, info)
+    ab_in += ldab_in * n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_dgbsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int kl = (<int32_t*>(data[3]))[0]
+  cdef int ku = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_dgbsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, gbsv_flops(n, kl, ku, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_dgbsv", <void*>(lapack_dgbsv))
+
+cdef void lapack_cgbsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int kl = (<int32_t*>(data[3]))[0]
+  cdef int ku = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  cdef int ldab_in = kl + ku + 1
+  cdef const float complex* ab_in = <float complex*>(data[6]) + begin * ldab_in * n
+  cdef const float complex* b_in = <float complex*>(data[7]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float complex* x_out = <float complex*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?gbsv needs kl extra rows above the band for fill-in, so the band is
+  # copied into a per-thread workspace with a larger leading dimension.
+  cdef int ldab = 2 * kl + ku + 1
+  cdef float complex* ab = <float complex*>(out[2]) + slot * ldab * n
+  cdef int* ipiv = <int*>(out[3]) + slot * n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(float complex))
+
+  cdef int ldb = max(n, 1)
+  cdef int j
+  for _ in range(begin, end):
+    for j in range(n):
+      memcpy(ab + j * ldab + kl, ab_in + j * ldab_in,
+             ldab_in * sizeof(float complex))
+    cgbsv(&n, &kl, &ku, &nrhs, ab, &ldab, ipiv, x_out, &ldb, info)
+    ab_in += ldab_in * n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_cgbsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int kl = (<int32_t*>(data[3]))[0]
+  cdef int ku = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_cgbsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, gbsv_flops(n, kl, ku, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_cgbsv", <void*>(lapack_cgbsv))
+
+cdef void lapack_zgbsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int kl = (<int32_t*>(data[3]))[0]
+  cdef int ku = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  cdef int ldab_in = kl + ku + 1
+  cdef const double complex* ab_in = <double complex*>(data[6]) + begin * ldab_in * n
+  cdef const double complex* b_in = <double complex*>(data[7]) + begin * n * nrhs
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* x_out = <double complex*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?gbsv needs kl extra rows above the band for fill-in, so the band is
+  # copied into a per-thread workspace with a larger leading dimension.
+  cdef int ldab = 2 * kl + ku + 1
+  cdef double complex* ab = <double complex*>(out[2]) + slot * ldab * n
+  cdef int* ipiv = <int*>(out[3]) + slot * n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(double complex))
+
+  cdef int ldb = max(n, 1)
+  cdef int j
+  for _ in range(begin, end):
+    for j in range(n):
+      memcpy(ab + j * ldab + kl, ab_in + j * ldab_in,
+             ldab_in * sizeof(double complex))
+    zgbsv(&n, &kl, &ku, &nrhs, ab, &ldab, ipiv, x_out, &ldb, info)
+    ab_in += ldab_in * n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_zgbsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[2]))[0]
+  cdef int kl = (<int32_t*>(data[3]))[0]
+  cdef int ku = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_zgbsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, gbsv_flops(n, kl, ku, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_zgbsv", <void*>(lapack_zgbsv))
+
+# ?pbsv: Solves a positive definite banded system of linear equations
+
+cdef void lapack_spbsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int kd = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  cdef int ldab = kd + 1
+  cdef const float* ab_in = <float*>(data[6]) + begin * ldab * n
+  cdef const float* b_in = <float*>(data[7]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float* x_out = <float*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?pbsv overwrites the band with its Cholesky factor.
+  cdef float* ab = <float*>(out[2]) + slot * ldab * n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(float))
+
+  cdef int ldb = max(n, 1)
+  for _ in range(begin, end):
+    memcpy(ab, ab_in, ldab * n * sizeof(float))
+    spbsv(&uplo, &n, &kd, &nrhs, ab, &ldab, x_out, &ldb, info)
+    ab_in += ldab * n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_spbsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int kd = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_spbsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, pbsv_flops(n, kd, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_spbsv", <void*>(lapack_spbsv))
+
+cdef void lapack_dpbsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int kd = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  cdef int ldab = kd + 1
+  cdef const double* ab_in = <double*>(data[6]) + begin * ldab * n
+  cdef const double* b_in = <double*>(data[7]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* x_out = <double*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?pbsv overwrites the band with its Cholesky factor.
+  cdef double* ab = <double*>(out[2]) + slot * ldab * n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(double))
+
+  cdef int ldb = max(n, 1)
+  for _ in range(begin, end):
+    memcpy(ab, ab_in, ldab * n * sizeof(double))
+    dpbsv(&uplo, &n, &kd, &nrhs, ab, &ldab, x_out, &ldb, info)
+    ab_in += ldab * n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_dpbsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int kd = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_dpbsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, pbsv_flops(n, kd, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_dpbsv", <void*>(lapack_dpbsv))
+
+cdef void lapack_cpbsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int kd = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  cdef int ldab = kd + 1
+  cdef const float complex* ab_in = <float complex*>(data[6]) + begin * ldab * n
+  cdef const float complex* b_in = <float complex*>(data[7]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float complex* x_out = <float complex*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?pbsv overwrites the band with its Cholesky factor.
+  cdef float complex* ab = <float complex*>(out[2]) + slot * ldab * n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(float complex))
+
+  cdef int ldb = max(n, 1)
+  for _ in range(begin, end):
+    memcpy(ab, ab_in, ldab * n * sizeof(float complex))
+    cpbsv(&uplo, &n, &kd, &nrhs, ab, &ldab, x_out, &ldb, info)
+    ab_in += ldab * n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_cpbsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int kd = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_cpbsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, pbsv_flops(n, kd, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_cpbsv", <void*>(lapack_cpbsv))
+
+cdef void lapack_zpbsv_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int kd = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  cdef int ldab = kd + 1
+  cdef const double complex* ab_in = <double complex*>(data[6]) + begin * ldab * n
+  cdef const double complex* b_in = <double complex*>(data[7]) + begin * n * nrhs
+  cdef char uplo = 'L' if lower else 'U'
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* x_out = <double complex*>(out[0]) + begin * n * nrhs
+  cdef int* info = <int*>(out[1]) + begin
+  # ?pbsv overwrites the band with its Cholesky factor.
+  cdef double complex* ab = <double complex*>(out[2]) + slot * ldab * n
+  if x_out != b_in:
+    memcpy(x_out, b_in, (end - begin) * n * nrhs * sizeof(double complex))
+
+  cdef int ldb = max(n, 1)
+  for _ in range(begin, end):
+    memcpy(ab, ab_in, ldab * n * sizeof(double complex))
+    zpbsv(&uplo, &n, &kd, &nrhs, ab, &ldab, x_out, &ldb, info)
+    ab_in += ldab * n
+    x_out += n * nrhs
+    info += 1
+
+cdef void lapack_zpbsv(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int kd = (<int32_t*>(data[4]))[0]
+  cdef int nrhs = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_zpbsv_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, pbsv_flops(n, kd, nrhs))))
+
+register_cpu_custom_call_target(b"lapack_zpbsv", <void*>(lapack_zpbsv))
+
+def _band_solve_batch(c, name, a_dims, b, n):
+  """Checks that `b` is a batch of n x nrhs right-hand sides whose batch
+  dimensions match `a_dims[:-1]`, the batch dimensions and band of the
+  matrix operands. Returns (b_dims, batch_dims, batch).
+  """
+  b_shape = c.GetShape(b)
+  b_dims = b_shape.dimensions()
+  batch_dims = tuple(a_dims[:-2])
+  if (len(b_dims) != len(batch_dims) + 2 or b_dims[:-2] != batch_dims or
+      b_dims[-2] != n):
+    raise ValueError("Argument mismatch for {}, got {} and {}".format(
+      name, a_dims, b_shape))
+  batch = 1
+  for d in batch_dims:
+    batch *= d
+  return b_dims, batch_dims, batch
+
+def gtsv(c, dl, d, du, b):
+  """Solves the tridiagonal system a @ x = b.
+
+  `dl`, `d` and `du` have shape [..., n] and hold the sub-, main and
+  superdiagonals of `a`, with a[i, i - 1] = dl[i] and a[i, i + 1] = du[i];
+  dl[..., 0] and du[..., n - 1] are ignored. Returns x and info; info > 0
+  means `a` is singular.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  d_shape = c.GetShape(d)
+  dtype = d_shape.element_type()
+  dims = d_shape.dimensions()
+  n = dims[-1]
+  for v in (dl, du):
+    if c.GetShape(v).dimensions() != dims:
+      raise ValueError("gtsv expects diagonals of equal shape, got {}".format(
+        [c.GetShape(x) for x in (dl, d, du)]))
+  b_dims, batch_dims, batch = _band_solve_batch(
+      c, "gtsv", dims + (1,), b, n)
+  nrhs = b_dims[-1]
+  num_bd = len(batch_dims)
+  slots = batch_parallelism(batch, gtsv_flops(n, nrhs))
+
+  if dtype == np.float32:
+    fn = b"lapack_sgtsv"
+  elif dtype == np.float64:
+    fn = b"lapack_dgtsv"
+  elif dtype == np.complex64:
+    fn = b"lapack_cgtsv"
+  elif dtype == np.complex128:
+    fn = b"lapack_zgtsv"
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  layout = _column_major_layout(num_bd)
+  vector_layout = tuple(range(num_bd, -1, -1))
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(batch), c.ConstantS32Scalar(slots),
+                c.ConstantS32Scalar(n), c.ConstantS32Scalar(nrhs),
+                dl, d, du, b),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, b_dims, layout),
+          Shape.array_shape(
+            np.dtype(np.int32), batch_dims, tuple(range(num_bd - 1, -1, -1))),
+          Shape.array_shape(dtype, (slots * 3 * n,), (0,)),
+      )),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, vector_layout),
+          Shape.array_shape(dtype, dims, vector_layout),
+          Shape.array_shape(dtype, dims, vector_layout),
+          Shape.array_shape(dtype, b_dims, layout),
+      ))
+  return c.GetTupleElement(out, 0), c.GetTupleElement(out, 1)
+
+def gbsv(c, ab, b, lower_bandwidth, upper_bandwidth):
+  """Solves the banded system a @ x = b.
+
+  `ab` has shape [..., kl + ku + 1, n], where kl and ku are the lower and
+  upper bandwidths, and holds `a` in LAPACK band storage:
+  a[i, j] = ab[ku + i - j, j]. Returns x and info; info > 0 means `a` is
+  singular.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  ab_shape = c.GetShape(ab)
+  dtype = ab_shape.element_type()
+  dims = ab_shape.dimensions()
+  kl, ku = lower_bandwidth, upper_bandwidth
+  n = dims[-1]
+  if kl < 0 or ku < 0 or dims[-2] != kl + ku + 1:
+    raise ValueError(
+      "gbsv expects a band of kl + ku + 1 = {} rows, got {}".format(
+        kl + ku + 1, ab_shape))
+  b_dims, batch_dims, batch = _band_solve_batch(c, "gbsv", dims, b, n)
+  nrhs = b_dims[-1]
+  num_bd = len(batch_dims)
+  slots = batch_parallelism(batch, gbsv_flops(n, kl, ku, nrhs))
+
+  if dtype == np.float32:
+    fn = b"lapack_sgbsv"
+  elif dtype == np.float64:
+    fn = b"lapack_dgbsv"
+  elif dtype == np.complex64:
+    fn = b"lapack_cgbsv"
+  elif dtype == np.complex128:
+    fn = b"lapack_zgbsv"
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  layout = _column_major_layout(num_bd)
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(batch), c.ConstantS32Scalar(slots),
+                c.ConstantS32Scalar(n), c.ConstantS32Scalar(kl),
+                c.ConstantS32Scalar(ku), c.ConstantS32Scalar(nrhs), ab, b),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, b_dims, layout),
+          Shape.array_shape(
+            np.dtype(np.int32), batch_dims, tuple(range(num_bd - 1, -1, -1))),
+          Shape.array_shape(dtype, (slots * (2 * kl + ku + 1) * n,), (0,)),
+          Shape.array_shape(np.dtype(np.int32), (slots * n,), (0,)),
+      )),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, b_dims, layout),
+      ))
+  return c.GetTupleElement(out, 0), c.GetTupleElement(out, 1)
+
+def pbsv(c, ab, b, lower=False):
+  """Solves the positive definite banded system a @ x = b.
+
+  `ab` has shape [..., kd + 1, n], where kd is the bandwidth, and holds the
+  `lower` or upper triangle of `a` in LAPACK band storage: a[i, j] =
+  ab[i - j, j] for i >= j if `lower`, else a[i, j] = ab[kd + i - j, j] for
+  i <= j. Returns x and info; info > 0 means `a` is not positive definite.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  ab_shape = c.GetShape(ab)
+  dtype = ab_shape.element_type()
+  dims = ab_shape.dimensions()
+  kd = dims[-2] - 1
+  n = dims[-1]
+  b_dims, batch_dims, batch = _band_solve_batch(c, "pbsv", dims, b, n)
+  nrhs = b_dims[-1]
+  num_bd = len(batch_dims)
+  slots = batch_parallelism(batch, pbsv_flops(n, kd, nrhs))
+
+  if dtype == np.float32:
+    fn = b"lapack_spbsv"
+  elif dtype == np.float64:
+    fn = b"lapack_dpbsv"
+  elif dtype == np.complex64:
+    fn = b"lapack_cpbsv"
+  elif dtype == np.complex128:
+    fn = b"lapack_zpbsv"
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  layout = _column_major_layout(num_bd)
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(int(lower)), c.ConstantS32Scalar(batch),
+                c.ConstantS32Scalar(slots), c.ConstantS32Scalar(n),
+                c.ConstantS32Scalar(kd), c.ConstantS32Scalar(nrhs), ab, b),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, b_dims, layout),
+          Shape.array_shape(
+            np.dtype(np.int32), batch_dims, tuple(range(num_bd - 1, -1, -1))),
+          Shape.array_shape(dtype, (slots * (kd + 1) * n,), (0,)),
+      )),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, b_dims, layout),
+      ))
+  return c.GetTupleElement(out, 0), c.GetTupleElement(out, 1)
+
+
+# ?geqrf: QR decomposition
+
+# Flop counts used by the thread pool's cost model.
+cdef double geqrf_flops(int m, int n) noexcept nogil:
+  return 2. * m * n * min(m, n)
+
+cdef double orgqr_flops(int m, int n, int k) noexcept nogil:
+  return 2. * m * n * k
+
+# Returns the optimal size of the ?geqrf work array, queried once when the
+# computation is built.
+cdef int geqrf_work_size(dtype, int m, int n) except -1:
+  cdef int lda = max(m, 1)
+  cdef int lwork = -1
+  cdef int info = 0
+  cdef float swork = 0
+  cdef double dwork = 0
+  cdef float complex cwork = 0
+  cdef double complex zwork = 0
+  if dtype == np.float32:
+    sgeqrf(&m, &n, NULL, &lda, NULL, &swork, &lwork, &info)
+    lwork = <int>swork
+  elif dtype == np.float64:
+    dgeqrf(&m, &n, NULL, &lda, NULL, &dwork, &lwork, &info)
+    lwork = <int>dwork
+  elif dtype == np.complex64:
+    cgeqrf(&m, &n, NULL, &lda, NULL, &cwork, &lwork, &info)
+    lwork = <int>(cwork.real)
+  elif dtype == np.complex128:
+    zgeqrf(&m, &n, NULL, &lda, NULL, &zwork, &lwork, &info)
+    lwork = <int>(zwork.real)
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+  return max(lwork, 1)
+
+cdef void lapack_sgeqrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int lwork = (<int32_t*>(data[4]))[0]
+  cdef const float* a_in = <float*>(data[5]) + begin * m * n
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float* a_out = <float*>(out[0]) + begin * m * n
+  cdef float* tau = <float*>(out[1]) + begin * min(m, n)
+  cdef int* info = <int*>(out[2]) + begin
+  cdef float* work = <float*>(out[3]) + slot * lwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(float))
+
+  for _ in range(begin, end):
+    sgeqrf(&m, &n, a_out, &m, tau, work, &lwork, info)
+    a_out += m * n
+    tau += min(m, n)
+    info += 1
+
+cdef void lapack_sgeqrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_sgeqrf_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, geqrf_flops(m, n))))
+
+register_cpu_custom_call_target(b"lapack_sgeqrf", <void*>(lapack_sgeqrf))
+
+cdef void lapack_dgeqrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int lwork = (<int32_t*>(data[4]))[0]
+  cdef const double* a_in = <double*>(data[5]) + begin * m * n
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* a_out = <double*>(out[0]) + begin * m * n
+  cdef double* tau = <double*>(out[1]) + begin * min(m, n)
+  cdef int* info = <int*>(out[2]) + begin
+  cdef double* work = <double*>(out[3]) + slot * lwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(double))
+
+  for _ in range(begin, end):
+    dgeqrf(&m, &n, a_out, &m, tau, work, &lwork, info)
+    a_out += m * n
+    tau += min(m, n)
+    info += 1
+
+cdef void lapack_dgeqrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_dgeqrf_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, geqrf_flops(m, n))))
+
+register_cpu_custom_call_target(b"lapack_dgeqrf", <void*>(lapack_dgeqrf))
+
+cdef void lapack_cgeqrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int lwork = (<int32_t*>(data[4]))[0]
+  cdef const float complex* a_in = <float complex*>(data[5]) + begin * m * n
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float complex* a_out = <float complex*>(out[0]) + begin * m * n
+  cdef float complex* tau = <float complex*>(out[1]) + begin * min(m, n)
+  cdef int* info = <int*>(out[2]) + begin
+  cdef float complex* work = <float complex*>(out[3]) + slot * lwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(float complex))
+
+  for _ in range(begin, end):
+    cgeqrf(&m, &n, a_out, &m, tau, work, &lwork, info)
+    a_out += m * n
+    tau += min(m, n)
+    info += 1
+
+cdef void lapack_cgeqrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_cgeqrf_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, geqrf_flops(m, n))))
+
+register_cpu_custom_call_target(b"lapack_cgeqrf", <void*>(lapack_cgeqrf))
+
+cdef void lapack_zgeqrf_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int lwork = (<int32_t*>(data[4]))[0]
+  cdef const double complex* a_in = <double complex*>(data[5]) + begin * m * n
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * m * n
+  cdef double complex* tau = <double complex*>(out[1]) + begin * min(m, n)
+  cdef int* info = <int*>(out[2]) + begin
+  cdef double complex* work = <double complex*>(out[3]) + slot * lwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(double complex))
+
+  for _ in range(begin, end):
+    zgeqrf(&m, &n, a_out, &m, tau, work, &lwork, info)
+    a_out += m * n
+    tau += min(m, n)
+    info += 1
+
+cdef void lapack_zgeqrf(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_zgeqrf_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, geqrf_flops(m, n))))
+
+register_cpu_custom_call_target(b"lapack_zgeqrf", <void*>(lapack_zgeqrf))
+
+def geqrf(c, a):
+  """Builds a batched QR decomposition of `a`, of shape batch_dims + (m, n).
+
+  Returns the factored matrices, in LAPACK's packed form, the Householder
+  scalars tau, of shape batch_dims + (min(m, n),), and info.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  a_shape = c.GetShape(a)
+  dtype = a_shape.element_type()
+  dims = a_shape.dimensions()
+  assert len(dims) >= 2
+  m, n = dims[-2:]
+  batch_dims = tuple(dims[:-2])
+  num_bd = len(batch_dims)
+  b = 1
+  for d in batch_dims:
+    b *= d
+
+  if dtype == np.float32:
+    fn = b"lapack_sgeqrf"
+  elif dtype == np.float64:
+    fn = b"lapack_dgeqrf"
+  elif dtype == np.complex64:
+    fn = b"lapack_cgeqrf"
+  elif dtype == np.complex128:
+    fn = b"lapack_zgeqrf"
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  # Each thread working on the batch needs its own workspace.
+  slots = batch_parallelism(b, geqrf_flops(m, n))
+  lwork = geqrf_work_size(dtype, m, n)
+  layout = _column_major_layout(num_bd)
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(b), c.ConstantS32Scalar(slots),
+                c.ConstantS32Scalar(m), c.ConstantS32Scalar(n),
+                c.ConstantS32Scalar(lwork), a),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, batch_dims + (min(m, n),),
+                            tuple(range(num_bd, -1, -1))),
+          Shape.array_shape(np.dtype(np.int32), batch_dims,
+                            tuple(range(num_bd - 1, -1, -1))),
+          Shape.array_shape(dtype, (slots * lwork,), (0,)),
+      )),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+      ))
+  return (c.GetTupleElement(out, 0), c.GetTupleElement(out, 1),
+          c.GetTupleElement(out, 2))
+
+
+# ?orgqr: product of elementary Householder reflectors, as computed by ?geqrf.
+# The complex variants are ?ungqr.
+
+# Returns the optimal size of the ?orgqr work array, queried once when the
+# computation is built.
+cdef int orgqr_work_size(dtype, int m, int n, int k) except -1:
+  cdef int lda = max(m, 1)
+  cdef int lwork = -1
+  cdef int info = 0
+  cdef float swork = 0
+  cdef double dwork = 0
+  cdef float complex cwork = 0
+  cdef double complex zwork = 0
+  if dtype == np.float32:
+    sorgqr(&m, &n, &k, NULL, &lda, NULL, &swork, &lwork, &info)
+    lwork = <int>swork
+  elif dtype == np.float64:
+    dorgqr(&m, &n, &k, NULL, &lda, NULL, &dwork, &lwork, &info)
+    lwork = <int>dwork
+  elif dtype == np.complex64:
+    cungqr(&m, &n, &k, NULL, &lda, NULL, &cwork, &lwork, &info)
+    lwork = <int>(cwork.real)
+  elif dtype == np.complex128:
+    zungqr(&m, &n, &k, NULL, &lda, NULL, &zwork, &lwork, &info)
+    lwork = <int>(zwork.real)
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+  return max(lwork, 1)
+
+cdef void lapack_sorgqr_range(void* out_tuple, void** data, int begin,
+                               int end, int slot) noexcept nogil:
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[4]))[0]
+  cdef int lwork = (<int32_t*>(data[5]))[0]
+  cdef const float* a_in = <float*>(data[6]) + begin * m * n
+  cdef float* tau = <float*>(data[7]) + begin * k
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float* a_out = <float*>(out[0]) + begin * m * n
+  cdef int* info = <int*>(out[1]) + begin
+  cdef float* work = <float*>(out[2]) + slot * lwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(float))
+
+  for _ in range(begin, end):
+    sorgqr(&m, &n, &k, a_out, &m, tau, work, &lwork, info)
+    a_out += m * n
+    tau += k
+    info += 1
+
+cdef void lapack_sorgqr(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[4]))[0]
+  parallel_batch(lapack_sorgqr_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, orgqr_flops(m, n, k))))
+
+register_cpu_custom_call_target(b"lapack_sorgqr", <void*>(lapack_sorgqr))
+
+cdef void lapack_dorgqr_range(void* out_tuple, void** data, int begin,
+                               int end, int slot) noexcept nogil:
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[4]))[0]
+  cdef int lwork = (<int32_t*>(data[5]))[0]
+  cdef const double* a_in = <double*>(data[6]) + begin * m * n
+  cdef double* tau = <double*>(data[7]) + begin * k
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* a_out = <double*>(out[0]) + begin * m * n
+  cdef int* info = <int*>(out[1]) + begin
+  cdef double* work = <double*>(out[2]) + slot * lwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(double))
+
+  for _ in range(begin, end):
+    dorgqr(&m, &n, &k, a_out, &m, tau, work, &lwork, info)
+    a_out += m * n
+    tau += k
+    info += 1
+
+cdef void lapack_dorgqr(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[4]))[0]
+  parallel_batch(lapack_dorgqr_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, orgqr_flops(m, n, k))))
+
+register_cpu_custom_call_target(b"lapack_dorgqr", <void*>(lapack_dorgqr))
+
+cdef void lapack_cungqr_range(void* out_tuple, void** data, int begin,
+                               int end, int slot) noexcept nogil:
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[4]))[0]
+  cdef int lwork = (<int32_t*>(data[5]))[0]
+  cdef const float complex* a_in = <float complex*>(data[6]) + begin * m * n
+  cdef float complex* tau = <float complex*>(data[7]) + begin * k
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float complex* a_out = <float complex*>(out[0]) + begin * m * n
+  cdef int* info = <int*>(out[1]) + begin
+  cdef float complex* work = <float complex*>(out[2]) + slot * lwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(float complex))
+
+  for _ in range(begin, end):
+    cungqr(&m, &n, &k, a_out, &m, tau, work, &lwork, info)
+    a_out += m * n
+    tau += k
+    info += 1
+
+cdef void lapack_cungqr(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[4]))[0]
+  parallel_batch(lapack_cungqr_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, orgqr_flops(m, n, k))))
+
+register_cpu_custom_call_target(b"lapack_cungqr", <void*>(lapack_cungqr))
+
+cdef void lapack_zungqr_range(void* out_tuple, void** data, int begin,
+                               int end, int slot) noexcept nogil:
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[4]))[0]
+  cdef int lwork = (<int32_t*>(data[5]))[0]
+  cdef const double complex* a_in = <double complex*>(data[6]) + begin * m * n
+  cdef double complex* tau = <double complex*>(data[7]) + begin * k
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * m * n
+  cdef int* info = <int*>(out[1]) + begin
+  cdef double complex* work = <double complex*>(out[2]) + slot * lwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(double complex))
+
+  for _ in range(begin, end):
+    zungqr(&m, &n, &k, a_out, &m, tau, work, &lwork, info)
+    a_out += m * n
+    tau += k
+    info += 1
+
+cdef void lapack_zungqr(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[0]))[0]
+  cdef int slots = (<int32_t*>(data[1]))[0]
+  cdef int m = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[4]))[0]
+  parallel_batch(lapack_zungqr_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, orgqr_flops(m, n, k))))
+
+register_cpu_custom_call_target(b"lapack_zungqr", <void*>(lapack_zungqr))
+
+def orgqr(c, a, tau):
+  """Builds the product of the Householder reflectors returned by `geqrf`.
+
+  `a` has shape batch_dims + (m, n) and `tau` has shape batch_dims + (k,),
+  where k <= n <= m. Returns the first n columns of Q, and info.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  a_shape = c.GetShape(a)
+  dtype = a_shape.element_type()
+  dims = a_shape.dimensions()
+  assert len(dims) >= 2
+  m, n = dims[-2:]
+  batch_dims = tuple(dims[:-2])
+  num_bd = len(batch_dims)
+  b = 1
+  for d in batch_dims:
+    b *= d
+
+  tau_dims = c.GetShape(tau).dimensions()
+  if tau_dims[:-1] != batch_dims:
+    raise ValueError("Argument mismatch for orgqr, got {} and {}".format(
+      a_shape, c.GetShape(tau)))
+  k = tau_dims[-1]
+
+  if dtype == np.float32:
+    fn = b"lapack_sorgqr"
+  elif dtype == np.float64:
+    fn = b"lapack_dorgqr"
+  elif dtype == np.complex64:
+    fn = b"lapack_cungqr"
+  elif dtype == np.complex128:
+    fn = b"lapack_zungqr"
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  # Each thread working on the batch needs its own workspace.
+  slots = batch_parallelism(b, orgqr_flops(m, n, k))
+  lwork = orgqr_work_size(dtype, m, n, k)
+  layout = _column_major_layout(num_bd)
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(b), c.ConstantS32Scalar(slots),
+                c.ConstantS32Scalar(m), c.ConstantS32Scalar(n),
+                c.ConstantS32Scalar(k), c.ConstantS32Scalar(lwork), a, tau),
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(np.dtype(np.int32), batch_dims,
+                            tuple(range(num_bd - 1, -1, -1))),
+          Shape.array_shape(dtype, (slots * lwork,), (0,)),
+      )),
+      operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(dtype, tau_dims, tuple(range(num_bd, -1, -1))),
+      ))
+  return c.GetTupleElement(out, 0), c.GetTupleElement(out, 1)
+
+
+# ?gesdd: Singular value decomposition
+
+cdef int gesdd_iwork_size(int m, int n) noexcept nogil:
+  return 8 * min(m, n)
+
+cdef int cgesdd_rwork_size(int m, int n, int compute_uv) noexcept nogil:
+  cdef int mn = min(m, n)
+  if compute_uv == 0:
+    return 7 * mn
+  cdef int mx = max(m, n)
+  return max(5 * mn * mn + 5 * mn, 2 * mx * mn + 2 * mn * mn + mn)
+
+cdef double gesdd_flops(int m, int n) noexcept nogil:
+  return 10. * m * n * min(m, n)
+
+# Returns the optimal size of the ?gesdd work array. The query is made once,
+# when the computation is built, so that the kernel can use XLA-allocated
+# scratch space.
+cdef int gesdd_work_size(dtype, int m, int n, bint compute_uv,
+                         bint full_matrices) except -1:
+  cdef char jobz = 'A'
+  if not compute_uv:
+    jobz = 'N'
+  elif not full_matrices:
+    jobz = 'S'
+  cdef int lda = max(m, 1)
+  cdef int ldu = max(m, 1)
+  cdef int ldvt = max(n if full_matrices else min(m, n), 1)
+  cdef int lwork = -1
+  cdef int info = 0
+  cdef float swork = 0
+  cdef double dwork = 0
+  cdef float complex cwork = 0
+  cdef double complex zwork = 0
+  if dtype == np.float32:
+    sgesdd(&jobz, &m, &n, NULL, &lda, NULL, NULL, &ldu, NULL, &ldvt, &swork,
+           &lwork, NULL, &info)
+    lwork = <int>swork
+  elif dtype == np.float64:
+    dgesdd(&jobz, &m, &n, NULL, &lda, NULL, NULL, &ldu, NULL, &ldvt, &dwork,
+           &lwork, NULL, &info)
+    lwork = <int>dwork
+  elif dtype == np.complex64:
+    cgesdd(&jobz, &m, &n, NULL, &lda, NULL, NULL, &ldu, NULL, &ldvt, &cwork,
+           &lwork, NULL, NULL, &info)
+    lwork = <int>(cwork.real)
+  elif dtype == np.complex128:
+    zgesdd(&jobz, &m, &n, NULL, &lda, NULL, NULL, &ldu, NULL, &ldvt, &zwork,
+           &lwork, NULL, NULL, &info)
+    lwork = <int>(zwork.real)
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+  return max(lwork, 1)
 
-cdef void lapack_sgesdd(void* out_tuple, void** data) nogil:
+cdef void lapack_sgesdd_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int32_t job_opt_full_matrices = (<int32_t*>(data[0]))[0]
   cdef int32_t job_opt_compute_uv = (<int32_t*>(data[1]))[0]
-  cdef int m = (<int32_t*>(data[2]))[0]
-  cdef int n = (<int32_t*>(data[3]))[0]
-  cdef float* a_in = <float*>(data[4])
+  cdef int m = (<int32_t*>(data[4]))[0]
+  cdef int n = (<int32_t*>(data[5]))[0]
+  cdef int lwork = (<int32_t*>(data[6]))[0]
+  cdef float* a_in = <float*>(data[7]) + begin * m * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef float* a_out = <float*>(out[0])
-  cdef float* s = <float*>(out[1])
+  cdef float* a_out = <float*>(out[0]) + begin * m * n
+  cdef float* s = <float*>(out[1]) + begin * min(m, n)
   cdef float* u = <float*>(out[2])
   cdef float* vt = <float*>(out[3])
-  cdef int* info = <int*>(out[4])
-  cdef int* iwork = <int*>(out[5])
+  cdef int* info = <int*>(out[4]) + begin
+  cdef int* iwork = <int*>(out[5]) + slot * gesdd_iwork_size(m, n)
 
   if a_out != a_in:
-    memcpy(a_out, a_in, m * n * sizeof(float))
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(float))
 
   # define appropriate job code
   cdef char jobz = 'A'
@@ -508,43 +3803,53 @@ cdef void lapack_sgesdd(void* out_tuple, void** data) nogil:
 
   cdef int lda = m
   cdef int ldu = m
+  cdef int tdu = m if job_opt_full_matrices else min(m, n)
   cdef int ldvt = n
   if job_opt_full_matrices == 0:
     ldvt = min(m, n)
+  u += begin * m * tdu
+  vt += begin * ldvt * n
 
-  # First perform a workspace query to get the optimal lwork
-  # NB: We perform a workspace query with malloc and free for the work array, 
-  # because it is officially recommended in the LAPACK documentation
-  cdef float wkopt = 0
-  cdef int lwork = -1
-  sgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, &wkopt, &lwork, iwork, info)
-  lwork = <int> wkopt
+  cdef float* work = <float*>(out[6]) + slot * lwork
+  for _ in range(begin, end):
+    sgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, work, &lwork,
+           iwork, info)
+    a_out += m * n
+    s += min(m, n)
+    u += m * tdu
+    vt += ldvt * n
+    info += 1
 
-  # Now get the actual SVD
-  cdef float* work = <float *> malloc(lwork * sizeof(float))
-  sgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, work, &lwork, iwork, info)
-  free(work)
+cdef void lapack_sgesdd(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[2]))[0]
+  cdef int slots = (<int32_t*>(data[3]))[0]
+  cdef int m = (<int32_t*>(data[4]))[0]
+  cdef int n = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_sgesdd_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, gesdd_flops(m, n))))
 
 register_cpu_custom_call_target(b"lapack_sgesdd", <void*>(lapack_sgesdd))
 
 
-cdef void lapack_dgesdd(void* out_tuple, void** data) nogil:
+cdef void lapack_dgesdd_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int32_t job_opt_full_matrices = (<int32_t*>(data[0]))[0]
   cdef int32_t job_opt_compute_uv = (<int32_t*>(data[1]))[0]
-  cdef int m = (<int32_t*>(data[2]))[0]
-  cdef int n = (<int32_t*>(data[3]))[0]
-  cdef double* a_in = <double*>(data[4])
+  cdef int m = (<int32_t*>(data[4]))[0]
+  cdef int n = (<int32_t*>(data[5]))[0]
+  cdef int lwork = (<int32_t*>(data[6]))[0]
+  cdef double* a_in = <double*>(data[7]) + begin * m * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef double* a_out = <double*>(out[0])
-  cdef double* s = <double*>(out[1])
+  cdef double* a_out = <double*>(out[0]) + begin * m * n
+  cdef double* s = <double*>(out[1]) + begin * min(m, n)
   cdef double* u = <double*>(out[2])
   cdef double* vt = <double*>(out[3])
-  cdef int* info = <int*>(out[4])
-  cdef int* iwork = <int*>(out[5])
+  cdef int* info = <int*>(out[4]) + begin
+  cdef int* iwork = <int*>(out[5]) + slot * gesdd_iwork_size(m, n)
 
   if a_out != a_in:
-    memcpy(a_out, a_in, m * n * sizeof(double))
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(double))
 
   # define appropriate job code
   cdef char jobz = 'A'
@@ -556,44 +3861,55 @@ cdef void lapack_dgesdd(void* out_tuple, void** data) nogil:
 
   cdef int lda = m
   cdef int ldu = m
+  cdef int tdu = m if job_opt_full_matrices else min(m, n)
   cdef int ldvt = n
   if job_opt_full_matrices == 0:
     ldvt = min(m, n)
+  u += begin * m * tdu
+  vt += begin * ldvt * n
 
-  # First perform a workspace query to get the optimal lwork
-  # NB: We perform a workspace query with malloc and free for the work array,
-  # because it is officially recommended in the LAPACK documentation
-  cdef double wkopt = 0
-  cdef int lwork = -1
-  dgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, &wkopt, &lwork, iwork, info)
-  lwork = <int> wkopt
+  cdef double* work = <double*>(out[6]) + slot * lwork
+  for _ in range(begin, end):
+    dgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, work, &lwork,
+           iwork, info)
+    a_out += m * n
+    s += min(m, n)
+    u += m * tdu
+    vt += ldvt * n
+    info += 1
 
-  # Now get the actual SVD
-  cdef double* work = <double *> malloc(lwork * sizeof(double))
-  dgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, work, &lwork, iwork, info)
-  free(work)
+cdef void lapack_dgesdd(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[2]))[0]
+  cdef int slots = (<int32_t*>(data[3]))[0]
+  cdef int m = (<int32_t*>(data[4]))[0]
+  cdef int n = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_dgesdd_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, gesdd_flops(m, n))))
 
 register_cpu_custom_call_target(b"lapack_dgesdd", <void*>(lapack_dgesdd))
 
 
-cdef void lapack_cgesdd(void* out_tuple, void** data) nogil:
+cdef void lapack_cgesdd_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int32_t job_opt_full_matrices = (<int32_t*>(data[0]))[0]
   cdef int32_t job_opt_compute_uv = (<int32_t*>(data[1]))[0]
-  cdef int m = (<int32_t*>(data[2]))[0]
-  cdef int n = (<int32_t*>(data[3]))[0]
-  cdef float complex* a_in = <float complex*>(data[4])
+  cdef int m = (<int32_t*>(data[4]))[0]
+  cdef int n = (<int32_t*>(data[5]))[0]
+  cdef int lwork = (<int32_t*>(data[6]))[0]
+  cdef float complex* a_in = <float complex*>(data[7]) + begin * m * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef float complex* a_out = <float complex*>(out[0])
-  cdef float* s = <float*>(out[1])
+  cdef float complex* a_out = <float complex*>(out[0]) + begin * m * n
+  cdef float* s = <float*>(out[1]) + begin * min(m, n)
   cdef float complex* u = <float complex*>(out[2])
   cdef float complex* vt = <float complex*>(out[3])
-  cdef int* info = <int*>(out[4])
-  cdef int* iwork = <int*>(out[5])
+  cdef int* info = <int*>(out[4]) + begin
+  cdef int* iwork = <int*>(out[5]) + slot * gesdd_iwork_size(m, n)
   cdef float* rwork = <float*>(out[6])
+  rwork += slot * cgesdd_rwork_size(m, n, job_opt_compute_uv)
 
   if a_out != a_in:
-    memcpy(a_out, a_in, m * n * sizeof(float complex))
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(float complex))
 
   # define appropriate job code
   cdef char jobz = 'A'
@@ -605,44 +3921,55 @@ cdef void lapack_cgesdd(void* out_tuple, void** data) nogil:
 
   cdef int lda = m
   cdef int ldu = m
+  cdef int tdu = m if job_opt_full_matrices else min(m, n)
   cdef int ldvt = n
   if job_opt_full_matrices == 0:
     ldvt = min(m, n)
+  u += begin * m * tdu
+  vt += begin * ldvt * n
 
-  # First perform a workspace query to get the optimal lwork
-  # NB: We perform a workspace query with malloc and free for the work array,
-  # because it is officially recommended in the LAPACK documentation
-  cdef float complex wkopt = 0
-  cdef int lwork = -1
-  cgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, &wkopt, &lwork, rwork, iwork, info)
-  lwork = <int>(wkopt.real)
+  cdef float complex* work = <float complex*>(out[7]) + slot * lwork
+  for _ in range(begin, end):
+    cgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, work, &lwork,
+           rwork, iwork, info)
+    a_out += m * n
+    s += min(m, n)
+    u += m * tdu
+    vt += ldvt * n
+    info += 1
 
-  # Now get the actual SVD
-  cdef float complex* work = <float complex*> malloc(lwork * sizeof(float complex))
-  cgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, work, &lwork, rwork, iwork, info)
-  free(work)
+cdef void lapack_cgesdd(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[2]))[0]
+  cdef int slots = (<int32_t*>(data[3]))[0]
+  cdef int m = (<int32_t*>(data[4]))[0]
+  cdef int n = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_cgesdd_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, gesdd_flops(m, n))))
 
 register_cpu_custom_call_target(b"lapack_cgesdd", <void*>(lapack_cgesdd))
 
 
-cdef void lapack_zgesdd(void* out_tuple, void** data) nogil:
+cdef void lapack_zgesdd_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int32_t job_opt_full_matrices = (<int32_t*>(data[0]))[0]
   cdef int32_t job_opt_compute_uv = (<int32_t*>(data[1]))[0]
-  cdef int m = (<int32_t*>(data[2]))[0]
-  cdef int n = (<int32_t*>(data[3]))[0]
-  cdef double complex* a_in = <double complex*>(data[4])
+  cdef int m = (<int32_t*>(data[4]))[0]
+  cdef int n = (<int32_t*>(data[5]))[0]
+  cdef int lwork = (<int32_t*>(data[6]))[0]
+  cdef double complex* a_in = <double complex*>(data[7]) + begin * m * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef double complex* a_out = <double complex*>(out[0])
-  cdef double* s = <double*>(out[1])
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * m * n
+  cdef double* s = <double*>(out[1]) + begin * min(m, n)
   cdef double complex* u = <double complex*>(out[2])
   cdef double complex* vt = <double complex*>(out[3])
-  cdef int* info = <int*>(out[4])
-  cdef int* iwork = <int*>(out[5])
+  cdef int* info = <int*>(out[4]) + begin
+  cdef int* iwork = <int*>(out[5]) + slot * gesdd_iwork_size(m, n)
   cdef double* rwork = <double*>(out[6])
+  rwork += slot * cgesdd_rwork_size(m, n, job_opt_compute_uv)
 
   if a_out != a_in:
-    memcpy(a_out, a_in, m * n * sizeof(double complex))
+    memcpy(a_out, a_in, (end - begin) * m * n * sizeof(double complex))
 
   # define appropriate job code
   cdef char jobz = 'A'
@@ -654,22 +3981,30 @@ cdef void lapack_zgesdd(void* out_tuple, void** data) nogil:
 
   cdef int lda = m
   cdef int ldu = m
+  cdef int tdu = m if job_opt_full_matrices else min(m, n)
   cdef int ldvt = n
   if job_opt_full_matrices == 0:
     ldvt = min(m, n)
+  u += begin * m * tdu
+  vt += begin * ldvt * n
 
-  # First perform a workspace query to get the optimal lwork
-  # NB: We perform a workspace query with malloc and free for the work array,
-  # because it is officially recommended in the LAPACK documentation
-  cdef double complex wkopt = 0
-  cdef int lwork = -1
-  zgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, &wkopt, &lwork, rwork, iwork, info)
-  lwork = <int>(wkopt.real)
+  cdef double complex* work = <double complex*>(out[7]) + slot * lwork
+  for _ in range(begin, end):
+    zgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, work, &lwork,
+           rwork, iwork, info)
+    a_out += m * n
+    s += min(m, n)
+    u += m * tdu
+    vt += ldvt * n
+    info += 1
 
-  # Now get the actual SVD
-  cdef double complex* work = <double complex*> malloc(lwork * sizeof(double complex))
-  zgesdd(&jobz, &m, &n, a_out, &lda, s, u, &ldu, vt, &ldvt, work, &lwork, rwork, iwork, info)
-  free(work)
+cdef void lapack_zgesdd(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[2]))[0]
+  cdef int slots = (<int32_t*>(data[3]))[0]
+  cdef int m = (<int32_t*>(data[4]))[0]
+  cdef int n = (<int32_t*>(data[5]))[0]
+  parallel_batch(lapack_zgesdd_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, gesdd_flops(m, n))))
 
 register_cpu_custom_call_target(b"lapack_zgesdd", <void*>(lapack_zgesdd))
 
@@ -678,56 +4013,86 @@ def gesdd(c, a, full_matrices=True, compute_uv=True):
 
   a_shape = c.GetShape(a)
   dtype = a_shape.element_type()
-  m, n = a_shape.dimensions()
+  dims = a_shape.dimensions()
+  assert len(dims) >= 2
+  # `a` is row-major, so the kernel decomposes A^T = U' S V'^H, which makes
+  # A = conj(V') S U'^T. The kernel's V'^H and U' outputs are then exactly
+  # u and vt of `a` in row-major order, so we ask for them in swapped slots.
+  n, m = dims[-2:]
+  batch_dims = tuple(dims[:-2])
+  num_bd = len(batch_dims)
+  b = 1
+  for d in batch_dims:
+    b *= d
+  # Each thread working on the batch needs its own workspace.
+  slots = batch_parallelism(b, gesdd_flops(m, n))
+  lwork = gesdd_work_size(dtype, m, n, compute_uv, full_matrices)
+
   if dtype == np.float32:
     fn = b"lapack_sgesdd"
     singular_vals_dtype = np.float32
     workspace = (Shape.array_shape(np.dtype(np.int32),
-                                   (gesdd_iwork_size(m, n),), (0,)),)
+                                   (slots * gesdd_iwork_size(m, n),), (0,)),)
   elif dtype == np.float64:
     fn = b"lapack_dgesdd"
     singular_vals_dtype = np.float64
     workspace = (Shape.array_shape(np.dtype(np.int32),
-                                   (gesdd_iwork_size(m, n),), (0,)),)
+                                   (slots * gesdd_iwork_size(m, n),), (0,)),)
   elif dtype == np.complex64:
     fn = b"lapack_cgesdd"
     singular_vals_dtype = np.float32
     workspace = (Shape.array_shape(np.dtype(np.int32),
-                                   (gesdd_iwork_size(m, n),), (0,)),
+                                   (slots * gesdd_iwork_size(m, n),), (0,)),
                  Shape.array_shape(np.dtype(np.float32),
-                                   (cgesdd_rwork_size(m, n, int(compute_uv)),),
+                                   (slots * cgesdd_rwork_size(
+                                       m, n, int(compute_uv)),),
                                    (0,)))
   elif dtype == np.complex128:
     fn = b"lapack_zgesdd"
     singular_vals_dtype = np.float64
     workspace = (Shape.array_shape(np.dtype(np.int32),
-                                   (gesdd_iwork_size(m, n),), (0,)),
+                                   (slots * gesdd_iwork_size(m, n),), (0,)),
                  Shape.array_shape(np.dtype(np.float64),
-                                   (cgesdd_rwork_size(m, n, int(compute_uv)),),
+                                   (slots * cgesdd_rwork_size(
+                                       m, n, int(compute_uv)),),
                                    (0,)))
   else:
     raise NotImplementedError("Unsupported dtype {}".format(dtype))
 
-  out = c.CustomCall(
-      fn,
+  matrix_layout = _row_major_layout(num_bd)
+  vector_layout = tuple(range(num_bd, -1, -1))
+  out = _custom_call(
+      c, fn,
       operands=(c.ConstantS32Scalar(int(full_matrices)), c.ConstantS32Scalar(int(compute_uv)),
-                c.ConstantS32Scalar(m), c.ConstantS32Scalar(n), a),
+                c.ConstantS32Scalar(b), c.ConstantS32Scalar(slots),
+                c.ConstantS32Scalar(m), c.ConstantS32Scalar(n),
+                c.ConstantS32Scalar(lwork), a),
       shape_with_layout=Shape.tuple_shape((
-          Shape.array_shape(dtype, (m, n), (0, 1)),
-          Shape.array_shape(np.dtype(singular_vals_dtype), (min(m, n),), (0,)),
-          Shape.array_shape(dtype, (m, m if full_matrices else min(m, n)), (0, 1)),
-          Shape.array_shape(dtype, (n if full_matrices else min(m, n), n), (0, 1)),
-          Shape.array_shape(np.dtype(np.int32), (), ())) + workspace
+          Shape.array_shape(dtype, dims, matrix_layout),
+          Shape.array_shape(np.dtype(singular_vals_dtype),
+                            batch_dims + (min(m, n),), vector_layout),
+          Shape.array_shape(
+            dtype, batch_dims + (m if full_matrices else min(m, n), m),
+            matrix_layout),
+          Shape.array_shape(
+            dtype, batch_dims + (n, n if full_matrices else min(m, n)),
+            matrix_layout),
+          Shape.array_shape(np.dtype(np.int32), batch_dims,
+                            tuple(range(num_bd - 1, -1, -1)))) + workspace +
+          (Shape.array_shape(dtype, (slots * lwork,), (0,)),)
       ),
       operand_shapes_with_layout=(
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
-          Shape.array_shape(dtype, (m, n), (0, 1)),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, matrix_layout),
       ))
-  return (c.GetTupleElement(out, 1), c.GetTupleElement(out, 2),
-          c.GetTupleElement(out, 3), c.GetTupleElement(out, 4))
+  return (c.GetTupleElement(out, 1), c.GetTupleElement(out, 3),
+          c.GetTupleElement(out, 2), c.GetTupleElement(out, 4))
 
 def jax_gesdd(c, a, full_matrices=True, compute_uv=True):
   return c.Tuple(*gesdd(c, a, full_matrices, compute_uv))
@@ -735,142 +4100,213 @@ def jax_gesdd(c, a, full_matrices=True, compute_uv=True):
 
 # syevd: Symmetric eigendecomposition
 
-# Workspace sizes, taken from the LAPACK documentation.
-cdef int syevd_work_size(int n) nogil:
+# Workspace sizes, taken from the LAPACK documentation. Without eigenvectors
+# (jobz='N') the workspaces are linear in n.
+cdef int syevd_work_size(int n, bint compute_vectors) noexcept nogil:
+  if not compute_vectors:
+    return 1 + 2 * n
   return 1 + 6 * n + 2 * n * n
 
-cdef int syevd_iwork_size(int n) nogil:
+cdef int syevd_iwork_size(int n, bint compute_vectors) noexcept nogil:
+  if not compute_vectors:
+    return 1
   return 3 + 5 * n
 
-cdef void lapack_ssyevd(void* out_tuple, void** data) nogil:
+# Without eigenvectors only the tridiagonal reduction is left.
+cdef double syevd_flops(int n, bint compute_vectors) noexcept nogil:
+  if not compute_vectors:
+    return 4. * n * n * n / 3
+  return 9. * n * n * n
+
+# Tridiagonal reduction dominates; back-transforming k eigenvectors adds
+# 2 n^2 k.
+cdef double syevr_flops(int n, int k) noexcept nogil:
+  return 4. * n * n * n / 3 + 2. * n * n * k
+
+cdef void lapack_ssyevd_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int32_t lower = (<int32_t*>(data[0]))[0]
-  cdef int b = (<int32_t*>(data[1]))[0]
-  cdef int n = (<int32_t*>(data[2]))[0]
-  cdef const float* a_in = <float*>(data[3])
+  cdef int32_t compute_vectors = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[4]))[0]
+  cdef const float* a_in = <float*>(data[5]) + begin * n * n
   cdef void** out = <void**>(out_tuple)
-  cdef float* a_out = <float*>(out[0])
-  cdef float* w_out = <float*>(out[1])
-  cdef int* info_out = <int*>(out[2])
+  cdef float* a_out = <float*>(out[0]) + begin * n * n
+  cdef float* w_out = <float*>(out[1]) + begin * n
+  cdef int* info_out = <int*>(out[2]) + begin
   cdef float* work = <float*>(out[3])
   cdef int* iwork = <int*>(out[4])
   if a_out != a_in:
-    memcpy(a_out, a_in, b * n * n * sizeof(float))
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(float))
 
-  cdef char jobz = 'V'
+  cdef char jobz = 'V' if compute_vectors else 'N'
   cdef char uplo = 'L' if lower else 'U'
 
-  cdef int lwork = syevd_work_size(n)
-  cdef int liwork = syevd_iwork_size(n)
-  for i in range(b):
+  cdef int lwork = syevd_work_size(n, compute_vectors)
+  cdef int liwork = syevd_iwork_size(n, compute_vectors)
+  work += slot * lwork
+  iwork += slot * liwork
+  for _ in range(begin, end):
     ssyevd(&jobz, &uplo, &n, a_out, &n, w_out, work, &lwork, iwork, &liwork,
            info_out)
     a_out += n * n
     w_out += n
     info_out += 1
 
+cdef void lapack_ssyevd(void* out_tuple, void** data) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[1]))[0]
+  cdef int b = (<int32_t*>(data[2]))[0]
+  cdef int slots = (<int32_t*>(data[3]))[0]
+  cdef int n = (<int32_t*>(data[4]))[0]
+  parallel_batch(lapack_ssyevd_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, syevd_flops(n, compute_vectors))))
+
 register_cpu_custom_call_target(b"lapack_ssyevd", <void*>(lapack_ssyevd))
 
-cdef void lapack_dsyevd(void* out_tuple, void** data) nogil:
+cdef void lapack_dsyevd_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int32_t lower = (<int32_t*>(data[0]))[0]
-  cdef int b = (<int32_t*>(data[1]))[0]
-  cdef int n = (<int32_t*>(data[2]))[0]
-  cdef const double* a_in = <double*>(data[3])
+  cdef int32_t compute_vectors = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[4]))[0]
+  cdef const double* a_in = <double*>(data[5]) + begin * n * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef double* a_out = <double*>(out[0])
-  cdef double* w_out = <double*>(out[1])
-  cdef int* info_out = <int*>(out[2])
+  cdef double* a_out = <double*>(out[0]) + begin * n * n
+  cdef double* w_out = <double*>(out[1]) + begin * n
+  cdef int* info_out = <int*>(out[2]) + begin
   cdef double* work = <double*>(out[3])
   cdef int* iwork = <int*>(out[4])
   if a_out != a_in:
-    memcpy(a_out, a_in, b * n * n * sizeof(double))
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double))
 
-  cdef char jobz = 'V'
+  cdef char jobz = 'V' if compute_vectors else 'N'
   cdef char uplo = 'L' if lower else 'U'
 
-  cdef int lwork = syevd_work_size(n)
-  cdef int liwork = syevd_iwork_size(n)
-  for i in range(b):
+  cdef int lwork = syevd_work_size(n, compute_vectors)
+  cdef int liwork = syevd_iwork_size(n, compute_vectors)
+  work += slot * lwork
+  iwork += slot * liwork
+  for _ in range(begin, end):
     dsyevd(&jobz, &uplo, &n, a_out, &n, w_out, work, &lwork, iwork, &liwork,
            info_out)
     a_out += n * n
     w_out += n
     info_out += 1
 
+cdef void lapack_dsyevd(void* out_tuple, void** data) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[1]))[0]
+  cdef int b = (<int32_t*>(data[2]))[0]
+  cdef int slots = (<int32_t*>(data[3]))[0]
+  cdef int n = (<int32_t*>(data[4]))[0]
+  parallel_batch(lapack_dsyevd_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, syevd_flops(n, compute_vectors))))
+
 register_cpu_custom_call_target(b"lapack_dsyevd", <void*>(lapack_dsyevd))
 
 # Workspace sizes, taken from the LAPACK documentation.
-cdef int heevd_work_size(int n) nogil:
+cdef int heevd_work_size(int n, bint compute_vectors) noexcept nogil:
+  if not compute_vectors:
+    return 1 + n
   return 1 + 2 * n + n * n
 
-cdef int heevd_rwork_size(int n) nogil:
+cdef int heevd_rwork_size(int n, bint compute_vectors) noexcept nogil:
+  if not compute_vectors:
+    return max(n, 1)
   return 1 + 5 * n + 2 * n * n
 
 
-cdef void lapack_cheevd(void* out_tuple, void** data) nogil:
+cdef void lapack_cheevd_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int32_t lower = (<int32_t*>(data[0]))[0]
-  cdef int b = (<int32_t*>(data[1]))[0]
-  cdef int n = (<int32_t*>(data[2]))[0]
-  cdef const float complex* a_in = <float complex*>(data[3])
+  cdef int32_t compute_vectors = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[4]))[0]
+  cdef const float complex* a_in = <float complex*>(data[5]) + begin * n * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef float complex* a_out = <float complex*>(out[0])
-  cdef float* w_out = <float*>(out[1])
-  cdef int* info_out = <int*>(out[2])
+  cdef float complex* a_out = <float complex*>(out[0]) + begin * n * n
+  cdef float* w_out = <float*>(out[1]) + begin * n
+  cdef int* info_out = <int*>(out[2]) + begin
   cdef float complex* work = <float complex*>(out[3])
   cdef float* rwork = <float*>(out[4])
   cdef int* iwork = <int*>(out[5])
   if a_out != a_in:
-    memcpy(a_out, a_in, b * n * n * sizeof(float complex))
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(float complex))
 
-  cdef char jobz = 'V'
+  cdef char jobz = 'V' if compute_vectors else 'N'
   cdef char uplo = 'L' if lower else 'U'
 
-  cdef int lwork = heevd_work_size(n)
-  cdef int lrwork = heevd_rwork_size(n)
-  cdef int liwork = syevd_iwork_size(n)
-  for i in range(b):
+  cdef int lwork = heevd_work_size(n, compute_vectors)
+  cdef int lrwork = heevd_rwork_size(n, compute_vectors)
+  cdef int liwork = syevd_iwork_size(n, compute_vectors)
+  work += slot * lwork
+  rwork += slot * lrwork
+  iwork += slot * liwork
+  for _ in range(begin, end):
     cheevd(&jobz, &uplo, &n, a_out, &n, w_out, work, &lwork, rwork, &lrwork,
            iwork, &liwork, info_out)
     a_out += n * n
     w_out += n
     info_out += 1
 
+cdef void lapack_cheevd(void* out_tuple, void** data) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[1]))[0]
+  cdef int b = (<int32_t*>(data[2]))[0]
+  cdef int slots = (<int32_t*>(data[3]))[0]
+  cdef int n = (<int32_t*>(data[4]))[0]
+  parallel_batch(lapack_cheevd_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, syevd_flops(n, compute_vectors))))
+
 register_cpu_custom_call_target(b"lapack_cheevd", <void*>(lapack_cheevd))
 
 
-cdef void lapack_zheevd(void* out_tuple, void** data) nogil:
+cdef void lapack_zheevd_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
   cdef int32_t lower = (<int32_t*>(data[0]))[0]
-  cdef int b = (<int32_t*>(data[1]))[0]
-  cdef int n = (<int32_t*>(data[2]))[0]
-  cdef const double complex* a_in = <double complex*>(data[3])
+  cdef int32_t compute_vectors = (<int32_t*>(data[1]))[0]
+  cdef int n = (<int32_t*>(data[4]))[0]
+  cdef const double complex* a_in = <double complex*>(data[5]) + begin * n * n
 
   cdef void** out = <void**>(out_tuple)
-  cdef double complex* a_out = <double complex*>(out[0])
-  cdef double* w_out = <double*>(out[1])
-  cdef int* info_out = <int*>(out[2])
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * n * n
+  cdef double* w_out = <double*>(out[1]) + begin * n
+  cdef int* info_out = <int*>(out[2]) + begin
   cdef double complex* work = <double complex*>(out[3])
   cdef double* rwork = <double*>(out[4])
   cdef int* iwork = <int*>(out[5])
   if a_out != a_in:
-    memcpy(a_out, a_in, b * n * n * sizeof(double complex))
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double complex))
 
-  cdef char jobz = 'V'
+  cdef char jobz = 'V' if compute_vectors else 'N'
   cdef char uplo = 'L' if lower else 'U'
 
-  cdef int lwork = heevd_work_size(n)
-  cdef int lrwork = heevd_rwork_size(n)
-  cdef int liwork = syevd_iwork_size(n)
-  for i in range(b):
+  cdef int lwork = heevd_work_size(n, compute_vectors)
+  cdef int lrwork = heevd_rwork_size(n, compute_vectors)
+  cdef int liwork = syevd_iwork_size(n, compute_vectors)
+  work += slot * lwork
+  rwork += slot * lrwork
+  iwork += slot * liwork
+  for _ in range(begin, end):
     zheevd(&jobz, &uplo, &n, a_out, &n, w_out, work, &lwork, rwork, &lrwork,
            iwork, &liwork, info_out)
     a_out += n * n
     w_out += n
     info_out += 1
 
+cdef void lapack_zheevd(void* out_tuple, void** data) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[1]))[0]
+  cdef int b = (<int32_t*>(data[2]))[0]
+  cdef int slots = (<int32_t*>(data[3]))[0]
+  cdef int n = (<int32_t*>(data[4]))[0]
+  parallel_batch(lapack_zheevd_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, syevd_flops(n, compute_vectors))))
+
 register_cpu_custom_call_target(b"lapack_zheevd", <void*>(lapack_zheevd))
 
-def syevd(c, a, lower=False):
+def syevd(c, a, lower=False, compute_vectors=True):
+  """Returns (v, w, info), or (w, info) if `compute_vectors` is false."""
   assert sizeof(int32_t) == sizeof(int)
 
   a_shape = c.GetShape(a)
@@ -884,43 +4320,65 @@ def syevd(c, a, lower=False):
   b = 1
   for d in batch_dims:
     b *= d
-  layout = (num_bd, num_bd + 1) + tuple(range(num_bd - 1, -1, -1))
+  if compute_vectors:
+    layout = _column_major_layout(num_bd)
+  else:
+    # A row-major `a` reads as A^T = conj(A), whose eigenvalues are those of
+    # `a`, with its triangles swapped.
+    layout = _row_major_layout(num_bd)
+    lower = not lower
+  # Each thread working on the batch needs its own workspace.
+  slots = batch_parallelism(b, syevd_flops(n, compute_vectors))
+
+  liwork = syevd_iwork_size(n, compute_vectors)
 
   if dtype == np.float32:
     fn = b"lapack_ssyevd"
     eigvals_type = np.float32
-    workspace = (Shape.array_shape(dtype, (syevd_work_size(n),), (0,)),
-                 Shape.array_shape(np.dtype(np.int32),
-                                   (syevd_iwork_size(n),), (0,)))
+    workspace = (Shape.array_shape(
+                     dtype, (slots * syevd_work_size(n, compute_vectors),),
+                     (0,)),
+                 Shape.array_shape(np.dtype(np.int32), (slots * liwork,),
+                                   (0,)))
   elif dtype == np.float64:
     fn = b"lapack_dsyevd"
     eigvals_type = np.float64
-    workspace = (Shape.array_shape(dtype, (syevd_work_size(n),), (0,)),
-                 Shape.array_shape(np.dtype(np.int32),
-                                   (syevd_iwork_size(n),), (0,)))
+    workspace = (Shape.array_shape(
+                     dtype, (slots * syevd_work_size(n, compute_vectors),),
+                     (0,)),
+                 Shape.array_shape(np.dtype(np.int32), (slots * liwork,),
+                                   (0,)))
   elif dtype == np.complex64:
     fn = b"lapack_cheevd"
     eigvals_type = np.float32
-    workspace = (Shape.array_shape(dtype, (heevd_work_size(n),), (0,)),
-                 Shape.array_shape(np.dtype(np.float32),
-                                   (heevd_rwork_size(n),), (0,)),
-                 Shape.array_shape(np.dtype(np.int32),
-                                   (syevd_iwork_size(n),), (0,)))
+    workspace = (Shape.array_shape(
+                     dtype, (slots * heevd_work_size(n, compute_vectors),),
+                     (0,)),
+                 Shape.array_shape(
+                     np.dtype(np.float32),
+                     (slots * heevd_rwork_size(n, compute_vectors),), (0,)),
+                 Shape.array_shape(np.dtype(np.int32), (slots * liwork,),
+                                   (0,)))
   elif dtype == np.complex128:
     fn = b"lapack_zheevd"
     eigvals_type = np.float64
-    workspace = (Shape.array_shape(dtype, (heevd_work_size(n),), (0,)),
-                 Shape.array_shape(np.dtype(np.float64),
-                                   (heevd_rwork_size(n),), (0,)),
-                 Shape.array_shape(np.dtype(np.int32),
-                                   (syevd_iwork_size(n),), (0,)))
+    workspace = (Shape.array_shape(
+                     dtype, (slots * heevd_work_size(n, compute_vectors),),
+                     (0,)),
+                 Shape.array_shape(
+                     np.dtype(np.float64),
+                     (slots * heevd_rwork_size(n, compute_vectors),), (0,)),
+                 Shape.array_shape(np.dtype(np.int32), (slots * liwork,),
+                                   (0,)))
   else:
     raise NotImplementedError("Unsupported dtype {}".format(dtype))
 
-  out = c.CustomCall(
-      fn,
+  out = _custom_call(
+      c, fn,
       operands=(c.ConstantS32Scalar(1 if lower else 0),
+                c.ConstantS32Scalar(1 if compute_vectors else 0),
                 c.ConstantS32Scalar(b),
+                c.ConstantS32Scalar(slots),
                 c.ConstantS32Scalar(n),
                 a),
       shape_with_layout=Shape.tuple_shape((
@@ -932,26 +4390,455 @@ def syevd(c, a, lower=False):
           + workspace
       ),
       operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(dtype, dims, layout),
       ))
+  if not compute_vectors:
+    return c.GetTupleElement(out, 1), c.GetTupleElement(out, 2)
   return (c.GetTupleElement(out, 0), c.GetTupleElement(out, 1),
           c.GetTupleElement(out, 2))
 
 def jax_syevd(c, a, lower=False):
   return c.Tuple(*syevd(c, a, lower))
 
+# ?syevr: Symmetric eigendecomposition of a subset of the spectrum, selected
+# by index or by value. The complex variants are ?heevr.
+
+# Returns the optimal (lwork, lrwork, liwork) for ?syevr/?heevr, queried once
+# when the computation is built. lrwork is 0 for real types.
+cdef tuple syevr_work_sizes(dtype, int n):
+  cdef char jobz = 'V'
+  cdef char range_c = 'A'
+  cdef char uplo = 'L'
+  cdef int lda = max(n, 1)
+  cdef int il = 1
+  cdef int iu = 1
+  cdef int m = 0
+  cdef int lwork = -1
+  cdef int lrwork = -1
+  cdef int liwork = -1
+  cdef int iwork = 0
+  cdef int info = 0
+  cdef float svl = 0, svu = 0, sabstol = 0, swork = 0, srwork = 0
+  cdef double dvl = 0, dvu = 0, dabstol = 0, dwork = 0, drwork = 0
+  cdef float complex cwork = 0
+  cdef double complex zwork = 0
+  if dtype == np.float32:
+    ssyevr(&jobz, &range_c, &uplo, &n, NULL, &lda, &svl, &svu, &il, &iu,
+           &sabstol, &m, NULL, NULL, &lda, NULL, &swork, &lwork, &iwork,
+           &liwork, &info)
+    return (max(<int>swork, 1), 0, max(iwork, 1))
+  elif dtype == np.float64:
+    dsyevr(&jobz, &range_c, &uplo, &n, NULL, &lda, &dvl, &dvu, &il, &iu,
+           &dabstol, &m, NULL, NULL, &lda, NULL, &dwork, &lwork, &iwork,
+           &liwork, &info)
+    return (max(<int>dwork, 1), 0, max(iwork, 1))
+  elif dtype == np.complex64:
+    cheevr(&jobz, &range_c, &uplo, &n, NULL, &lda, &svl, &svu, &il, &iu,
+           &sabstol, &m, NULL, NULL, &lda, NULL, &cwork, &lwork, &srwork,
+           &lrwork, &iwork, &liwork, &info)
+    return (max(<int>(cwork.real), 1), max(<int>srwork, 1), max(iwork, 1))
+  elif dtype == np.complex128:
+    zheevr(&jobz, &range_c, &uplo, &n, NULL, &lda, &dvl, &dvu, &il, &iu,
+           &dabstol, &m, NULL, NULL, &lda, NULL, &zwork, &lwork, &drwork,
+           &lrwork, &iwork, &liwork, &info)
+    return (max(<int>(zwork.real), 1), max(<int>drwork, 1), max(iwork, 1))
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+cdef void lapack_ssyevr_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int32_t by_value = (<int32_t*>(data[4]))[0]
+  cdef float vl = (<float*>(data[5]))[0]
+  cdef float vu = (<float*>(data[6]))[0]
+  cdef int il = (<int32_t*>(data[7]))[0]
+  cdef int iu = (<int32_t*>(data[8]))[0]
+  cdef int k = (<int32_t*>(data[9]))[0]
+  cdef int lwork = (<int32_t*>(data[10]))[0]
+  cdef int liwork = (<int32_t*>(data[11]))[0]
+  cdef const float* a_in = <float*>(data[12]) + begin * n * n
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float* a_out = <float*>(out[0]) + begin * n * n
+  cdef float* w_out = <float*>(out[1]) + begin * k
+  cdef float* z_out = <float*>(out[2]) + begin * n * k
+  cdef int* m_out = <int*>(out[3]) + begin
+  cdef int* info_out = <int*>(out[4]) + begin
+  cdef float* w = <float*>(out[5]) + slot * n
+  cdef int* isuppz = <int*>(out[6]) + slot * 2 * n
+  cdef float* work = <float*>(out[7]) + slot * lwork
+  cdef int* iwork = <int*>(out[8]) + slot * liwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(float))
+
+  cdef char jobz = 'V'
+  cdef char range_c = 'V' if by_value else 'I'
+  cdef char uplo = 'L' if lower else 'U'
+  cdef float abstol = 0
+  cdef int ldz = max(n, 1)
+  cdef int found
+  for _ in range(begin, end):
+    ssyevr(&jobz, &range_c, &uplo, &n, a_out, &n, &vl, &vu, &il, &iu, &abstol,
+           m_out, w, z_out, &ldz, isuppz, work, &lwork, iwork, &liwork,
+           info_out)
+    # Pads the outputs past the eigenpairs found with zeros.
+    found = min(max(m_out[0], 0), k) if info_out[0] == 0 else 0
+    memcpy(w_out, w, found * sizeof(float))
+    memset(w_out + found, 0, (k - found) * sizeof(float))
+    memset(z_out + found * n, 0, (k - found) * n * sizeof(float))
+    a_out += n * n
+    w_out += k
+    z_out += n * k
+    m_out += 1
+    info_out += 1
+
+cdef void lapack_ssyevr(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[9]))[0]
+  parallel_batch(lapack_ssyevr_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, syevr_flops(n, k))))
+
+register_cpu_custom_call_target(b"lapack_ssyevr", <void*>(lapack_ssyevr))
+
+cdef void lapack_dsyevr_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int32_t by_value = (<int32_t*>(data[4]))[0]
+  cdef double vl = (<double*>(data[5]))[0]
+  cdef double vu = (<double*>(data[6]))[0]
+  cdef int il = (<int32_t*>(data[7]))[0]
+  cdef int iu = (<int32_t*>(data[8]))[0]
+  cdef int k = (<int32_t*>(data[9]))[0]
+  cdef int lwork = (<int32_t*>(data[10]))[0]
+  cdef int liwork = (<int32_t*>(data[11]))[0]
+  cdef const double* a_in = <double*>(data[12]) + begin * n * n
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double* a_out = <double*>(out[0]) + begin * n * n
+  cdef double* w_out = <double*>(out[1]) + begin * k
+  cdef double* z_out = <double*>(out[2]) + begin * n * k
+  cdef int* m_out = <int*>(out[3]) + begin
+  cdef int* info_out = <int*>(out[4]) + begin
+  cdef double* w = <double*>(out[5]) + slot * n
+  cdef int* isuppz = <int*>(out[6]) + slot * 2 * n
+  cdef double* work = <double*>(out[7]) + slot * lwork
+  cdef int* iwork = <int*>(out[8]) + slot * liwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double))
+
+  cdef char jobz = 'V'
+  cdef char range_c = 'V' if by_value else 'I'
+  cdef char uplo = 'L' if lower else 'U'
+  cdef double abstol = 0
+  cdef int ldz = max(n, 1)
+  cdef int found
+  for _ in range(begin, end):
+    dsyevr(&jobz, &range_c, &uplo, &n, a_out, &n, &vl, &vu, &il, &iu, &abstol,
+           m_out, w, z_out, &ldz, isuppz, work, &lwork, iwork, &liwork,
+           info_out)
+    # Pads the outputs past the eigenpairs found with zeros.
+    found = min(max(m_out[0], 0), k) if info_out[0] == 0 else 0
+    memcpy(w_out, w, found * sizeof(double))
+    memset(w_out + found, 0, (k - found) * sizeof(double))
+    memset(z_out + found * n, 0, (k - found) * n * sizeof(double))
+    a_out += n * n
+    w_out += k
+    z_out += n * k
+    m_out += 1
+    info_out += 1
+
+cdef void lapack_dsyevr(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[9]))[0]
+  parallel_batch(lapack_dsyevr_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, syevr_flops(n, k))))
+
+register_cpu_custom_call_target(b"lapack_dsyevr", <void*>(lapack_dsyevr))
+
+cdef void lapack_cheevr_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int32_t by_value = (<int32_t*>(data[4]))[0]
+  cdef float vl = (<float*>(data[5]))[0]
+  cdef float vu = (<float*>(data[6]))[0]
+  cdef int il = (<int32_t*>(data[7]))[0]
+  cdef int iu = (<int32_t*>(data[8]))[0]
+  cdef int k = (<int32_t*>(data[9]))[0]
+  cdef int lwork = (<int32_t*>(data[10]))[0]
+  cdef int lrwork = (<int32_t*>(data[11]))[0]
+  cdef int liwork = (<int32_t*>(data[12]))[0]
+  cdef const float complex* a_in = <float complex*>(data[13]) + begin * n * n
+
+  cdef void** out = <void**>(out_tuple)
+  cdef float complex* a_out = <float complex*>(out[0]) + begin * n * n
+  cdef float* w_out = <float*>(out[1]) + begin * k
+  cdef float complex* z_out = <float complex*>(out[2]) + begin * n * k
+  cdef int* m_out = <int*>(out[3]) + begin
+  cdef int* info_out = <int*>(out[4]) + begin
+  cdef float* w = <float*>(out[5]) + slot * n
+  cdef int* isuppz = <int*>(out[6]) + slot * 2 * n
+  cdef float complex* work = <float complex*>(out[7]) + slot * lwork
+  cdef float* rwork = <float*>(out[8]) + slot * lrwork
+  cdef int* iwork = <int*>(out[9]) + slot * liwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(float complex))
+
+  cdef char jobz = 'V'
+  cdef char range_c = 'V' if by_value else 'I'
+  cdef char uplo = 'L' if lower else 'U'
+  cdef float abstol = 0
+  cdef int ldz = max(n, 1)
+  cdef int found
+  for _ in range(begin, end):
+    cheevr(&jobz, &range_c, &uplo, &n, a_out, &n, &vl, &vu, &il, &iu, &abstol,
+           m_out, w, z_out, &ldz, isuppz, work, &lwork, rwork, &lrwork, iwork, &liwork,
+           info_out)
+    # Pads the outputs past the eigenpairs found with zeros.
+    found = min(max(m_out[0], 0), k) if info_out[0] == 0 else 0
+    memcpy(w_out, w, found * sizeof(float))
+    memset(w_out + found, 0, (k - found) * sizeof(float))
+    memset(z_out + found * n, 0, (k - found) * n * sizeof(float complex))
+    a_out += n * n
+    w_out += k
+    z_out += n * k
+    m_out += 1
+    info_out += 1
+
+cdef void lapack_cheevr(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[9]))[0]
+  parallel_batch(lapack_cheevr_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, syevr_flops(n, k))))
+
+register_cpu_custom_call_target(b"lapack_cheevr", <void*>(lapack_cheevr))
+
+cdef void lapack_zheevr_range(void* out_tuple, void** data, int begin,
+                              int end, int slot) noexcept nogil:
+  cdef int32_t lower = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int32_t by_value = (<int32_t*>(data[4]))[0]
+  cdef double vl = (<double*>(data[5]))[0]
+  cdef double vu = (<double*>(data[6]))[0]
+  cdef int il = (<int32_t*>(data[7]))[0]
+  cdef int iu = (<int32_t*>(data[8]))[0]
+  cdef int k = (<int32_t*>(data[9]))[0]
+  cdef int lwork = (<int32_t*>(data[10]))[0]
+  cdef int lrwork = (<int32_t*>(data[11]))[0]
+  cdef int liwork = (<int32_t*>(data[12]))[0]
+  cdef const double complex* a_in = <double complex*>(data[13]) + begin * n * n
+
+  cdef void** out = <void**>(out_tuple)
+  cdef double complex* a_out = <double complex*>(out[0]) + begin * n * n
+  cdef double* w_out = <double*>(out[1]) + begin * k
+  cdef double complex* z_out = <double complex*>(out[2]) + begin * n * k
+  cdef int* m_out = <int*>(out[3]) + begin
+  cdef int* info_out = <int*>(out[4]) + begin
+  cdef double* w = <double*>(out[5]) + slot * n
+  cdef int* isuppz = <int*>(out[6]) + slot * 2 * n
+  cdef double complex* work = <double complex*>(out[7]) + slot * lwork
+  cdef double* rwork = <double*>(out[8]) + slot * lrwork
+  cdef int* iwork = <int*>(out[9]) + slot * liwork
+  if a_out != a_in:
+    memcpy(a_out, a_in, (end - begin) * n * n * sizeof(double complex))
+
+  cdef char jobz = 'V'
+  cdef char range_c = 'V' if by_value else 'I'
+  cdef char uplo = 'L' if lower else 'U'
+  cdef double abstol = 0
+  cdef int ldz = max(n, 1)
+  cdef int found
+  for _ in range(begin, end):
+    zheevr(&jobz, &range_c, &uplo, &n, a_out, &n, &vl, &vu, &il, &iu, &abstol,
+           m_out, w, z_out, &ldz, isuppz, work, &lwork, rwork, &lrwork, iwork, &liwork,
+           info_out)
+    # Pads the outputs past the eigenpairs found with zeros.
+    found = min(max(m_out[0], 0), k) if info_out[0] == 0 else 0
+    memcpy(w_out, w, found * sizeof(double))
+    memset(w_out + found, 0, (k - found) * sizeof(double))
+    memset(z_out + found * n, 0, (k - found) * n * sizeof(double complex))
+    a_out += n * n
+    w_out += k
+    z_out += n * k
+    m_out += 1
+    info_out += 1
+
+cdef void lapack_zheevr(void* out_tuple, void** data) noexcept nogil:
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int k = (<int32_t*>(data[9]))[0]
+  parallel_batch(lapack_zheevr_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(b, syevr_flops(n, k))))
+
+register_cpu_custom_call_target(b"lapack_zheevr", <void*>(lapack_zheevr))
+
+def syevr(c, a, lower=False, subset_by_index=None, subset_by_value=None):
+  """Computes selected eigenpairs of the Hermitian matrices `a`.
+
+  Exactly one of `subset_by_index`, a 0-based half-open range (lo, hi) of
+  eigenvalue indices in ascending order, or `subset_by_value`, a half-open
+  interval (vl, vu] of eigenvalues, must be given. Selecting by index returns
+  hi - lo eigenpairs; selecting by value returns n, of which the first `m`
+  are valid and the rest are zero.
+
+  Returns the eigenvectors, of shape batch_dims + (n, k), the eigenvalues,
+  of shape batch_dims + (k,), m and info.
+  """
+  assert sizeof(int32_t) == sizeof(int)
+
+  a_shape = c.GetShape(a)
+  dtype = a_shape.element_type()
+  dims = a_shape.dimensions()
+  assert len(dims) >= 2
+  m, n = dims[-2:]
+  assert m == n
+  batch_dims = tuple(dims[:-2])
+  num_bd = len(batch_dims)
+  b = 1
+  for d in batch_dims:
+    b *= d
+
+  if (subset_by_index is None) == (subset_by_value is None):
+    raise ValueError("syevr needs exactly one of subset_by_index and "
+                     "subset_by_value")
+  if subset_by_index is not None:
+    lo, hi = subset_by_index
+    if not 0 <= lo < hi <= n:
+      raise ValueError("Invalid eigenvalue index range {} for a matrix of "
+                       "size {}".format(subset_by_index, n))
+    by_value, vl, vu, il, iu, k = False, 0, 0, lo + 1, hi, hi - lo
+  else:
+    vl, vu = subset_by_value
+    by_value, il, iu, k = True, 1, 1, n
+
+  if dtype == np.float32:
+    fn = b"lapack_ssyevr"
+    eigvals_type = np.dtype(np.float32)
+  elif dtype == np.float64:
+    fn = b"lapack_dsyevr"
+    eigvals_type = np.dtype(np.float64)
+  elif dtype == np.complex64:
+    fn = b"lapack_cheevr"
+    eigvals_type = np.dtype(np.float32)
+  elif dtype == np.complex128:
+    fn = b"lapack_zheevr"
+    eigvals_type = np.dtype(np.float64)
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+
+  # Each thread working on the batch needs its own workspace.
+  slots = batch_parallelism(b, syevr_flops(n, k))
+  lwork, lrwork, liwork = syevr_work_sizes(dtype, n)
+  workspace = (
+      Shape.array_shape(eigvals_type, (slots * n,), (0,)),
+      Shape.array_shape(np.dtype(np.int32), (slots * 2 * n,), (0,)),
+      Shape.array_shape(dtype, (slots * lwork,), (0,)))
+  operands = (c.ConstantS32Scalar(int(lower)), c.ConstantS32Scalar(b),
+              c.ConstantS32Scalar(slots), c.ConstantS32Scalar(n),
+              c.ConstantS32Scalar(int(by_value)),
+              c.Constant(np.array(vl, dtype=eigvals_type)),
+              c.Constant(np.array(vu, dtype=eigvals_type)),
+              c.ConstantS32Scalar(il), c.ConstantS32Scalar(iu),
+              c.ConstantS32Scalar(k), c.ConstantS32Scalar(lwork))
+  operand_shapes = (
+      (Shape.array_shape(np.dtype(np.int32), (), ()),) * 5 +
+      (Shape.array_shape(eigvals_type, (), ()),) * 2 +
+      (Shape.array_shape(np.dtype(np.int32), (), ()),) * 4)
+  if lrwork:
+    workspace += (Shape.array_shape(eigvals_type, (slots * lrwork,), (0,)),)
+    operands += (c.ConstantS32Scalar(lrwork),)
+    operand_shapes += (Shape.array_shape(np.dtype(np.int32), (), ()),)
+  workspace += (Shape.array_shape(np.dtype(np.int32), (slots * liwork,),
+                                  (0,)),)
+  operands += (c.ConstantS32Scalar(liwork), a)
+
+  layout = _column_major_layout(num_bd)
+  out = _custom_call(
+      c, fn,
+      operands=operands,
+      shape_with_layout=Shape.tuple_shape((
+          Shape.array_shape(dtype, dims, layout),
+          Shape.array_shape(eigvals_type, batch_dims + (k,),
+                            tuple(range(num_bd, -1, -1))),
+          Shape.array_shape(dtype, batch_dims + (n, k), layout),
+          Shape.array_shape(np.dtype(np.int32), batch_dims,
+                            tuple(range(num_bd - 1, -1, -1))),
+          Shape.array_shape(np.dtype(np.int32), batch_dims,
+                            tuple(range(num_bd - 1, -1, -1))))
+          + workspace
+      ),
+      operand_shapes_with_layout=operand_shapes + (
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(dtype, dims, layout),
+      ))
+  return (c.GetTupleElement(out, 2), c.GetTupleElement(out, 1),
+          c.GetTupleElement(out, 3), c.GetTupleElement(out, 4))
+
+
 
 # geev: Nonsymmetric eigendecomposition
 
+cdef double geev_flops(int n, bint compute_vectors) noexcept nogil:
+  if not compute_vectors:
+    return 10. * n * n * n
+  return 25. * n * n * n
+
+# Returns the optimal size of the ?geev work array, queried once when the
+# computation is built. The complex query writes to rwork, so it gets a real
+# scratch buffer.
+cdef int geev_work_size(dtype, int n, bint compute_vectors) except -1:
+  cdef char jobvlr = 'V' if compute_vectors else 'N'
+  cdef int ldv = n if compute_vectors else 1
+  cdef int lwork = -1
+  cdef int info = 0
+  cdef float swork = 0
+  cdef double dwork = 0
+  cdef float complex cwork = 0
+  cdef double complex zwork = 0
+  cdef float[::1] crwork
+  cdef double[::1] zrwork
+  if dtype == np.float32:
+    sgeev(&jobvlr, &jobvlr, &n, NULL, &n, NULL, NULL, NULL, &ldv, NULL, &ldv,
+          &swork, &lwork, &info)
+    lwork = <int>swork
+  elif dtype == np.float64:
+    dgeev(&jobvlr, &jobvlr, &n, NULL, &n, NULL, NULL, NULL, &ldv, NULL, &ldv,
+          &dwork, &lwork, &info)
+    lwork = <int>dwork
+  elif dtype == np.complex64:
+    crwork = np.empty(2 * n + 1, dtype=np.float32)
+    cgeev(&jobvlr, &jobvlr, &n, NULL, &n, NULL, NULL, &ldv, NULL, &ldv, &cwork,
+          &lwork, &crwork[0], &info)
+    lwork = <int>(cwork.real)
+  elif dtype == np.complex128:
+    zrwork = np.empty(2 * n + 1, dtype=np.float64)
+    zgeev(&jobvlr, &jobvlr, &n, NULL, &n, NULL, NULL, &ldv, NULL, &ldv, &zwork,
+          &lwork, &zrwork[0], &info)
+    lwork = <int>(zwork.real)
+  else:
+    raise NotImplementedError("Unsupported dtype {}".format(dtype))
+  return max(lwork, 1)
+
 # LAPACK uses a packed representation to represent a mixture of real
 # eigenvectors and complex conjugate pairs. This helper unpacks the
 # representation into regular complex matrices.
 cdef void _unpack_float_eigenvectors(
     int n, const float* im_eigenvalues, const float* packed,
-    float complex* unpacked) nogil:
+    float complex* unpacked) noexcept nogil:
   cdef float re, im
   cdef int j, k
   j = 0
@@ -970,51 +4857,66 @@ cdef void _unpack_float_eigenvectors(
         unpacked[(j + 1)*n + k].imag = -im
       j += 2
 
-cdef void lapack_sgeev(void* out_tuple, void** data) nogil:
-  cdef int b = (<int32_t*>(data[0]))[0]
-  cdef int n = (<int32_t*>(data[1]))[0]
-  cdef const float* a_in = <float*>(data[2])
+cdef void lapack_sgeev_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int lwork = (<int32_t*>(data[4]))[0]
+  cdef const float* a_in = <float*>(data[5]) + begin * n * n
 
+  # Without eigenvectors the output tuple omits the two eigenvector
+  # workspaces and the two eigenvector outputs.
+  cdef int skip = 0 if compute_vectors else 2
   cdef void** out = <void**>(out_tuple)
-  cdef float* a_work = <float*>(out[0])
-  cdef float* vl_work = <float*>(out[1])
-  cdef float* vr_work = <float*>(out[2])
-
-  cdef float* wr_out = <float*>(out[3])
-  cdef float* wi_out = <float*>(out[4])
-  cdef float complex* vl_out = <float complex*>(out[5])
-  cdef float complex* vr_out = <float complex*>(out[6])
-  cdef int* info_out = <int*>(out[7])
-
-  cdef char jobvlr = 'V'
-  cdef float work_query
-  cdef int lwork = -1
-  sgeev(&jobvlr, &jobvlr, &n, a_work, &n, wr_out, wi_out, vl_work, &n,
-        vr_work, &n, &work_query, &lwork, info_out)
-  lwork = <int>(work_query)
-  cdef float* work = <float*> malloc(lwork * sizeof(float))
-
-  for i in range(b):
+  cdef float* a_work = <float*>(out[0]) + slot * n * n
+  cdef float* vl_work = NULL
+  cdef float* vr_work = NULL
+  cdef float complex* vl_out = NULL
+  cdef float complex* vr_out = NULL
+  if compute_vectors:
+    vl_work = <float*>(out[1]) + slot * n * n
+    vr_work = <float*>(out[2]) + slot * n * n
+    vl_out = <float complex*>(out[5]) + begin * n * n
+    vr_out = <float complex*>(out[6]) + begin * n * n
+
+  cdef float* wr_out = <float*>(out[3 - skip]) + begin * n
+  cdef float* wi_out = <float*>(out[4 - skip]) + begin * n
+  cdef int* info_out = <int*>(out[7 - 2 * skip]) + begin
+
+  cdef char jobvlr = 'V' if compute_vectors else 'N'
+  cdef int ldv = n if compute_vectors else 1
+  cdef float* work = <float*>(out[8 - 2 * skip]) + slot * lwork
+
+  for _ in range(begin, end):
     memcpy(a_work, a_in, n * n * sizeof(float))
-    sgeev(&jobvlr, &jobvlr, &n, a_work, &n, wr_out, wi_out, vl_work, &n,
-          vr_work, &n, work, &lwork, info_out)
-    _unpack_float_eigenvectors(n, wi_out, vl_work, vl_out)
-    _unpack_float_eigenvectors(n, wi_out, vr_work, vr_out)
+    sgeev(&jobvlr, &jobvlr, &n, a_work, &n, wr_out, wi_out, vl_work, &ldv,
+          vr_work, &ldv, work, &lwork, info_out)
+    if compute_vectors:
+      _unpack_float_eigenvectors(n, wi_out, vl_work, vl_out)
+      _unpack_float_eigenvectors(n, wi_out, vr_work, vr_out)
+      vl_out += n * n
+      vr_out += n * n
 
     a_in += n * n
     wr_out += n
     wi_out += n
-    vl_out += n * n
-    vr_out += n * n
     info_out += 1
-  free(work)
+
+cdef void lapack_sgeev(void* out_tuple, void** data) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[0]))[0]
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_sgeev_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, geev_flops(n, compute_vectors))))
 
 register_cpu_custom_call_target(b"lapack_sgeev", <void*>(lapack_sgeev))
 
 
 cdef void _unpack_double_eigenvectors(
     int n, const double* im_eigenvalues, const double* packed,
-    double complex* unpacked) nogil:
+    double complex* unpacked) noexcept nogil:
   cdef double re, im
   cdef int j, k
   j = 0
@@ -1033,126 +4935,164 @@ cdef void _unpack_double_eigenvectors(
         unpacked[(j + 1)*n + k].imag = -im
       j += 2
 
-cdef void lapack_dgeev(void* out_tuple, void** data) nogil:
-  cdef int b = (<int32_t*>(data[0]))[0]
-  cdef int n = (<int32_t*>(data[1]))[0]
-  cdef const double* a_in = <double*>(data[2])
+cdef void lapack_dgeev_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int lwork = (<int32_t*>(data[4]))[0]
+  cdef const double* a_in = <double*>(data[5]) + begin * n * n
 
+  # Without eigenvectors the output tuple omits the two eigenvector
+  # workspaces and the two eigenvector outputs.
+  cdef int skip = 0 if compute_vectors else 2
   cdef void** out = <void**>(out_tuple)
-  cdef double* a_work = <double*>(out[0])
-  cdef double* vl_work = <double*>(out[1])
-  cdef double* vr_work = <double*>(out[2])
-
-  cdef double* wr_out = <double*>(out[3])
-  cdef double* wi_out = <double*>(out[4])
-  cdef double complex* vl_out = <double complex*>(out[5])
-  cdef double complex* vr_out = <double complex*>(out[6])
-  cdef int* info_out = <int*>(out[7])
-
-  cdef char jobvlr = 'V'
-  cdef double work_query
-  cdef int lwork = -1
-  dgeev(&jobvlr, &jobvlr, &n, a_work, &n, wr_out, wi_out, vl_work, &n,
-        vr_work, &n, &work_query, &lwork, info_out)
-  lwork = <int>(work_query)
-  cdef double* work = <double*> malloc(lwork * sizeof(double))
-
-  for i in range(b):
+  cdef double* a_work = <double*>(out[0]) + slot * n * n
+  cdef double* vl_work = NULL
+  cdef double* vr_work = NULL
+  cdef double complex* vl_out = NULL
+  cdef double complex* vr_out = NULL
+  if compute_vectors:
+    vl_work = <double*>(out[1]) + slot * n * n
+    vr_work = <double*>(out[2]) + slot * n * n
+    vl_out = <double complex*>(out[5]) + begin * n * n
+    vr_out = <double complex*>(out[6]) + begin * n * n
+
+  cdef double* wr_out = <double*>(out[3 - skip]) + begin * n
+  cdef double* wi_out = <double*>(out[4 - skip]) + begin * n
+  cdef int* info_out = <int*>(out[7 - 2 * skip]) + begin
+
+  cdef char jobvlr = 'V' if compute_vectors else 'N'
+  cdef int ldv = n if compute_vectors else 1
+  cdef double* work = <double*>(out[8 - 2 * skip]) + slot * lwork
+
+  for _ in range(begin, end):
     memcpy(a_work, a_in, n * n * sizeof(double))
-    dgeev(&jobvlr, &jobvlr, &n, a_work, &n, wr_out, wi_out, vl_work, &n,
-          vr_work, &n, work, &lwork, info_out)
-    _unpack_double_eigenvectors(n, wi_out, vl_work, vl_out)
-    _unpack_double_eigenvectors(n, wi_out, vr_work, vr_out)
+    dgeev(&jobvlr, &jobvlr, &n, a_work, &n, wr_out, wi_out, vl_work, &ldv,
+          vr_work, &ldv, work, &lwork, info_out)
+    if compute_vectors:
+      _unpack_double_eigenvectors(n, wi_out, vl_work, vl_out)
+      _unpack_double_eigenvectors(n, wi_out, vr_work, vr_out)
+      vl_out += n * n
+      vr_out += n * n
 
     a_in += n * n
     wr_out += n
     wi_out += n
-    vl_out += n * n
-    vr_out += n * n
     info_out += 1
-  free(work)
+
+cdef void lapack_dgeev(void* out_tuple, void** data) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[0]))[0]
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_dgeev_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, geev_flops(n, compute_vectors))))
 
 register_cpu_custom_call_target(b"lapack_dgeev", <void*>(lapack_dgeev))
 
 
-cdef void lapack_cgeev(void* out_tuple, void** data) nogil:
-  cdef int b = (<int32_t*>(data[0]))[0]
-  cdef int n = (<int32_t*>(data[1]))[0]
-  cdef const float complex* a_in = <float complex*>(data[2])
+cdef void lapack_cgeev_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int lwork = (<int32_t*>(data[4]))[0]
+  cdef const float complex* a_in = <float complex*>(data[5]) + begin * n * n
 
+  # Without eigenvectors the output tuple omits the two eigenvector outputs.
+  cdef int skip = 0 if compute_vectors else 2
   cdef void** out = <void**>(out_tuple)
-  cdef float complex* a_work = <float complex*>(out[0])
-  cdef float* r_work = <float*>(out[1])
-
-  cdef float complex* w_out = <float complex*>(out[2])
-  cdef float complex* vl_out = <float complex*>(out[3])
-  cdef float complex* vr_out = <float complex*>(out[4])
-  cdef int* info_out = <int*>(out[5])
-
-  cdef char jobvlr = 'V'
-  cdef float complex work_query
-  cdef int lwork = -1
-  cgeev(&jobvlr, &jobvlr, &n, a_work, &n, w_out, vl_out, &n,
-        vr_out, &n, &work_query, &lwork, r_work, info_out)
-  lwork = <int>(work_query.real)
-  cdef float complex* work = <float complex*>malloc(
-      lwork * sizeof(float complex))
-
-  for i in range(b):
+  cdef float complex* a_work = <float complex*>(out[0]) + slot * n * n
+  cdef float* r_work = <float*>(out[1]) + slot * 2 * n
+
+  cdef float complex* w_out = <float complex*>(out[2]) + begin * n
+  cdef float complex* vl_out = NULL
+  cdef float complex* vr_out = NULL
+  if compute_vectors:
+    vl_out = <float complex*>(out[3]) + begin * n * n
+    vr_out = <float complex*>(out[4]) + begin * n * n
+  cdef int* info_out = <int*>(out[5 - skip]) + begin
+
+  cdef char jobvlr = 'V' if compute_vectors else 'N'
+  cdef int ldv = n if compute_vectors else 1
+  cdef float complex* work = <float complex*>(out[6 - skip]) + slot * lwork
+
+  for _ in range(begin, end):
     memcpy(a_work, a_in, n * n * sizeof(float complex))
-    cgeev(&jobvlr, &jobvlr, &n, a_work, &n, w_out, vl_out, &n, vr_out, &n,
-          work, &lwork, r_work, info_out)
+    cgeev(&jobvlr, &jobvlr, &n, a_work, &n, w_out, vl_out, &ldv, vr_out,
+          &ldv, work, &lwork, r_work, info_out)
+    if compute_vectors:
+      vl_out += n * n
+      vr_out += n * n
 
     a_in += n * n
     w_out += n
-    vl_out += n * n
-    vr_out += n * n
     info_out += 1
-  free(work)
+
+cdef void lapack_cgeev(void* out_tuple, void** data) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[0]))[0]
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_cgeev_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, geev_flops(n, compute_vectors))))
 
 register_cpu_custom_call_target(b"lapack_cgeev", <void*>(lapack_cgeev))
 
 
-cdef void lapack_zgeev(void* out_tuple, void** data) nogil:
-  cdef int b = (<int32_t*>(data[0]))[0]
-  cdef int n = (<int32_t*>(data[1]))[0]
-  cdef const double complex* a_in = <double complex*>(data[2])
+cdef void lapack_zgeev_range(void* out_tuple, void** data, int begin,
+                             int end, int slot) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[0]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  cdef int lwork = (<int32_t*>(data[4]))[0]
+  cdef const double complex* a_in = <double complex*>(data[5]) + begin * n * n
 
+  # Without eigenvectors the output tuple omits the two eigenvector outputs.
+  cdef int skip = 0 if compute_vectors else 2
   cdef void** out = <void**>(out_tuple)
-  cdef double complex* a_work = <double complex*>(out[0])
-  cdef double* r_work = <double*>(out[1])
-
-  cdef double complex* w_out = <double complex*>(out[2])
-  cdef double complex* vl_out = <double complex*>(out[3])
-  cdef double complex* vr_out = <double complex*>(out[4])
-  cdef int* info_out = <int*>(out[5])
-
-  cdef char jobvlr = 'V'
-  cdef double complex work_query
-  cdef int lwork = -1
-  zgeev(&jobvlr, &jobvlr, &n, a_work, &n, w_out, vl_out, &n,
-        vr_out, &n, &work_query, &lwork, r_work, info_out)
-  lwork = <int>(work_query.real)
-  cdef double complex* work = <double complex*>malloc(
-      lwork * sizeof(double complex))
-
-  for i in range(b):
+  cdef double complex* a_work = <double complex*>(out[0]) + slot * n * n
+  cdef double* r_work = <double*>(out[1]) + slot * 2 * n
+
+  cdef double complex* w_out = <double complex*>(out[2]) + begin * n
+  cdef double complex* vl_out = NULL
+  cdef double complex* vr_out = NULL
+  if compute_vectors:
+    vl_out = <double complex*>(out[3]) + begin * n * n
+    vr_out = <double complex*>(out[4]) + begin * n * n
+  cdef int* info_out = <int*>(out[5 - skip]) + begin
+
+  cdef char jobvlr = 'V' if compute_vectors else 'N'
+  cdef int ldv = n if compute_vectors else 1
+  cdef double complex* work = <double complex*>(out[6 - skip]) + slot * lwork
+
+  for _ in range(begin, end):
     memcpy(a_work, a_in, n * n * sizeof(double complex))
-    zgeev(&jobvlr, &jobvlr, &n, a_work, &n, w_out, vl_out, &n, vr_out, &n,
-          work, &lwork, r_work, info_out)
+    zgeev(&jobvlr, &jobvlr, &n, a_work, &n, w_out, vl_out, &ldv, vr_out,
+          &ldv, work, &lwork, r_work, info_out)
+    if compute_vectors:
+      vl_out += n * n
+      vr_out += n * n
 
     a_in += n * n
     w_out += n
-    vl_out += n * n
-    vr_out += n * n
     info_out += 1
-  free(work)
+
+cdef void lapack_zgeev(void* out_tuple, void** data) noexcept nogil:
+  cdef int32_t compute_vectors = (<int32_t*>(data[0]))[0]
+  cdef int b = (<int32_t*>(data[1]))[0]
+  cdef int slots = (<int32_t*>(data[2]))[0]
+  cdef int n = (<int32_t*>(data[3]))[0]
+  parallel_batch(lapack_zgeev_range, out_tuple, data, b,
+                 min(slots, batch_parallelism(
+                     b, geev_flops(n, compute_vectors))))
 
 register_cpu_custom_call_target(b"lapack_zgeev", <void*>(lapack_zgeev))
 
 
 
-def geev(c, a):
+def geev(c, a, compute_vectors=True):
+  """Returns (w, vl, vr, info), or (w, info) if `compute_vectors` is false."""
   assert sizeof(int32_t) == sizeof(int)
 
   a_shape = c.GetShape(a)
@@ -1166,15 +5106,27 @@ def geev(c, a):
   b = 1
   for d in batch_dims:
     b *= d
-  layout = (num_bd, num_bd + 1) + tuple(range(num_bd - 1, -1, -1))
+  # A^T has the same eigenvalues as A, so without eigenvectors a row-major `a`
+  # can be passed as is.
+  if compute_vectors:
+    layout = _column_major_layout(num_bd)
+  else:
+    layout = _row_major_layout(num_bd)
+  # Each thread working on the batch needs its own workspace.
+  slots = batch_parallelism(b, geev_flops(n, compute_vectors))
+  ws_dims = (slots, n, n)
+  ws_layout = (1, 2, 0)
+  lwork = geev_work_size(dtype, n, compute_vectors)
 
   if dtype == np.float32:
     fn = b"lapack_sgeev"
     real = True
     eigvecs_type = np.complex64
-    workspaces = (Shape.array_shape(np.dtype(np.float32), (n, n), (0, 1)),
-                  Shape.array_shape(np.dtype(np.float32), (n, n), (0, 1)),
-                  Shape.array_shape(np.dtype(np.float32), (n, n), (0, 1)))
+    workspaces = (Shape.array_shape(np.dtype(np.float32), ws_dims, ws_layout),)
+    if compute_vectors:
+      workspaces += (
+          Shape.array_shape(np.dtype(np.float32), ws_dims, ws_layout),
+          Shape.array_shape(np.dtype(np.float32), ws_dims, ws_layout))
     eigvals = (Shape.array_shape(np.dtype(np.float32), batch_dims + (n,),
                                  tuple(range(num_bd, -1, -1))),
                Shape.array_shape(np.dtype(np.float32), batch_dims + (n,),
@@ -1183,9 +5135,11 @@ def geev(c, a):
     fn = b"lapack_dgeev"
     real = True
     eigvecs_type = np.complex128
-    workspaces = (Shape.array_shape(np.dtype(np.float64), (n, n), (0, 1)),
-                  Shape.array_shape(np.dtype(np.float64), (n, n), (0, 1)),
-                  Shape.array_shape(np.dtype(np.float64), (n, n), (0, 1)))
+    workspaces = (Shape.array_shape(np.dtype(np.float64), ws_dims, ws_layout),)
+    if compute_vectors:
+      workspaces += (
+          Shape.array_shape(np.dtype(np.float64), ws_dims, ws_layout),
+          Shape.array_shape(np.dtype(np.float64), ws_dims, ws_layout))
     eigvals = (Shape.array_shape(np.dtype(np.float64), batch_dims + (n,),
                                  tuple(range(num_bd, -1, -1))),
                Shape.array_shape(np.dtype(np.float64), batch_dims + (n,),
@@ -1194,42 +5148,59 @@ def geev(c, a):
     fn = b"lapack_cgeev"
     real = False
     eigvecs_type = np.complex64
-    workspaces = (Shape.array_shape(np.dtype(np.complex64), (n, n), (0, 1)),
-                  Shape.array_shape(np.dtype(np.float32), (2 * n,), (0,)))
+    workspaces = (Shape.array_shape(np.dtype(np.complex64), ws_dims, ws_layout),
+                  Shape.array_shape(np.dtype(np.float32), (slots * 2 * n,),
+                                    (0,)))
     eigvals = (Shape.array_shape(np.dtype(np.complex64), batch_dims + (n,),
                                  tuple(range(num_bd, -1, -1))),)
   elif dtype == np.complex128:
     fn = b"lapack_zgeev"
     real = False
     eigvecs_type = np.complex128
-    workspaces = (Shape.array_shape(np.dtype(np.complex128), (n, n), (0, 1)),
-                  Shape.array_shape(np.dtype(np.float64), (2 * n,), (0,)))
+    workspaces = (Shape.array_shape(np.dtype(np.complex128), ws_dims,
+                                    ws_layout),
+                  Shape.array_shape(np.dtype(np.float64), (slots * 2 * n,),
+                                    (0,)))
     eigvals = (Shape.array_shape(np.dtype(np.complex128), batch_dims + (n,),
                                  tuple(range(num_bd, -1, -1))),)
   else:
     raise NotImplementedError("Unsupported dtype {}".format(dtype))
 
-  out = c.CustomCall(
-      fn,
-      operands=(c.ConstantS32Scalar(b), c.ConstantS32Scalar(n), a),
-      shape_with_layout=Shape.tuple_shape(workspaces + eigvals + (
-          Shape.array_shape(np.dtype(eigvecs_type), dims, layout),
-          Shape.array_shape(np.dtype(eigvecs_type), dims, layout),
+  eigvecs = ()
+  if compute_vectors:
+    eigvecs = (Shape.array_shape(np.dtype(eigvecs_type), dims, layout),
+               Shape.array_shape(np.dtype(eigvecs_type), dims, layout))
+
+  out = _custom_call(
+      c, fn,
+      operands=(c.ConstantS32Scalar(1 if compute_vectors else 0),
+                c.ConstantS32Scalar(b), c.ConstantS32Scalar(slots),
+                c.ConstantS32Scalar(n), c.ConstantS32Scalar(lwork), a),
+      shape_with_layout=Shape.tuple_shape(workspaces + eigvals + eigvecs + (
           Shape.array_shape(np.dtype(np.int32), batch_dims,
-                            tuple(range(num_bd - 1, -1, -1))))
+                            tuple(range(num_bd - 1, -1, -1))),
+          Shape.array_shape(dtype, (slots * lwork,), (0,)))
       ),
       operand_shapes_with_layout=(
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
+          Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(np.dtype(np.int32), (), ()),
           Shape.array_shape(dtype, dims, layout),
       ))
+  num_ws = len(workspaces)
   if real:
-    return (c.Complex(c.GetTupleElement(out, 3), c.GetTupleElement(out, 4)),
-            c.GetTupleElement(out, 5), c.GetTupleElement(out, 6),
-            c.GetTupleElement(out, 7))
+    w = c.Complex(c.GetTupleElement(out, num_ws),
+                  c.GetTupleElement(out, num_ws + 1))
+    num_ws += 1
   else:
-    return (c.GetTupleElement(out, 2), c.GetTupleElement(out, 3),
-            c.GetTupleElement(out, 4), c.GetTupleElement(out, 5))
+    w = c.GetTupleElement(out, num_ws)
+  if not compute_vectors:
+    return w, c.GetTupleElement(out, num_ws + 1)
+  return (w, c.GetTupleElement(out, num_ws + 1),
+          c.GetTupleElement(out, num_ws + 2),
+          c.GetTupleElement(out, num_ws + 3))
 
 def jax_geev(c, a):
   return c.Tuple(*geev(c, a))
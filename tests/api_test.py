@@ -18,16 +18,22 @@ from __future__ import print_function
 
 import collections
 from functools import partial
+import gc
+import threading
+import warnings
+import weakref
 
 from absl.testing import absltest
+from absl.testing import flagsaver
 import numpy as onp
 import six
 
 import jax.numpy as np
 from jax import jit, grad, device_get, device_put, jacfwd, jacrev, hessian
+from jax import vmap
 from jax import api, lax
 from jax.core import Primitive, pack, JaxTuple
-from jax.interpreters import ad
+from jax.interpreters import ad, xla
 from jax.interpreters.xla import DeviceArray, DeviceTuple
 from jax.abstract_arrays import concretization_err_msg
 from jax.lib import xla_bridge as xb
@@ -903,6 +909,291 @@ class APITest(jtu.JaxTestCase):
     self.assertIsInstance(x, DeviceArray)
     self.assertEqual(x.device_buffer.device(), device_num)
 
+  def test_lazy_eager(self):
+    x = onp.arange(10.)
+    with api.lazy_eager():
+      y = np.sin(x) * 2. + 1.
+      self.assertIsInstance(y, DeviceArray)
+      z = jit(lambda y: y + 1.)(y)  # forces the pending graph
+      w = np.exp(y)
+      self.assertTrue(bool(np.all(w > 0)))
+    self.assertAllClose(z, onp.sin(x) * 2. + 2., check_dtypes=False)
+    self.assertAllClose(w, onp.exp(onp.sin(x) * 2. + 1.), check_dtypes=False)
+
+  def test_lazy_eager_flushes_at_max_ops(self):
+    x = onp.arange(4., dtype=onp.float32)
+    with flagsaver.flagsaver(jax_lazy_eager_max_ops=3), api.lazy_eager():
+      y = lax.sin(x)
+      z = lax.neg(y)
+      self.assertIsNone(z.device_buffer.buffer)
+      w = lax.exp(z)  # the third application flushes the graph
+      self.assertIsNotNone(y.device_buffer.buffer)
+      self.assertIsNotNone(w.device_buffer.buffer)
+      self.assertEqual(len(xla._lazy_eager_state.graph.eqns), 0)
+    self.assertAllClose(w, onp.exp(-onp.sin(x)), check_dtypes=False)
+
+  def test_lazy_eager_drops_dead_outputs(self):
+    x = onp.arange(4., dtype=onp.float32)
+    lazy_graph_callable = xla._lazy_graph_callable
+    live_outputs = []
+    def spy(eqns, arg_shapes, live):
+      live_outputs.append(live)
+      return lazy_graph_callable(eqns, arg_shapes, live)
+
+    xla._lazy_graph_callable = spy
+    try:
+      with api.lazy_eager():
+        y = lax.sin(x)
+        z = lax.neg(y)
+        del y
+        z = onp.asarray(z)
+    finally:
+      xla._lazy_graph_callable = lazy_graph_callable
+    self.assertEqual(live_outputs, [(1,)])
+    self.assertAllClose(z, -onp.sin(x), check_dtypes=False)
+
+  def test_lazy_eager_reuses_compiled_graph(self):
+    f = lambda x: lax.exp(lax.neg(lax.sin(x)))
+    x = onp.arange(4., dtype=onp.float32)
+    with api.lazy_eager():
+      onp.asarray(f(x))
+      info = xla._lazy_graph_callable.cache_info()
+      y = onp.asarray(f(x + 1))
+      new_info = xla._lazy_graph_callable.cache_info()
+    self.assertEqual(new_info.misses, info.misses)
+    self.assertEqual(new_info.hits, info.hits + 1)
+    self.assertAllClose(y, onp.exp(-onp.sin(x + 1)), check_dtypes=False)
+
+  def test_lazy_eager_tuple_primitives_run_eagerly(self):
+    keys = onp.array([3., 1., 2.], onp.float32)
+    values = onp.arange(3., dtype=onp.float32)
+    with api.lazy_eager():
+      neg_keys = lax.neg(keys)
+      sorted_keys, sorted_values = lax.sort_key_val(neg_keys, values)
+      self.assertNotIsInstance(sorted_keys.device_buffer, xla._LazyBuffer)
+      out = lax.add(sorted_keys, sorted_values)
+      self.assertIsInstance(out.device_buffer, xla._LazyBuffer)
+    self.assertAllClose(out, onp.array([-3., 0., 0.]), check_dtypes=False)
+
+  def test_lazy_eager_threads(self):
+    results = {}
+    def worker(i):
+      y = onp.full(4, i, onp.float32)
+      with api.lazy_eager():
+        for _ in range(50):
+          y = lax.add(y, onp.ones(4, onp.float32))
+        results[i] = onp.asarray(y)
+
+    threads = [threading.Thread(target=worker, args=(i,)) for i in range(4)]
+    for t in threads:
+      t.start()
+    for t in threads:
+      t.join()
+    for i in range(4):
+      self.assertAllClose(results[i], onp.full(4, i + 50.), check_dtypes=False)
+
+  def test_lazy_eager_threads_cross_feed(self):
+    # Each thread feeds the other's pending value into its own graph, then both
+    # force at once. Neither flush may wait on the other graph's lock.
+    x = onp.arange(4., dtype=onp.float32)
+    pending = [None, None]
+    results = [None, None]
+    recorded = [threading.Event(), threading.Event()]
+    mixed = [threading.Event(), threading.Event()]
+    def worker(i):
+      with api.lazy_eager():
+        pending[i] = lax.sin(x + i)
+        recorded[i].set()
+        recorded[1 - i].wait(30)
+        y = lax.add(lax.neg(pending[1 - i]), pending[i])
+        mixed[i].set()
+        mixed[1 - i].wait(30)
+        results[i] = onp.asarray(y)
+
+    threads = [threading.Thread(target=worker, args=(i,)) for i in range(2)]
+    for t in threads:
+      t.daemon = True
+      t.start()
+    for t in threads:
+      t.join(60)
+      self.assertFalse(t.is_alive())
+    for i in range(2):
+      self.assertAllClose(results[i], onp.sin(x + i) - onp.sin(x + 1 - i),
+                          check_dtypes=False)
+
+  def test_cache_traces(self):
+    side_effects = []
+    def f(x):
+      side_effects.append(None)
+      return np.sum(np.sin(x) * x)
+
+    x = onp.arange(3.)
+    with api.cache_traces():
+      hits = api.trace_cache_info().hits
+      ans1 = grad(f)(x)
+      ans2 = grad(f)(x + 1.)
+      self.assertEqual(len(side_effects), 1)
+      self.assertGreater(api.trace_cache_info().hits, hits)
+      ans3 = vmap(grad(f))(onp.stack([x, x + 1.]))
+    self.assertAllClose(ans1, onp.sin(x) + x * onp.cos(x), check_dtypes=False)
+    self.assertAllClose(ans2, onp.sin(x + 1.) + (x + 1.) * onp.cos(x + 1.),
+                        check_dtypes=False)
+    self.assertAllClose(ans3, onp.stack([ans1, ans2]), check_dtypes=False)
+
+  def test_cache_traces_drops_dead_functions(self):
+    def make_f():
+      c = onp.ones(3)
+      return lambda x: np.sum(np.sin(x) * c)
+
+    f = make_f()
+    f_ref = weakref.ref(f)
+    with api.cache_traces():
+      grad(f)(onp.arange(3.))
+      size = api.trace_cache_info().currsize
+      del f
+      gc.collect()
+      self.assertIsNone(f_ref())
+      self.assertLess(api.trace_cache_info().currsize, size)
+
+  def test_cache_traces_falls_back_on_concretization(self):
+    def f(x):
+      return np.sin(x) if x > 0 else np.cos(x)
+
+    with api.cache_traces():
+      ans = grad(f)(2.)
+    self.assertAllClose(ans, onp.cos(2.), check_dtypes=False)
+
+  def test_cache_traces_propagates_errors(self):
+    side_effects = []
+    def f(x):
+      side_effects.append(None)
+      raise ValueError("bug in f")
+
+    with api.cache_traces():
+      jtu.check_raises_regexp(lambda: grad(f)(2.), ValueError, "bug in f")
+      self.assertEqual(len(side_effects), 1)
+      jtu.check_raises_regexp(lambda: grad(f)(2.), ValueError, "bug in f")
+      self.assertEqual(len(side_effects), 2)
+
+  def test_compile_stats(self):
+    def f(x):
+      return x + 1
+
+    jit_f = jit(f)
+    jit_f(1.)
+    jit_f(onp.ones(3))
+    jit_f(onp.ones(3) * 2)
+    stats = xla.compile_stats()[f]
+    self.assertEqual(stats.name, 'f')
+    self.assertEqual(len(stats.events), 2)
+    self.assertEqual(len(stats.signatures), 2)
+    self.assertIsNone(stats.events[0].num_hlo_instructions)
+
+    with flagsaver.flagsaver(jax_compile_stats_hlo_sizes=True):
+      jit_f(onp.ones(4))
+    event = stats.events[-1]
+    self.assertGreater(event.num_hlo_instructions, 0)
+    self.assertGreater(event.hlo_proto_bytes, 0)
+
+  def test_recompilation_warning(self):
+    def f(x):
+      return x + 1
+
+    jit_f = jit(f)
+    with flagsaver.flagsaver(jax_recompilation_warning_threshold=2):
+      with warnings.catch_warnings(record=True) as caught:
+        warnings.simplefilter("always")
+        for n in range(1, 5):
+          jit_f(onp.ones(n))
+          jit_f(onp.ones(n))
+          lax.neg(onp.ones(n + 10, onp.float32))
+    msgs = [str(w.message) for w in caught]
+    self.assertEqual(len(msgs), 1)
+    self.assertIn("f has been compiled for 3 different argument signatures",
+                  msgs[0])
+
+  def test_memory_accounting_live_and_peak_bytes(self):
+    with flagsaver.flagsaver(jax_memory_accounting=True):
+      xla.reset_peak_device_memory()
+      before = xla.device_memory_snapshot()
+      x = device_put(onp.ones(100, onp.float32))
+      y = device_put(onp.ones(50, onp.float32))
+      during = xla.device_memory_snapshot()
+      del y
+      after = xla.device_memory_snapshot()
+
+    device = x.device_buffer.device()
+    base = before.bytes_in_use.get(device, 0)
+    self.assertEqual(during.bytes_in_use[device], base + 600)
+    self.assertEqual(after.bytes_in_use[device], base + 400)
+    self.assertEqual(after.peak_bytes_in_use[device], base + 600)
+    x.delete()
+    self.assertEqual(xla.device_memory_snapshot().bytes_in_use[device], base)
+
+  def test_memory_accounting_snapshot_diff(self):
+    with flagsaver.flagsaver(jax_memory_accounting=True):
+      x = device_put(onp.ones(10, onp.float32))
+      before = xla.device_memory_snapshot()
+      y = device_put(onp.ones(20, onp.float32))
+      del x
+      diff = xla.device_memory_snapshot_diff(
+          before, xla.device_memory_snapshot())
+
+    self.assertEqual([entry.nbytes for entry in diff.buffers.values()], [80])
+    self.assertEqual(diff.bytes_in_use[y.device_buffer.device()], 40)
+
+  def test_memory_accounting_call_site_sampling(self):
+    with flagsaver.flagsaver(jax_memory_accounting=True,
+                             jax_memory_call_site_sampling=1):
+      before = xla.device_memory_snapshot()
+      x = device_put(onp.ones(10, onp.float32))
+      diff = xla.device_memory_snapshot_diff(
+          before, xla.device_memory_snapshot())
+
+    entry, = diff.buffers.values()
+    self.assertIn("api_test.py", entry.call_site)
+    self.assertIn("test_memory_accounting_call_site_sampling", entry.call_site)
+
+  def test_memory_accounting_counts_tuple_buffers_once(self):
+    with flagsaver.flagsaver(jax_memory_accounting=True):
+      before = xla.device_memory_snapshot()
+      tup = device_put(pack((onp.ones(10, onp.float32),
+                             pack((onp.ones(20, onp.float32),)))))
+      self.assertIsInstance(tup, DeviceTuple)
+      x, (y,) = tup
+      x, (y,) = tup
+      diff = xla.device_memory_snapshot_diff(
+          before, xla.device_memory_snapshot())
+      self.assertEqual(sorted(e.nbytes for e in diff.buffers.values()),
+                       [40, 80])
+      self.assertEqual(sum(diff.bytes_in_use.values()), 120)
+
+      del tup
+      diff = xla.device_memory_snapshot_diff(
+          before, xla.device_memory_snapshot())
+      self.assertEqual(sum(diff.bytes_in_use.values()), 120)
+
+      del x
+      diff = xla.device_memory_snapshot_diff(
+          before, xla.device_memory_snapshot())
+      self.assertEqual(sum(diff.bytes_in_use.values()), 80)
+
+  def test_memory_accounting_lazy_buffers_tracked_when_forced(self):
+    x = onp.ones(10, onp.float32)
+    with flagsaver.flagsaver(jax_memory_accounting=True), api.lazy_eager():
+      before = xla.device_memory_snapshot()
+      y = lax.neg(lax.sin(x))
+      pending = xla.device_memory_snapshot_diff(
+          before, xla.device_memory_snapshot())
+      self.assertEqual(pending.buffers, {})
+      onp.asarray(y)
+      forced = xla.device_memory_snapshot_diff(
+          before, xla.device_memory_snapshot())
+
+    entry, = forced.buffers.values()
+    self.assertEqual(entry.nbytes, 40)
+    self.assertEqual(entry.device, y.device_buffer.device())
+
   def test_jit_of_noncallable(self):
     jtu.check_raises_regexp(lambda: api.jit(3), TypeError,
                             "Expected a callable value.*")
@@ -636,6 +636,14 @@ class BatchingTest(jtu.JaxTestCase):
       [lax_linalg.triangular_solve(a[:, 0], b[..., i]) for i in range(10)])
     self.assertAllClose(ans, expected, check_dtypes=True)
 
+    b_left = onp.swapaxes(b, 0, 1)  # shape is (4, 5, 10)
+    solve_left = partial(lax_linalg.triangular_solve, left_side=True,
+                         lower=True)
+    ans = vmap(solve_left, in_axes=(None, 2))(a[:, 0], b_left)
+    expected = onp.stack(
+      [solve_left(a[:, 0], b_left[..., i]) for i in range(10)])
+    self.assertAllClose(ans, expected, check_dtypes=True)
+
     ans = vmap(lax_linalg.triangular_solve, in_axes=(1, None))(a, b[..., 0])
     expected = onp.stack(
       [lax_linalg.triangular_solve(a[:, i], b[..., 0]) for i in range(10)])
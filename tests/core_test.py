@@ -18,6 +18,7 @@ from __future__ import print_function
 
 import operator
 from collections import namedtuple
+import weakref
 from unittest import skip
 
 import numpy as onp
@@ -334,6 +335,31 @@ class CoreTest(jtu.JaxTestCase):
     assert d2_sin(0.0) == 0.0
     assert d3_sin(0.0) == -1.0
 
+  def test_eval_jaxpr_releases_intermediates(self):
+    # `record` makes a fresh intermediate and keeps a weak reference to it;
+    # `probe`, which runs after its last use, checks that it has been freed.
+    refs, freed = [], []
+    def record_impl(x):
+      out = onp.array(x)
+      refs.append(weakref.ref(out))
+      return out
+    def probe_impl(x):
+      freed.append(refs[0]() is None)
+      return x
+    record_p = core.Primitive('record')
+    record_p.def_impl(record_impl)
+    record_p.def_abstract_eval(lambda x: x)
+    probe_p = core.Primitive('probe')
+    probe_p.def_impl(probe_impl)
+    probe_p.def_abstract_eval(lambda x: x)
+
+    def f(x):
+      return probe_p.bind(np.sin(record_p.bind(x)))
+    jaxpr, consts, _, _ = api.trace_to_jaxpr(f, (__,))
+    ans = core.eval_jaxpr(jaxpr, consts, (), onp.float32(1.))
+    self.assertAllClose(ans, onp.sin(1.), check_dtypes=False)
+    self.assertEqual(freed, [True])
+
 
 if __name__ == '__main__':
   absltest.main()
@@ -36,6 +36,7 @@ from jax import test_util as jtu
 from jax import lax_reference
 from jax.test_util import check_grads
 from jax.interpreters import xla
+from jax.lib import lapack
 from jax.lib import xla_bridge
 from jax.lib import xla_client
 
@@ -676,6 +677,9 @@ class LaxTest(jtu.JaxTestCase):
       for lhs_shape, rhs_shape, dimension_numbers in [
           ((3, 3, 2), (3, 2, 4), (([2], [1]), ([0], [0]))),
           ((3, 4, 2, 4), (3, 4, 3, 2), (([2], [3]), ([0, 1], [0, 1]))),
+          ((32, 4, 4), (32, 4, 4), (([2], [1]), ([0], [0]))),
+          ((32, 3, 5), (32, 4, 3), (([1], [2]), ([0], [0]))),
+          ((4, 8, 2, 3), (4, 8, 2, 5), (([2], [2]), ([0, 1], [0, 1]))),
       ]
       for dtype in default_dtypes
       for rng in [jtu.rand_small()]))
@@ -686,6 +690,31 @@ class LaxTest(jtu.JaxTestCase):
     numpy_op = lambda x, y: lax_reference.dot_general(x, y, dimension_numbers)
     self._CheckAgainstNumpy(op, numpy_op, args_maker)
 
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_dtype={}_trans_a={}_trans_b={}".format(
+          onp.dtype(dtype).name, trans_a, trans_b),
+       "dtype": dtype, "trans_a": trans_a, "trans_b": trans_b,
+       "rng": jtu.rand_small()}
+      for dtype in inexact_dtypes
+      for trans_a in [False, True]
+      for trans_b in [False, True]))
+  @jtu.skip_on_devices("gpu", "tpu")
+  def testDotGeneralUsesBatchedGemmOnCpu(self, dtype, trans_a, trans_b, rng):
+    if not hasattr(lapack, "gemm_batched"):
+      raise SkipTest("jaxlib has no batched GEMM custom call")
+    batch, m, k, n = 32, 3, 4, 5
+    lhs_shape = (batch, k, m) if trans_a else (batch, m, k)
+    rhs_shape = (batch, n, k) if trans_b else (batch, k, n)
+    dimension_numbers = (([1 if trans_a else 2], [2 if trans_b else 1]),
+                         ([0], [0]))
+    op = lambda x, y: lax.dot_general(x, y, dimension_numbers)
+    lhs, rhs = rng(lhs_shape, dtype), rng(rhs_shape, dtype)
+
+    hlo = api.xla_computation(op)(lhs, rhs).GetHloText()
+    self.assertIn("blas_", hlo)
+    numpy_op = lambda x, y: lax_reference.dot_general(x, y, dimension_numbers)
+    self._CheckAgainstNumpy(op, numpy_op, lambda: [lhs, rhs])
+
   @parameterized.named_parameters(jtu.cases_from_list(
       {"testcase_name": "_shape={}_dtype={}_broadcast_sizes={}".format(
           shape, onp.dtype(dtype).name, broadcast_sizes),
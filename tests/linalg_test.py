@@ -27,7 +27,9 @@ import scipy as osp
 from absl.testing import absltest
 from absl.testing import parameterized
 
+from jax import api
 from jax import jit, grad, jvp, vmap
+from jax import lax_linalg
 from jax import numpy as np
 from jax import scipy as jsp
 from jax import test_util as jtu
@@ -59,7 +61,8 @@ class NumpyLinalgTest(jtu.JaxTestCase):
       {"testcase_name":
        "_shape={}".format(jtu.format_shape_dtype_string(shape, dtype)),
        "shape": shape, "dtype": dtype, "rng": rng}
-      for shape in [(1, 1), (4, 4), (2, 5, 5), (200, 200), (1000, 0, 0)]
+      for shape in [(1, 1), (4, 4), (2, 5, 5), (200, 200), (1000, 0, 0),
+                    (20, 3, 3)]
       for dtype in float_types + complex_types
       for rng in [jtu.rand_default()]))
   def testCholesky(self, shape, dtype, rng):
@@ -80,6 +83,15 @@ class NumpyLinalgTest(jtu.JaxTestCase):
     if onp.finfo(dtype).bits == 64:
       jtu.check_grads(np.linalg.cholesky, args_maker(), order=2)
 
+  @jtu.skip_on_devices("gpu", "tpu")
+  def testCholeskyOfNonPositiveDefiniteReturnsNans(self):
+    a = onp.stack([onp.eye(3), onp.zeros((3, 3)), -onp.eye(3)]).astype(
+        onp.float32)
+    l = onp.asarray(np.linalg.cholesky(a))
+    self.assertAllClose(l[0], onp.eye(3), check_dtypes=False)
+    rows, cols = onp.tril_indices(3)
+    self.assertTrue(onp.all(onp.isnan(l[1:, rows, cols])))
+
   @parameterized.named_parameters(jtu.cases_from_list(
       {"testcase_name":
        "_n={}".format(jtu.format_shape_dtype_string((n,n), dtype)),
@@ -153,6 +165,40 @@ class NumpyLinalgTest(jtu.JaxTestCase):
     self.assertTrue(onp.all(onp.linalg.norm(
         onp.matmul(args, vs) - ws[..., None, :] * vs) < 1e-3))
 
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_shape={}".format(
+           jtu.format_shape_dtype_string(shape, dtype)),
+       "shape": shape, "dtype": dtype, "rng": rng}
+      for shape in [(4, 4), (5, 5), (50, 50), (2, 6, 6)]
+      for dtype in float_types + complex_types
+      for rng in [jtu.rand_default()]))
+  @jtu.skip_on_devices("gpu", "tpu")
+  def testEigvals(self, shape, dtype, rng):
+    _skip_if_unsupported_type(dtype)
+    args_maker = lambda: [rng(shape, dtype)]
+    a, = args_maker()
+    w1, _ = np.linalg.eig(a)
+    w2 = np.linalg.eigvals(a)
+    self.assertAllClose(onp.sort_complex(w1), onp.sort_complex(w2),
+                        check_dtypes=True, rtol=1e-3)
+    ws = vmap(np.linalg.eigvals)(a[None, ...])
+    self.assertAllClose(w2, ws[0], check_dtypes=True)
+    self._CompileAndCheck(np.linalg.eigvals, args_maker, check_dtypes=True,
+                          rtol=1e-3)
+
+  @jtu.skip_on_devices("gpu", "tpu")
+  def testEigvalsWithoutVectorlessGeev(self):
+    # Jaxlibs without a batched geev compute eigvals via eig_p instead.
+    a = jtu.rand_default()((2, 5, 5), onp.float32)
+    batched_lapack = lax_linalg._cpu_batched_lapack
+    lax_linalg._cpu_batched_lapack = False
+    try:
+      w1 = jit(lambda x: np.linalg.eigvals(x))(a)
+    finally:
+      lax_linalg._cpu_batched_lapack = batched_lapack
+    w2, _ = np.linalg.eig(a)
+    self.assertAllClose(w1, w2, check_dtypes=True)
+
   @parameterized.named_parameters(jtu.cases_from_list(
       {"testcase_name": "_n={}_lower={}".format(
            jtu.format_shape_dtype_string((n,n), dtype), lower),
@@ -272,6 +318,68 @@ class NumpyLinalgTest(jtu.JaxTestCase):
     self.assertTrue(onp.all(onp.linalg.norm(
         onp.matmul(args, vs) - ws[..., None, :] * vs) < 1e-3))
 
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_shape={}_lower={}".format(
+           jtu.format_shape_dtype_string(shape, dtype), lower),
+       "shape": shape, "dtype": dtype, "lower": lower, "rng": rng}
+      for shape in [(4, 4), (5, 5), (50, 50), (3, 6, 6)]
+      for dtype in float_types + complex_types
+      for lower in [False, True]
+      for rng in [jtu.rand_default()]))
+  @jtu.skip_on_devices("tpu")
+  def testEigvalsh(self, shape, dtype, lower, rng):
+    _skip_if_unsupported_type(dtype)
+    uplo = "L" if lower else "U"
+    def args_maker():
+      a = rng(shape, dtype)
+      return [(a + onp.conj(T(a))) / 2]
+
+    self._CheckAgainstNumpy(partial(onp.linalg.eigvalsh, UPLO=uplo),
+                            partial(np.linalg.eigvalsh, UPLO=uplo), args_maker,
+                            check_dtypes=True, tol=1e-3)
+    self._CompileAndCheck(partial(np.linalg.eigvalsh, UPLO=uplo), args_maker,
+                          check_dtypes=True, rtol=1e-3)
+    a, = args_maker()
+    w = jsp.linalg.eigh(a, lower=lower, eigvals_only=True)
+    self.assertAllClose(onp.linalg.eigvalsh(a), w, check_dtypes=False,
+                        rtol=1e-3)
+    if shape in [(4, 4), (5, 5)] and dtype in float_types:
+      jtu.check_grads(partial(np.linalg.eigvalsh, UPLO=uplo), (a,), 1,
+                      rtol=1e-1)
+
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_shape={}_eigvals={}".format(
+           jtu.format_shape_dtype_string(shape, dtype), eigvals),
+       "shape": shape, "dtype": dtype, "eigvals": eigvals, "rng": rng}
+      for shape, eigvals in [((4, 4), (0, 3)), ((6, 6), (4, 5)),
+                             ((50, 50), (40, 49)), ((3, 8, 8), (0, 1))]
+      for dtype in float_types + complex_types
+      for rng in [jtu.rand_default()]))
+  @jtu.skip_on_devices("tpu")
+  def testEighSubset(self, shape, dtype, eigvals, rng):
+    _skip_if_unsupported_type(dtype)
+    n = shape[-1]
+    lo, hi = eigvals
+    a = rng(shape, dtype)
+    a = (a + onp.conj(T(a))) / 2
+
+    # Norm, adjusted for dimension and type.
+    def norm(x):
+      norm = onp.linalg.norm(x, axis=(-2, -1))
+      return norm / ((n + 1) * onp.finfo(dtype).eps)
+
+    w, v = jsp.linalg.eigh(a, eigvals=eigvals)
+    self.assertEqual(w.shape, shape[:-2] + (hi - lo + 1,))
+    self.assertEqual(v.shape, shape[:-1] + (hi - lo + 1,))
+    self.assertAllClose(onp.linalg.eigvalsh(a)[..., lo:hi + 1], w,
+                        check_dtypes=False, atol=1e-3, rtol=1e-3)
+    self.assertTrue(onp.all(norm(onp.matmul(a, v) - w[..., None, :] * v) < 30))
+
+    ws, vs = vmap(partial(jsp.linalg.eigh, eigvals=eigvals))(
+        a.reshape((-1, n, n)))
+    self.assertAllClose(w.reshape(ws.shape), ws, check_dtypes=True,
+                        atol=1e-3, rtol=1e-3)
+
   @parameterized.named_parameters(jtu.cases_from_list(
       {"testcase_name": "_shape={}_ord={}_axis={}_keepdims={}".format(
          jtu.format_shape_dtype_string(shape, dtype), ord, axis, keepdims),
@@ -359,16 +467,38 @@ class NumpyLinalgTest(jtu.JaxTestCase):
       svd = partial(np.linalg.svd, full_matrices=False)
       jtu.check_jvp(svd, partial(jvp, svd), (a,), atol=1e-1 if FLAGS.jax_enable_x64 else jtu.ATOL)
 
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_shape={}_full_matrices={}".format(
+          jtu.format_shape_dtype_string(shape, dtype), full_matrices),
+       "shape": shape, "dtype": dtype, "full_matrices": full_matrices,
+       "rng": rng}
+      for shape in [(3, 4, 5), (2, 3, 7, 2)]
+      for dtype in float_types + complex_types
+      for full_matrices in [False, True]
+      for rng in [jtu.rand_default()]))
+  @jtu.skip_on_devices("gpu", "tpu")
+  def testBatchedSVD(self, shape, dtype, full_matrices, rng):
+    _skip_if_unsupported_type(dtype)
+    args_maker = lambda: [rng(shape, dtype)]
+    a, = args_maker()
+    u, s, vt = np.linalg.svd(a, full_matrices=full_matrices)
+    k = min(shape[-2:])
+    recon = onp.matmul(u[..., :k] * s[..., None, :], vt[..., :k, :])
+    self.assertAllClose(recon, a, check_dtypes=False, atol=1e-3, rtol=1e-3)
+    self.assertAllClose(onp.linalg.svd(a, compute_uv=False), s,
+                        check_dtypes=False, atol=1e-3, rtol=1e-3)
+    self._CompileAndCheck(partial(np.linalg.svd, full_matrices=full_matrices),
+                          args_maker, check_dtypes=True)
+
   @parameterized.named_parameters(jtu.cases_from_list(
       {"testcase_name": "_shape={}_fullmatrices={}".format(
           jtu.format_shape_dtype_string(shape, dtype), full_matrices),
        "shape": shape, "dtype": dtype, "full_matrices": full_matrices,
        "rng": rng}
-      for shape in [(1, 1), (3, 4), (2, 10, 5), (2, 200, 100)]
+      for shape in [(1, 1), (3, 4), (4, 3), (2, 10, 5), (2, 200, 100)]
       for dtype in float_types
       for full_matrices in [False, True]
       for rng in [jtu.rand_default()]))
-  @jtu.skip_on_devices("cpu")
   def testQr(self, shape, dtype, full_matrices, rng):
     _skip_if_unsupported_type(dtype)
     m, n = shape[-2:]
@@ -447,12 +577,72 @@ class NumpyLinalgTest(jtu.JaxTestCase):
     self._CheckAgainstNumpy(onp.linalg.solve, np.linalg.solve, args_maker,
                             check_dtypes=True, tol=1e-3)
     self._CompileAndCheck(np.linalg.solve, args_maker, check_dtypes=True)
+    if dtype == onp.float64:
+      jtu.check_grads(np.linalg.solve, args_maker(), 2, atol=5e-2, rtol=1e-1)
+
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_lhs={}_rhs={}".format(
+           jtu.format_shape_dtype_string(lhs_shape, dtype),
+           jtu.format_shape_dtype_string(rhs_shape, dtype)),
+       "lhs_shape": lhs_shape, "rhs_shape": rhs_shape, "dtype": dtype,
+       "rng": rng}
+      for lhs_shape, rhs_shape in [
+          ((1, 1), (1,)), ((4, 4), (4, 2)), ((3, 60, 60), (3, 60, 5)),
+          ((2, 1, 20, 20), (1, 3, 20, 4)),
+      ]
+      for dtype in float_types + complex_types
+      for rng in [jtu.rand_default()]))
+  def testSolveMixedPrecision(self, lhs_shape, rhs_shape, dtype, rng):
+    _skip_if_unsupported_type(dtype)
+    n = lhs_shape[-1]
+    args_maker = lambda: [rng(lhs_shape, dtype) + n * onp.eye(n, dtype=dtype),
+                          rng(rhs_shape, dtype)]
+    jnp_fun = partial(np.linalg.solve, mixed_precision=True)
+    # Broadcast batch dimensions must not drop the mixed-precision hint.
+    jaxpr = api.make_jaxpr(jnp_fun)(*args_maker())
+    self.assertIn("mixed_precision=True", str(jaxpr))
+
+    # Refinement should recover a full precision answer.
+    double = dtype in (onp.float64, onp.complex128)
+    self._CheckAgainstNumpy(onp.linalg.solve, jnp_fun, args_maker,
+                            check_dtypes=True, tol=1e-10 if double else 1e-3)
+    self._CompileAndCheck(jnp_fun, args_maker, check_dtypes=True)
+    if dtype == onp.float64:
+      jtu.check_grads(jnp_fun, args_maker(), 2, rtol=1e-2)
+
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_dtype={}_cond=1e{}".format(
+           onp.dtype(dtype).name, log_cond),
+       "dtype": dtype, "log_cond": log_cond}
+      for dtype in [onp.float64, onp.complex128]
+      for log_cond in [10, 12]))
+  # The residual bound relies on LAPACK's fallback to a double precision
+  # factorization.
+  @jtu.skip_on_devices("gpu", "tpu")
+  def testSolveMixedPrecisionIllConditioned(self, dtype, log_cond):
+    # Too badly conditioned for single precision refinement to converge, so
+    # the solver has to fall back to a double precision factorization.
+    _skip_if_unsupported_type(dtype)
+    rng = onp.random.RandomState(0)
+    n, batch = 30, 8
+    q, _ = onp.linalg.qr(rng.randn(batch, n, n))
+    a = onp.einsum('...ij,...j,...kj->...ik', q,
+                   onp.logspace(0, -log_cond, n), q).astype(dtype)
+    b = rng.randn(batch, n, 2).astype(dtype)
+
+    x = onp.asarray(np.linalg.solve(a, b, mixed_precision=True))
+    residual = onp.einsum('...ij,...jk->...ik', a, x) - b
+    scale = (onp.linalg.norm(a, axis=(-2, -1)) *
+             onp.linalg.norm(x, axis=(-2, -1)))
+    self.assertLess(onp.max(onp.linalg.norm(residual, axis=(-2, -1)) / scale),
+                    1e-13)
 
   @parameterized.named_parameters(jtu.cases_from_list(
       {"testcase_name":
        "_shape={}".format(jtu.format_shape_dtype_string(shape, dtype)),
        "shape": shape, "dtype": dtype, "rng": rng}
-      for shape in [(1, 1), (4, 4), (2, 5, 5), (200, 200), (5, 5, 5)]
+      for shape in [(1, 1), (4, 4), (2, 5, 5), (200, 200), (5, 5, 5),
+                    (20, 3, 3)]
       for dtype in float_types
       for rng in [jtu.rand_default()]))
   def testInv(self, shape, dtype, rng):
@@ -486,6 +676,76 @@ class NumpyLinalgTest(jtu.JaxTestCase):
     xc = onp.eye(3, dtype=onp.complex)
     self.assertAllClose(xc, grad_test_jc(xc), check_dtypes=True)
 
+  @jtu.skip_on_devices("gpu", "tpu")
+  def testKernelStats(self):
+    if not hasattr(lapack, "get_kernel_stats"):
+      raise unittest.SkipTest("jaxlib has no kernel statistics")
+    a = onp.tile(onp.eye(3, dtype=onp.float32), (2, 1, 1))
+    lapack.reset_kernel_stats()
+    lapack.set_kernel_stats_enabled(True)
+    try:
+      cholesky = jit(lambda x: np.linalg.cholesky(x))
+      cholesky(a).block_until_ready()
+      cholesky(a).block_until_ready()
+    finally:
+      lapack.set_kernel_stats_enabled(False)
+
+    stats = [s for name, s in lapack.get_kernel_stats().items()
+             if "potrf" in name]
+    lapack.reset_kernel_stats()
+    self.assertEqual(len(stats), 1)
+    self.assertEqual(stats[0]["calls"], 2)
+    self.assertEqual(list(stats[0]["shapes"]), [(2, 3, 3)])
+    self.assertGreaterEqual(stats[0]["total_ns"], stats[0]["max_ns"])
+
+  @jtu.skip_on_devices("gpu", "tpu")
+  def testBatchedKernelsThreadPool(self):
+    if not hasattr(lapack, "set_max_threads"):
+      raise unittest.SkipTest("jaxlib has no LAPACK thread pool")
+    rng = onp.random.RandomState(0)
+    batch, n = 4000, 8
+    a = rng.randn(batch, n, n).astype(onp.float32)
+    s = a + T(a)
+    rows = onp.arange(batch)
+
+    def run(num_threads):
+      lapack.set_max_threads(num_threads)
+      # Fresh functions, so that each computation is built with this limit.
+      lu, pivots = jit(lambda x: lax_linalg.lu(x))(a)
+      v, w = jit(lambda x: lax_linalg.eigh(x, symmetrize_input=False))(s)
+      ev = jit(lambda x: lax_linalg.eigvals(x))(a)
+      return [onp.asarray(x) for x in (lu, pivots, v, w, ev)]
+
+    old_max_threads = lapack.get_max_threads()
+    try:
+      results = run(4)
+      serial_results = run(1)
+    finally:
+      lapack.set_max_threads(old_max_threads)
+
+    lu, pivots, v, w, ev = results
+    l = onp.tril(lu, -1) + onp.eye(n, dtype=onp.float32)
+    u = onp.triu(lu)
+    pa = a.copy()
+    for j in range(n):
+      row_j = pa[rows, j].copy()
+      pa[rows, j] = pa[rows, pivots[:, j]]
+      pa[rows, pivots[:, j]] = row_j
+    self.assertAllClose(onp.matmul(l, u), pa, check_dtypes=True, atol=1e-4)
+
+    self.assertAllClose(w, onp.linalg.eigvalsh(s), check_dtypes=True,
+                        atol=1e-4)
+    self.assertAllClose(onp.matmul(s, v), v * w[:, None, :],
+                        check_dtypes=True, atol=1e-3)
+
+    # Eigenvalues come back in no particular order, so match each one with
+    # its nearest counterpart from numpy.
+    dist = onp.abs(ev[:, :, None] - onp.linalg.eigvals(a)[:, None, :])
+    self.assertLess(onp.max(onp.min(dist, axis=2)), 1e-3)
+    self.assertLess(onp.max(onp.min(dist, axis=1)), 1e-3)
+
+    for x, y in zip(results, serial_results):
+      self.assertTrue(onp.array_equal(x, y))
 
 class ScipyLinalgTest(jtu.JaxTestCase):
 
@@ -564,14 +824,72 @@ class ScipyLinalgTest(jtu.JaxTestCase):
     self.assertAllClose(x, onp.matmul(l, u), check_dtypes=True, rtol=1e-3)
     self._CompileAndCheck(jsp.linalg.lu_factor, args_maker, check_dtypes=True)
 
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_shape={}_m={}".format(shape, m),
+       "shape": shape, "m": m}
+      for shape, m in [((1,), 1), ((4,), 4), ((3,), 5), ((10, 6), 6),
+                       ((2, 3, 4), 7)]))
+  def testLuPivotsToPermutation(self, shape, m):
+    rng = onp.random.RandomState(0)
+    pivots = onp.zeros(shape, onp.int32)
+    for i in range(shape[-1]):
+      pivots[..., i] = rng.randint(i, m, size=shape[:-1])
+
+    expected = onp.tile(onp.arange(m, dtype=onp.int32), shape[:-1] + (1,))
+    for idx in onp.ndindex(*shape[:-1]):
+      for i, j in enumerate(pivots[idx]):
+        expected[idx + (i,)], expected[idx + (j,)] = (
+            expected[idx + (j,)], expected[idx + (i,)])
+
+    perm = lax_linalg.lu_pivots_to_permutation(pivots, m)
+    self.assertAllClose(expected, perm, check_dtypes=True)
+    perm, inverse = lax_linalg.lu_pivots_to_permutation(pivots, m,
+                                                        inverse=True)
+    self.assertAllClose(expected, perm, check_dtypes=True)
+    self.assertAllClose(onp.argsort(expected, axis=-1).astype(onp.int32),
+                        inverse, check_dtypes=True)
+
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name":
+       "_lhs={}_rhs={}_trans={}".format(
+           jtu.format_shape_dtype_string(lhs_shape, dtype),
+           jtu.format_shape_dtype_string(rhs_shape, dtype),
+           trans),
+       "lhs_shape": lhs_shape, "rhs_shape": rhs_shape, "dtype": dtype,
+       "trans": trans, "rng": rng}
+      for lhs_shape, rhs_shape in [
+          ((1, 1), (1, 1)),
+          ((4, 4), (4,)),
+          ((8, 8), (8, 4)),
+      ]
+      for trans in [0, 1, 2]
+      for dtype in float_types + complex_types
+      for rng in [jtu.rand_default()]))
+  def testLuSolve(self, lhs_shape, rhs_shape, dtype, trans, rng):
+    _skip_if_unsupported_type(dtype)
+    osp_fun = lambda lu, piv, rhs: osp.linalg.lu_solve((lu, piv), rhs,
+                                                       trans=trans)
+    jsp_fun = lambda lu, piv, rhs: jsp.linalg.lu_solve((lu, piv), rhs,
+                                                       trans=trans)
+
+    def args_maker():
+      a = rng(lhs_shape, dtype)
+      lu, piv = osp.linalg.lu_factor(a)
+      return [lu, piv.astype(onp.int32), rng(rhs_shape, dtype)]
+
+    self._CheckAgainstNumpy(osp_fun, jsp_fun, args_maker,
+                            check_dtypes=True, tol=1e-3)
+    self._CompileAndCheck(jsp_fun, args_maker, check_dtypes=True)
+
   @parameterized.named_parameters(jtu.cases_from_list(
       {"testcase_name":
-       "_lhs={}_rhs={}_sym_pos={}_lower={}".format(
+       "_lhs={}_rhs={}_sym_pos={}_lower={}_mixed={}".format(
            jtu.format_shape_dtype_string(lhs_shape, dtype),
            jtu.format_shape_dtype_string(rhs_shape, dtype),
-           sym_pos, lower),
+           sym_pos, lower, mixed_precision),
        "lhs_shape": lhs_shape, "rhs_shape": rhs_shape, "dtype": dtype,
-       "sym_pos": sym_pos, "lower": lower, "rng": rng}
+       "sym_pos": sym_pos, "lower": lower,
+       "mixed_precision": mixed_precision, "rng": rng}
       for lhs_shape, rhs_shape in [
           ((1, 1), (1, 1)),
           ((4, 4), (4,)),
@@ -582,16 +900,20 @@ class ScipyLinalgTest(jtu.JaxTestCase):
         (True, False),
         (True, True),
       ]
+      for mixed_precision in [False, True]
       for dtype in float_types + complex_types
       for rng in [jtu.rand_default()]))
-  def testSolve(self, lhs_shape, rhs_shape, dtype, sym_pos, lower, rng):
+  def testSolve(self, lhs_shape, rhs_shape, dtype, sym_pos, lower,
+                mixed_precision, rng):
     _skip_if_unsupported_type(dtype)
     if (sym_pos and onp.issubdtype(dtype, onp.complexfloating) and
         jtu.device_under_test() == "tpu"):
       raise unittest.SkipTest(
         "Complex Cholesky decomposition not implemented on TPU")
     osp_fun = lambda lhs, rhs: osp.linalg.solve(lhs, rhs, sym_pos=sym_pos, lower=lower)
-    jsp_fun = lambda lhs, rhs: jsp.linalg.solve(lhs, rhs, sym_pos=sym_pos, lower=lower)
+    jsp_fun = lambda lhs, rhs: jsp.linalg.solve(
+        lhs, rhs, sym_pos=sym_pos, lower=lower,
+        mixed_precision=mixed_precision)
 
     def args_maker():
       a = rng(lhs_shape, dtype)
@@ -604,6 +926,52 @@ class ScipyLinalgTest(jtu.JaxTestCase):
                             check_dtypes=True, tol=1e-3)
     self._CompileAndCheck(jsp_fun, args_maker, check_dtypes=True)
 
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name":
+       "_lhs={}_rhs={}_lower={}".format(
+           jtu.format_shape_dtype_string(lhs_shape, dtype),
+           jtu.format_shape_dtype_string(rhs_shape, dtype),
+           lower),
+       "lhs_shape": lhs_shape, "rhs_shape": rhs_shape, "dtype": dtype,
+       "lower": lower, "rng": rng}
+      for lhs_shape, rhs_shape in [
+          ((1, 1), (1, 1)),
+          ((4, 4), (4,)),
+          ((8, 8), (8, 4)),
+          ((3, 5, 5), (3, 5, 2)),
+      ]
+      for lower in [False, True]
+      for dtype in float_types + complex_types
+      for rng in [jtu.rand_default()]))
+  def testChoSolve(self, lhs_shape, rhs_shape, dtype, lower, rng):
+    _skip_if_unsupported_type(dtype)
+    if (onp.issubdtype(dtype, onp.complexfloating) and
+        jtu.device_under_test() == "tpu"):
+      raise unittest.SkipTest(
+        "Complex Cholesky decomposition not implemented on TPU")
+    n = lhs_shape[-1]
+
+    def args_maker():
+      a = rng(lhs_shape, dtype)
+      a = onp.matmul(a, onp.conj(T(a))) + n * onp.eye(n, dtype=dtype)
+      c = onp.linalg.cholesky(a)
+      c = c if lower else onp.conj(T(c))
+      return [c.astype(dtype), rng(rhs_shape, dtype)]
+
+    def onp_fun(c, b):
+      l = c if lower else onp.conj(T(c))
+      a = onp.matmul(l, onp.conj(T(l)))
+      if a.ndim == b.ndim:
+        return onp.linalg.solve(a, b)
+      return onp.linalg.solve(a, b[..., None])[..., 0]
+
+    jsp_fun = lambda c, b: jsp.linalg.cho_solve((c, lower), b)
+    self._CheckAgainstNumpy(onp_fun, jsp_fun, args_maker,
+                            check_dtypes=True, tol=1e-3)
+    self._CompileAndCheck(jsp_fun, args_maker, check_dtypes=True)
+    if dtype == onp.float64:
+      jtu.check_grads(jsp_fun, args_maker(), 2, rtol=1e-2)
+
   @parameterized.named_parameters(jtu.cases_from_list(
       {"testcase_name":
        "_lhs={}_rhs={}_lower={}_transposea={}_unit_diagonal={}".format(
@@ -683,6 +1051,95 @@ class ScipyLinalgTest(jtu.JaxTestCase):
                 unit_diagonal=unit_diagonal)
     jtu.check_grads(f, (A, B), 2, rtol=2e-2, eps=1e-3)
 
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_lhs={}_rhs={}_lu={}".format(
+           jtu.format_shape_dtype_string(lhs_shape, dtype),
+           jtu.format_shape_dtype_string(rhs_shape, dtype), l_and_u),
+       "lhs_shape": lhs_shape, "rhs_shape": rhs_shape, "l_and_u": l_and_u,
+       "dtype": dtype, "rng": rng}
+      for lhs_shape, rhs_shape in [((1,), (1,)), ((6,), (6,)), ((9,), (9, 3))]
+      for l_and_u in [(0, 0), (1, 1), (2, 1), (0, 2)]
+      for dtype in float_types + complex_types
+      for rng in [jtu.rand_default()]))
+  def testSolveBanded(self, lhs_shape, rhs_shape, l_and_u, dtype, rng):
+    _skip_if_unsupported_type(dtype)
+    l, u = l_and_u
+    band_shape = (l + u + 1,) + lhs_shape
+
+    def args_maker():
+      ab = rng(band_shape, dtype)
+      ab[u] += 2 * (l + u + 1)
+      return [ab, rng(rhs_shape, dtype)]
+
+    osp_fun = partial(osp.linalg.solve_banded, l_and_u)
+    jsp_fun = partial(jsp.linalg.solve_banded, l_and_u)
+    self._CheckAgainstNumpy(osp_fun, jsp_fun, args_maker,
+                            check_dtypes=True, tol=1e-3)
+    self._CompileAndCheck(jsp_fun, args_maker, check_dtypes=True)
+    if dtype == onp.float64:
+      jtu.check_grads(jsp_fun, args_maker(), 2, rtol=1e-2)
+
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_lhs={}_rhs={}_kd={}_lower={}".format(
+           jtu.format_shape_dtype_string(lhs_shape, dtype),
+           jtu.format_shape_dtype_string(rhs_shape, dtype), kd, lower),
+       "lhs_shape": lhs_shape, "rhs_shape": rhs_shape, "kd": kd,
+       "lower": lower, "dtype": dtype, "rng": rng}
+      for lhs_shape, rhs_shape in [((6,), (6,)), ((9,), (9, 3))]
+      for kd in [0, 1, 2]
+      for lower in [False, True]
+      for dtype in float_types + complex_types
+      for rng in [jtu.rand_default()]))
+  def testSolvehBanded(self, lhs_shape, rhs_shape, kd, lower, dtype, rng):
+    _skip_if_unsupported_type(dtype)
+    diag = 0 if lower else kd
+
+    def args_maker():
+      ab = rng((kd + 1,) + lhs_shape, dtype)
+      ab[diag] = onp.abs(ab[diag]) + 4 * (kd + 1)
+      return [ab, rng(rhs_shape, dtype)]
+
+    osp_fun = partial(osp.linalg.solveh_banded, lower=lower)
+    jsp_fun = partial(jsp.linalg.solveh_banded, lower=lower)
+    self._CheckAgainstNumpy(osp_fun, jsp_fun, args_maker,
+                            check_dtypes=True, tol=1e-3)
+    self._CompileAndCheck(jsp_fun, args_maker, check_dtypes=True)
+    if dtype == onp.float64:
+      jtu.check_grads(jsp_fun, args_maker(), 2, rtol=1e-2)
+
+  @parameterized.named_parameters(jtu.cases_from_list(
+      {"testcase_name": "_n={}_rhs={}".format(
+           n, jtu.format_shape_dtype_string(rhs_shape, dtype)),
+       "n": n, "rhs_shape": rhs_shape, "dtype": dtype, "rng": rng}
+      for n, rhs_shape in [(1, (1, 1)), (7, (7, 2)), (20, (3, 20, 4))]
+      for dtype in float_types + complex_types
+      for rng in [jtu.rand_default()]))
+  def testTridiagonalSolve(self, n, rhs_shape, dtype, rng):
+    _skip_if_unsupported_type(dtype)
+    batch_shape = rhs_shape[:-2]
+
+    def args_maker():
+      dl, d, du = (rng(batch_shape + (n,), dtype) for _ in range(3))
+      return [dl, d + 6, du, rng(rhs_shape, dtype)]
+
+    def onp_fun(dl, d, du, b):
+      a = (d[..., None, :] * onp.eye(n) +
+           dl[..., :, None] * onp.eye(n, k=-1) +
+           du[..., :, None] * onp.eye(n, k=1))
+      return onp.linalg.solve(a, b).astype(dtype)
+
+    self._CheckAgainstNumpy(onp_fun, lax_linalg.tridiagonal_solve, args_maker,
+                            check_dtypes=True, tol=1e-3)
+    self._CompileAndCheck(lax_linalg.tridiagonal_solve, args_maker,
+                          check_dtypes=True)
+    args = args_maker()
+    xs = vmap(lax_linalg.tridiagonal_solve, (None, None, None, -1))(
+        *(args[:3] + [args[3][..., None]]))
+    self.assertAllClose(lax_linalg.tridiagonal_solve(*args), xs[..., 0],
+                        check_dtypes=True)
+    if dtype == onp.float64:
+      jtu.check_grads(lax_linalg.tridiagonal_solve, args, 2, rtol=1e-2)
+
 
 if __name__ == "__main__":
   absltest.main()